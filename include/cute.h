@@ -54,6 +54,7 @@
 #include "cute_net.h"
 #include "cute_png_cache.h"
 #include "cute_protocol.h"
+#include "cute_render_graph.h"
 #include "cute_server.h"
 #include "cute_sprite.h"
 #include "cute_string.h"
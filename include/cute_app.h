@@ -32,6 +32,7 @@ namespace cute
 {
 
 struct strpool_t;
+struct render_graph_t;
 
 #define CUTE_APP_OPTIONS_OPENGL_CONTEXT                 (1 << 0)
 #define CUTE_APP_OPTIONS_OPENGLES_CONTEXT               (1 << 1)
@@ -60,6 +61,14 @@ CUTE_API strpool_t* CUTE_CALL app_get_strpool();
 
 CUTE_API error_t CUTE_CALL app_set_offscreen_buffer(int offscreen_w, int offscreen_h);
 
+/**
+ * Runs `graph` each frame within `app_present`, after the offscreen buffer is drawn to and before it is
+ * upscaled onto the screen. The graph's output texture is what gets upscaled, so post-processing passes
+ * can read the offscreen buffer (see `render_graph_import_offscreen_buffer`). Pass NULL to turn this off.
+ * Requires `app_set_offscreen_buffer`.
+ */
+CUTE_API void CUTE_CALL app_set_render_graph(render_graph_t* graph);
+
 enum power_state_t
 {
 	POWER_STATE_UNKNOWN,    // Cannot determine power status.
@@ -49,7 +49,7 @@ struct batch_sprite_t
 	float scale_y; // Scaling along the quad's local y-axis in pixels.
 	float alpha = 1.0f; // Applies additional alpha to this quad.
 
-	int sort_bits = 0;
+	int sort_bits = 0; // Sprites are drawn in ascending order of `sort_bits`.
 };
 
 /**
@@ -82,11 +82,28 @@ CUTE_API void CUTE_CALL batch_destroy(batch_t* b);
 /**
  * Pushes sprite quad onto an internal buffer. Does no other logic.
  * 
+ * Safe to call from any thread, for example from render extraction jobs on the app's threadpool. Sprites
+ * pushed from other threads than the one that made the batch go into per-thread buffers, which are merged
+ * in by `batch_flush`. Within one thread sprites keep their push order, across threads use `sort_bits` to
+ * order them. `batch_flush` itself must not run while other threads are still pushing.
+ * 
  * To get your quad rendered, see `batch_flush`.
  * Don't forget to call `batch_update` at the beginning of each game loop.
  */
 CUTE_API void CUTE_CALL batch_push(batch_t* b, batch_sprite_t sprite);
 
+/**
+ * Same as calling `batch_push` for each of the `count` sprites, but much cheaper for large counts.
+ */
+CUTE_API void CUTE_CALL batch_push_many(batch_t* b, const batch_sprite_t* sprites, int count);
+
+/**
+ * Pushes `count` copies of `sprite`, each placed at its own position from `positions`. `scales` (in pixels,
+ * like `batch_sprite_t::scale_x` and `scale_y`) and `rotations` are optional, and can be NULL to use the ones
+ * from `sprite` instead. Handy for particles, or anything else drawing many copies of one image.
+ */
+CUTE_API void CUTE_CALL batch_push_many(batch_t* b, batch_sprite_t sprite, const v2* positions, const v2* scales, const sincos_t* rotations, int count);
+
 /**
  * All quads currently pushed onto the batch (see `batch_push`) will be converted to an internal draw call.
  */
@@ -104,6 +121,94 @@ CUTE_API void CUTE_CALL batch_outlines(batch_t* b, bool use_outlines);
 CUTE_API void CUTE_CALL batch_outlines_use_corners(batch_t* b, bool use_corners);
 CUTE_API void CUTE_CALL batch_outlines_color(batch_t* b, color_t c);
 
+/**
+ * Skips sprites that would be drawn entirely outside of the screen. Each `batch_flush` checks the pushed
+ * sprites against the view given by `batch_set_projection` and the current `m3x2` (see `batch_push_m3x2`),
+ * before they are sorted and turned into vertices. Culled sprites don't keep their images alive in the
+ * texture atlases either. Off by default.
+ *
+ * Assumes an orthographic projection, such as the one from `matrix_ortho_2d`.
+ */
+CUTE_API void CUTE_CALL batch_set_culling(batch_t* b, bool use_culling);
+
+/**
+ * Builds texture atlases on a worker thread owned by the batch instead of inside `batch_update`, so many
+ * new images showing up at once does not cause a hitch. Finished atlases are swapped in by a later
+ * `batch_update`, and until then new images draw from their own textures. Off by default.
+ *
+ * `get_pixels_fn` is called from the worker thread while this is on. The png and aseprite caches are
+ * safe for this, custom `get_pixels_fn` implementations must be too.
+ */
+CUTE_API void CUTE_CALL batch_set_async_atlases(batch_t* b, bool use_async_atlases);
+
+/**
+ * How images are arranged within the batch's texture atlases.
+ */
+enum batch_atlas_packing_t
+{
+	BATCH_ATLAS_PACKING_BEST_FIT, // Puts each image in the smallest free rectangle it fits in. Fast, the default.
+	BATCH_ATLAS_PACKING_SKYLINE,  // Stacks images along a skyline, lowest first. Fastest, good for images of similar heights.
+	BATCH_ATLAS_PACKING_MAXRECTS, // Tracks all free space, usually packs the tightest. Slowest, best built with `batch_set_async_atlases`.
+};
+
+/**
+ * Sets how images are packed into atlases built from now on. Atlases already built are left as they are.
+ */
+CUTE_API void CUTE_CALL batch_set_atlas_packing(batch_t* b, batch_atlas_packing_t packing);
+
+struct batch_stats_t
+{
+	int atlas_count;            // Number of texture atlases currently alive.
+	float atlas_fill_ratio;     // From 0 to 1, how much of the atlases is covered by images.
+	int lonely_texture_count;   // Number of images drawn from their own texture, as they are not in an atlas (yet).
+	int atlases_built;          // Total number of atlases built so far, including rebuilds.
+	int atlases_removed;        // Total number of atlases torn down by `batch_update`, to remove unused images or merge mostly empty atlases.
+	int texture_bytes_uploaded; // Bytes of texture data uploaded since the last `batch_update`.
+	int buffer_bytes_uploaded;  // Bytes of vertex and index data uploaded since the last `batch_update`.
+	int draw_calls;             // Number of draw calls issued by the last `batch_flush`.
+};
+
+/**
+ * Returns counters about the batch's atlases and uploads, for tuning texture memory use.
+ */
+CUTE_API batch_stats_t CUTE_CALL batch_get_stats(batch_t* b);
+
+/**
+ * A retained set of sprites, for things that look the same every frame such as tilemaps and background
+ * layers. The sprites are sorted, resolved against the batch's atlases and turned into vertices once, and
+ * then drawn straight from a cached vertex buffer each frame.
+ *
+ * The cache is rebuilt the next time the static batch is drawn after `batch_static_set_sprites` or
+ * `batch_static_mark_dirty`, or after the batch moves any of its images to a different texture (for
+ * example when `batch_update` packs them into an atlas).
+ */
+struct batch_static_t;
+
+/**
+ * Makes a static batch drawing `sprites` through the batch `b`. The sprites are copied. Any static batches
+ * still around when `b` is destroyed are destroyed along with it.
+ */
+CUTE_API batch_static_t* CUTE_CALL batch_static_make(batch_t* b, const batch_sprite_t* sprites, int count);
+CUTE_API void CUTE_CALL batch_static_destroy(batch_static_t* s);
+
+/**
+ * Replaces all sprites of the static batch.
+ */
+CUTE_API void CUTE_CALL batch_static_set_sprites(batch_static_t* s, const batch_sprite_t* sprites, int count);
+
+/**
+ * Forces the static batch to rebuild its vertices the next time it is drawn.
+ */
+CUTE_API void CUTE_CALL batch_static_mark_dirty(batch_static_t* s);
+
+/**
+ * Draws the static batch right away, with the batch's current projection, transform (see `batch_push_m3x2`),
+ * tint, scissor box and render states. Unlike `batch_flush` the transform is applied on the GPU, so moving
+ * the camera does not cause a rebuild. Sprites pushed with `batch_push` are not drawn, call `batch_flush`
+ * afterwards to draw them on top. Must be called from the thread that made the batch.
+ */
+CUTE_API void CUTE_CALL batch_static_draw(batch_static_t* s);
+
 CUTE_API void CUTE_CALL batch_push_m3x2(batch_t* b, m3x2 m);
 CUTE_API void CUTE_CALL batch_pop_m3x2(batch_t* b);
 CUTE_API void CUTE_CALL batch_push_scissor_box(batch_t* b, int x, int y, int w, int h);
@@ -144,6 +249,15 @@ CUTE_API void CUTE_CALL batch_line(batch_t* b, v2 p0, v2 p1, float thickness, co
 CUTE_API void CUTE_CALL batch_line(batch_t* b, v2 p0, v2 p1, float thickness, color_t c0, color_t c1, bool antialias = false);
 CUTE_API void CUTE_CALL batch_polyline(batch_t* b, v2* points, int count, float thickness, color_t c, bool loop = false, bool antialias = false, int bevel_count = 0);
 
+/**
+ * Keeps the triangles of each `batch_polyline` around, and reuses them when the exact same polyline (same points,
+ * thickness, color and options) is drawn again, instead of building them from scratch. Polylines not drawn since
+ * the last `batch_update` are dropped from the cache. Off by default.
+ *
+ * Worth it for debug drawing and other polylines that rarely change from one frame to the next.
+ */
+CUTE_API void CUTE_CALL batch_set_polyline_cache(batch_t* b, bool use_polyline_cache);
+
 
 /**
  * Temporal texture information for a sprite. Is valid until the next call to `batch_flush`
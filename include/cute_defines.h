@@ -113,7 +113,9 @@
 
 #define SOKOL_API_DECL CUTE_API
 
-#if defined(CUTE_WINDOWS)
+#if defined(SOKOL_DUMMY_BACKEND)
+	// Headless build that renders nothing, see CUTE_FRAMEWORK_DUMMY_GFX in CMakeLists.txt.
+#elif defined(CUTE_WINDOWS)
 #	define SOKOL_D3D11
 #elif defined(CUTE_LINUX)
 #	define SOKOL_GLCORE33
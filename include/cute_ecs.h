@@ -47,21 +47,71 @@ struct entity_t
 
 static constexpr entity_t INVALID_ENTITY = { (uint32_t)~0, CUTE_INVALID_HANDLE };
 
+/**
+ * A component type resolved once with `ecs_component_id`. Looking up components by id avoids hashing
+ * the component type string on each call, and is safe to call from systems running in parallel.
+ */
+struct component_id_t
+{
+	int id; // For internal use -- don't touch.
+};
+
+static constexpr component_id_t INVALID_COMPONENT_ID = { -1 };
+
 CUTE_API void CUTE_CALL ecs_entity_begin();
 CUTE_API void CUTE_CALL ecs_entity_end();
 CUTE_API void CUTE_CALL ecs_entity_set_name(const char* entity_type);
 CUTE_API void CUTE_CALL ecs_entity_add_component(const char* component_type);
 CUTE_API void CUTE_CALL ecs_entity_set_optional_schema(const char* schema);
 
+/**
+ * Stores the components of this entity type in fixed size 16KB chunks instead of one growable array
+ * per component type. Spawning never reallocates or moves existing components, avoiding latency spikes
+ * for entity types with very large counts. System update functions are called once per chunk.
+ */
+CUTE_API void CUTE_CALL ecs_entity_set_optional_chunked_storage(bool true_to_use_chunks);
+
 CUTE_API entity_t CUTE_CALL entity_make(const char* entity_type, error_t* err = NULL);
 CUTE_API bool CUTE_CALL entity_is_valid(entity_t entity);
 CUTE_API bool CUTE_CALL entity_is_type(entity_t entity, const char* entity_type);
 CUTE_API const char* CUTE_CALL entity_get_type_string(entity_t entity);
 CUTE_API bool CUTE_CALL entity_has_component(entity_t entity, const char* component_type);
 CUTE_API void* CUTE_CALL entity_get_component(entity_t entity, const char* component_type);
+CUTE_API bool CUTE_CALL entity_has_component(entity_t entity, component_id_t component_id);
+CUTE_API void* CUTE_CALL entity_get_component(entity_t entity, component_id_t component_id);
 CUTE_API void CUTE_CALL entity_destroy(entity_t entity);
 CUTE_API void CUTE_CALL entity_delayed_destroy(entity_t entity);
 
+/**
+ * Makes `count` entities of the same type at once and writes them into `entities_out`, which must
+ * have room for `count` entities. Storage is grown once for the whole batch. Upon failure no entities
+ * are made, and `entities_out` is filled with `INVALID_ENTITY`.
+ */
+CUTE_API error_t CUTE_CALL entity_make_many(const char* entity_type, int count, entity_t* entities_out);
+
+/**
+ * Destroys `count` entities, looking up component cleanup functions once per run of entities that
+ * share the same type.
+ */
+CUTE_API void CUTE_CALL entity_destroy_many(const entity_t* entities, int count);
+
+/**
+ * Records making an entity of type `entity_type` into a command buffer, to be played back at the end of
+ * `ecs_run_systems` (or by `ecs_flush_delayed_commands`). Safe to call from any thread, including from
+ * parallel systems and `ecs_query_parallel_for_each`. Returns a placeholder entity that can be passed to
+ * the other delayed functions until then. The placeholder itself is never valid, and must not be used
+ * once the commands have been played back.
+ */
+CUTE_API entity_t CUTE_CALL entity_delayed_make(const char* entity_type);
+
+/**
+ * Records copying `size` bytes of `component` over an entity's component, to be played back after all
+ * delayed makes. `entity` can be a real entity or a placeholder from `entity_delayed_make`. Safe to call
+ * from any thread.
+ */
+CUTE_API void CUTE_CALL entity_delayed_set_component(entity_t entity, const char* component_type, const void* component, size_t size);
+CUTE_API void CUTE_CALL entity_delayed_set_component(entity_t entity, component_id_t component_id, const void* component, size_t size);
+
 /**
  * `kv` needs to be in `KV_STATE_READ` mode.
  */
@@ -73,6 +123,22 @@ CUTE_API error_t CUTE_CALL ecs_load_entities(kv_t* kv, array<entity_t>* entities
 CUTE_API error_t CUTE_CALL ecs_save_entities(const array<entity_t>& entities, kv_t* kv);
 CUTE_API error_t CUTE_CALL ecs_save_entities(const array<entity_t>& entities);
 
+/**
+ * Saves all entities of all entity types into a compact binary snapshot, overwriting `snapshot_out`.
+ * Components are stored as raw bytes, except for components marked with
+ * `ecs_component_set_optional_snapshot_serialize`. Meant for quick-saves and rollback within the same
+ * build of your game -- snapshots can only be loaded with the same entity and component types registered.
+ * Fails if a component with a cleanup function is not marked with `ecs_component_set_optional_snapshot_serialize`.
+ */
+CUTE_API error_t CUTE_CALL ecs_save_snapshot(array<uint8_t>* snapshot_out);
+
+/**
+ * Replaces all entities with the entities from a snapshot made by `ecs_save_snapshot`. Entities keep
+ * the exact same `entity_t` values they had when the snapshot was saved, and entities made since then
+ * become invalid. Nothing is changed if the snapshot is invalid.
+ */
+CUTE_API error_t CUTE_CALL ecs_load_snapshot(const void* snapshot, size_t size);
+
 //--------------------------------------------------------------------------------------------------
 // Component
 
@@ -86,20 +152,115 @@ CUTE_API void CUTE_CALL ecs_component_set_size(size_t size);
 CUTE_API void CUTE_CALL ecs_component_set_optional_serializer(component_serialize_fn* serializer_fn, void* udata = NULL);
 CUTE_API void CUTE_CALL ecs_component_set_optional_cleanup(component_cleanup_fn* cleanup_fn, void* udata = NULL);
 
+/**
+ * Promises the serializer produces the same bytes when loading a schema no matter which entity is being
+ * made, and that the component is safe to copy with `memcpy` (it does not own any memory after being
+ * loaded from a schema). The serializer then runs only once per entity type, on the first spawn, and
+ * the resulting bytes are copied into every new entity. Defaults to false.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_optional_copy_defaults(bool true_to_copy_defaults);
+
+/**
+ * Saves and loads this component in snapshots with its serializer instead of copying raw bytes. Set
+ * this for components holding pointers or owning memory, which is required for any component with a
+ * cleanup function. Defaults to false.
+ */
+CUTE_API void CUTE_CALL ecs_component_set_optional_snapshot_serialize(bool true_to_use_serializer);
+
+/**
+ * Returns the id of a registered component type, or `INVALID_COMPONENT_ID` if `component_type` was
+ * never registered. Ids stay the same until the app is destroyed.
+ */
+CUTE_API component_id_t CUTE_CALL ecs_component_id(const char* component_type);
+
+//--------------------------------------------------------------------------------------------------
+// Query
+
+struct ecs_query_t
+{
+	int id; // For internal use -- don't touch.
+};
+
+/**
+ * A contiguous run of entities that all have the components of a query.
+ */
+struct ecs_span_t
+{
+	CUTE_INLINE entity_t get_entity(int index) const { return { entity_type, entity_handles[index] }; }
+
+	int entity_count;
+	void* components[8];            // One array per component type, in the same order given to `ecs_query`.
+	uint32_t entity_type;           // For internal use -- don't touch.
+	const handle_t* entity_handles; // For internal use -- don't touch.
+};
+
+typedef void (ecs_query_fn)(ecs_span_t span, void* udata);
+
+/**
+ * Returns a query over all entities with (at least) all of the `component_types`, up to a max of 8.
+ * Queries are cached, so calling this again with the same component types is cheap and returns the
+ * same query. Matched entity types are refreshed automatically when new entity types are registered.
+ */
+CUTE_API ecs_query_t CUTE_CALL ecs_query(const array<const char*>& component_types);
+
+/**
+ * Calls `fn` once for each contiguous span of entities matching `query`. Making or destroying
+ * entities from within `fn` is not supported, use `entity_delayed_make` or `entity_delayed_destroy` instead.
+ */
+CUTE_API void CUTE_CALL ecs_query_for_each(ecs_query_t query, ecs_query_fn* fn, void* udata = NULL);
+
+/**
+ * Same as `ecs_query_for_each`, except the spans are handed out to the app's threadpool and this
+ * function waits until they are all done. Spans are further split up into at most `entities_per_job`
+ * entities, or not split at all if set to 0. Runs on the calling thread if no threadpool is available.
+ */
+CUTE_API void CUTE_CALL ecs_query_parallel_for_each(ecs_query_t query, ecs_query_fn* fn, void* udata = NULL, int entities_per_job = 0);
+
 //--------------------------------------------------------------------------------------------------
 // System
 
+enum component_access_t
+{
+	COMPONENT_ACCESS_READ_WRITE, // The system may read and write the component (default).
+	COMPONENT_ACCESS_READ,       // The system only reads the component, so it may share it with other readers.
+};
+
 CUTE_API void CUTE_CALL ecs_system_begin();
 CUTE_API void CUTE_CALL ecs_system_end();
 CUTE_API void CUTE_CALL ecs_system_set_name(const char* name);
 CUTE_API void CUTE_CALL ecs_system_set_update(void* update_fn);
-CUTE_API void CUTE_CALL ecs_system_require_component(const char* component_type);
+CUTE_API void CUTE_CALL ecs_system_require_component(const char* component_type, component_access_t access = COMPONENT_ACCESS_READ_WRITE);
 CUTE_API void CUTE_CALL ecs_system_set_optional_pre_update(void (*pre_update_fn)(float dt, void* udata));
 CUTE_API void CUTE_CALL ecs_system_set_optional_post_update(void (*post_update_fn)(float dt, void* udata));
 CUTE_API void CUTE_CALL ecs_system_set_optional_update_udata(void* udata);
 
+/**
+ * Allows the update function of this system to be split up into chunks of `entity_count` entities
+ * when systems are run in parallel (see `ecs_set_parallel_systems`). Only set this if the update
+ * function never touches entities outside of the arrays it was handed. Defaults to 0 (no chunking).
+ */
+CUTE_API void CUTE_CALL ecs_system_set_optional_parallel_chunk_size(int entity_count);
+
 CUTE_API void CUTE_CALL ecs_run_systems(float dt);
 
+/**
+ * Plays back all commands recorded by `entity_delayed_make`, `entity_delayed_set_component` and
+ * `entity_delayed_destroy`. Makes are played first, then component sets, then destroys. This is called
+ * automatically at the end of `ecs_run_systems`, so it is only needed for commands recorded elsewhere,
+ * such as from `ecs_query_for_each`. Must not be called while systems or queries are running.
+ */
+CUTE_API void CUTE_CALL ecs_flush_delayed_commands();
+
+/**
+ * When turned on `ecs_run_systems` dispatches systems onto the app's threadpool. Systems that do not
+ * touch the same components (see `component_access_t`) run at the same time, while conflicting systems
+ * still run in the order they were registered. Systems requiring no components, or with a pre or post
+ * update callback, act as a barrier. Pre and post update callbacks are always called on the calling thread.
+ *
+ * Falls back to running serially when no threadpool is available. Off by default.
+ */
+CUTE_API void CUTE_CALL ecs_set_parallel_systems(bool true_to_run_in_parallel);
+
 //--------------------------------------------------------------------------------------------------
 // Introspection
 
@@ -108,6 +269,46 @@ CUTE_API array<const char*> CUTE_CALL ecs_get_component_list();
 CUTE_API array<const char*> CUTE_CALL ecs_get_system_list();
 CUTE_API array<const char*> CUTE_CALL ecs_get_component_list_for_entity_type(const char* entity_type);
 
+#define CUTE_ECS_PROFILE_FRAME_COUNT 120
+
+/**
+ * Timings of one system for one call to `ecs_run_systems`. When systems run in parallel `update_seconds`
+ * is the time spent across all threads, and can be larger than the wall time of the whole frame.
+ */
+struct ecs_system_profile_t
+{
+	const char* name;
+	float pre_update_seconds;
+	float update_seconds;
+	float post_update_seconds;
+	int entity_count; // Number of entities the update function was called upon.
+};
+
+/**
+ * When turned on `ecs_run_systems` records an `ecs_system_profile_t` for each system into a ring buffer
+ * holding the last `CUTE_ECS_PROFILE_FRAME_COUNT` frames. This only costs a couple of timer reads per system
+ * per frame, so is cheap enough to leave on. Turning it on, or registering a new system, clears the history.
+ * Off by default.
+ */
+CUTE_API void CUTE_CALL ecs_set_system_profiling(bool true_to_enable);
+
+/**
+ * Returns the number of frames currently held in the profiling ring buffer.
+ */
+CUTE_API int CUTE_CALL ecs_get_system_profile_frame_count();
+
+/**
+ * Returns the profile of each system, in the same order as `ecs_get_system_list`, from `frames_ago` calls
+ * to `ecs_run_systems` ago (0 is the most recent one). Returns an empty array if no such frame was recorded.
+ */
+CUTE_API array<ecs_system_profile_t> CUTE_CALL ecs_get_system_profile(int frames_ago = 0);
+
+/**
+ * Draws an ImGui window showing the averaged system profiles. Does nothing unless ImGui was initialized
+ * with `app_init_imgui`. Call this in between `app_update` and `app_present`.
+ */
+CUTE_API void CUTE_CALL ecs_imgui_system_profiler(bool* open = NULL);
+
 }
 
 #endif // CUTE_ECS_H
@@ -34,8 +34,13 @@ struct font_t;
 struct matrix_t;
 
 CUTE_API font_t* CUTE_CALL font_load_bmfont(const char* font_path, const char* font_image_path);
+CUTE_API font_t* CUTE_CALL font_load_sdf(const char* ttf_path);
+CUTE_API font_t* CUTE_CALL font_load_sdf_mem(const void* ttf_data, int size);
 CUTE_API void CUTE_CALL font_free(font_t* font);
 
+CUTE_API bool CUTE_CALL font_is_sdf(const font_t* font);
+CUTE_API void CUTE_CALL font_sdf_preload(const font_t* font, const char* text);
+
 CUTE_API const font_t* CUTE_CALL font_get_default();
 CUTE_API void CUTE_CALL font_push_verts(const font_t* font, const char* text, float x, float y, float wrap_w, const aabb_t* clip_box = NULL);
 CUTE_API void CUTE_CALL font_draw(const font_t* font, matrix_t mvp, color_t color = color_black());
@@ -46,6 +51,17 @@ CUTE_API bool CUTE_CALL font_is_borders_on();
 CUTE_API void CUTE_CALL font_border_color(color_t color);
 CUTE_API void CUTE_CALL font_border_use_corners(bool use_corners);
 
+struct font_layout_cache_stats_t
+{
+	int hits;         // Calls to `font_push_verts` that replayed a cached layout.
+	int misses;       // Calls to `font_push_verts` that had to lay the text out.
+	int layout_count; // Number of layouts currently held by the cache.
+};
+
+CUTE_API void CUTE_CALL font_layout_cache(bool use_cache);
+CUTE_API bool CUTE_CALL font_is_layout_cache_on();
+CUTE_API font_layout_cache_stats_t CUTE_CALL font_get_layout_cache_stats();
+
 CUTE_API int CUTE_CALL font_height(const font_t* font);
 CUTE_API int CUTE_CALL font_line_height(const font_t* font);
 
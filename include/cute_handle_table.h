@@ -41,6 +41,21 @@ CUTE_API void CUTE_CALL handle_allocator_update_index(handle_allocator_t* table,
 CUTE_API void CUTE_CALL handle_allocator_free(handle_allocator_t* table, handle_t handle);
 CUTE_API int CUTE_CALL handle_allocator_is_handle_valid(handle_allocator_t* table, handle_t handle);
 
+/**
+ * Copies out the entire state of the allocator into `buffer`, which must be at least
+ * `handle_allocator_state_size` bytes. Restoring it later with `handle_allocator_set_state` brings
+ * back all handles that were valid at the time, while any other handles become invalid.
+ */
+CUTE_API size_t CUTE_CALL handle_allocator_state_size(handle_allocator_t* table);
+CUTE_API void CUTE_CALL handle_allocator_get_state(handle_allocator_t* table, void* buffer);
+CUTE_API int CUTE_CALL handle_allocator_set_state(handle_allocator_t* table, const void* buffer, size_t size);
+
+/**
+ * Returns 1 if `handle_allocator_set_state` would accept `buffer`, without changing anything. When
+ * `handles` is given, also checks that each `handles[i]` is a valid handle with index `i` in that state.
+ */
+CUTE_API int CUTE_CALL handle_allocator_is_state_valid(const void* buffer, size_t size, const handle_t* handles = NULL, int handle_count = 0);
+
 // -------------------------------------------------------------------------------------------------
 
 struct handle_table_t
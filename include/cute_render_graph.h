@@ -0,0 +1,131 @@
+/*
+	Cute Framework
+	Copyright (C) 2021 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CUTE_RENDER_GRAPH_H
+#define CUTE_RENDER_GRAPH_H
+
+#include "cute_defines.h"
+#include "cute_error.h"
+
+#include "sokol/sokol_gfx.h"
+
+namespace cute
+{
+
+/**
+ * The render graph schedules a frame's offscreen render passes. Each pass declares which textures
+ * it reads and which it writes, and the graph works out the rest when compiled.
+ *
+ *     - Passes are run in dependency order (ties keep the order they were added in).
+ *     - Passes that contribute neither to the output texture nor to an imported texture are culled.
+ *     - Transient textures are pooled render targets. Two transient textures of the same size and
+ *       format share one image when their lifetimes do not overlap.
+ *
+ * Textures are either created by the graph (transient), or imported from images you own, such as the
+ * app's offscreen buffer. A graph is compiled lazily by `render_graph_execute` whenever it was changed,
+ * so a graph can be built once and executed every frame. Calling `render_graph_clear` and rebuilding
+ * each frame is fine too, since pooled images are kept around for the next compile.
+ */
+struct render_graph_t;
+
+/**
+ * Handle to a texture within a render graph. Negative values are invalid.
+ */
+using render_graph_texture_t = int;
+
+/**
+ * Handle to a pass within a render graph. Negative values are invalid.
+ */
+using render_graph_pass_t = int;
+
+/**
+ * Called by `render_graph_execute` in between `sg_begin_pass` and `sg_end_pass`. Use
+ * `render_graph_get_image` to fetch the images of any textures the pass reads.
+ */
+typedef void (render_graph_pass_fn)(render_graph_t* graph, void* udata);
+
+CUTE_API render_graph_t* CUTE_CALL render_graph_make(void* user_allocator_context = NULL);
+CUTE_API void CUTE_CALL render_graph_destroy(render_graph_t* graph);
+
+/**
+ * Removes all textures and passes, and discards their names. Pooled images are kept, and reused by the
+ * next compile.
+ */
+CUTE_API void CUTE_CALL render_graph_clear(render_graph_t* graph);
+
+/**
+ * Imports an image owned by you. Passes writing an imported texture are never culled.
+ */
+CUTE_API render_graph_texture_t CUTE_CALL render_graph_import_texture(render_graph_t* graph, const char* name, sg_image image, int w, int h);
+
+/**
+ * Imports the app's offscreen color buffer, see `app_set_offscreen_buffer`. The buffer is looked up
+ * again on each execute, so the texture stays valid when the offscreen buffer is resized.
+ */
+CUTE_API render_graph_texture_t CUTE_CALL render_graph_import_offscreen_buffer(render_graph_t* graph);
+
+/**
+ * Declares a transient render target. `SG_PIXELFORMAT_NONE` picks the app's color format. Depth formats
+ * are bound as the depth-stencil attachment of the pass writing them.
+ */
+CUTE_API render_graph_texture_t CUTE_CALL render_graph_create_texture(render_graph_t* graph, const char* name, int w, int h, sg_pixel_format format = SG_PIXELFORMAT_NONE);
+
+/**
+ * Adds a pass. `action` defaults to clearing all attachments.
+ */
+CUTE_API render_graph_pass_t CUTE_CALL render_graph_add_pass(render_graph_t* graph, const char* name, render_graph_pass_fn* fn, void* udata = NULL, const sg_pass_action* action = NULL);
+CUTE_API void CUTE_CALL render_graph_pass_reads(render_graph_t* graph, render_graph_pass_t pass, render_graph_texture_t texture);
+CUTE_API void CUTE_CALL render_graph_pass_writes(render_graph_t* graph, render_graph_pass_t pass, render_graph_texture_t texture);
+
+/**
+ * The output texture is what the graph is run for. Only passes it depends upon (or passes writing
+ * imported textures) are executed.
+ */
+CUTE_API void CUTE_CALL render_graph_set_output(render_graph_t* graph, render_graph_texture_t texture);
+CUTE_API render_graph_texture_t CUTE_CALL render_graph_get_output(render_graph_t* graph);
+
+/**
+ * Culls, orders and allocates images for the passes. Fails if a texture has more than one writer,
+ * a transient texture is read but never written, a pass writes textures of different sizes or reads
+ * a texture it writes, or the passes form a cycle.
+ */
+CUTE_API error_t CUTE_CALL render_graph_compile(render_graph_t* graph);
+
+/**
+ * Runs all passes that survived culling, compiling first if the graph was changed.
+ */
+CUTE_API error_t CUTE_CALL render_graph_execute(render_graph_t* graph);
+
+/**
+ * Returns the image backing a texture. Transient textures only have an image after a compile,
+ * and may share it with other transient textures.
+ */
+CUTE_API sg_image CUTE_CALL render_graph_get_image(render_graph_t* graph, render_graph_texture_t texture);
+CUTE_API void CUTE_CALL render_graph_get_texture_size(render_graph_t* graph, render_graph_texture_t texture, int* w, int* h);
+
+/**
+ * Returns true if the last compile culled `pass`.
+ */
+CUTE_API bool CUTE_CALL render_graph_pass_is_culled(render_graph_t* graph, render_graph_pass_t pass);
+
+}
+
+#endif // CUTE_RENDER_GRAPH_H
@@ -140,6 +140,8 @@
 		1.04 (08/20/2021) qsort -> mergesort to avoid bugs, optional override
 		                  sprites_sorter_callback sorting routines provided by Kariem,
 		                  added new function `spritebatch_prefetch`
+		1.05 (10/16/2026) default sort is now an LSD radix sort over packed keys,
+		                  mergesort kept around as `spritebatch_internal_merge_sort`
 */
 
 #ifndef SPRITEBATCH_H
@@ -193,6 +195,10 @@ struct spritebatch_sprite_t
 // Pushes a sprite onto an internal buffer. Does no other logic.
 int spritebatch_push(spritebatch_t* sb, spritebatch_sprite_t sprite);
 
+// Same as `spritebatch_push`, but for `count` sprites at once. The internal buffer is grown at
+// most once, making this much cheaper than many calls to `spritebatch_push` for large counts.
+int spritebatch_push_many(spritebatch_t* sb, const spritebatch_sprite_t* sprites, int count);
+
 // Ensures the image associated with your unique `image_id` is loaded up into spritebatch. This
 // function pretends to draw a sprite referencing `image_id` but doesn't actually do any
 // drawing at all. Use this function as an optimization to pre-load images you know will be
@@ -271,6 +277,55 @@ typedef void (destroy_texture_handle_fn)(SPRITEBATCH_U64 texture_id, void* udata
 //     };
 typedef void (sprites_sorter_fn)(spritebatch_sprite_t* sprites, int count);
 
+// (Optional) Atlases are normally built synchronously inside of `spritebatch_defrag`, which fetches the
+// pixels of every image going into the atlas. If the user provides this callback, `spritebatch_defrag`
+// instead hands each atlas it wants to build over as a job, and returns right away. The images in a
+// job keep drawing from their lonely textures until the job is finished.
+//
+// Jobs can be run on any thread with `spritebatch_atlas_job_run`, which packs the images and calls
+// `get_pixels_fn` for each of them (so `get_pixels_fn` must be safe to call from that thread). Once
+// run, hand the job back with `spritebatch_atlas_job_finish` on the thread using the spritebatch, on
+// a later frame. This makes the atlas texture and moves the images over to it. Every job must be
+// finished before calling `spritebatch_term`.
+typedef struct spritebatch_atlas_job_t spritebatch_atlas_job_t;
+typedef void (build_atlas_fn)(spritebatch_atlas_job_t* job, void* udata);
+
+// Packs the images of `job` and gathers their pixels. Does not touch the spritebatch.
+void spritebatch_atlas_job_run(spritebatch_atlas_job_t* job);
+
+// Turns a job that has been run into an atlas, and frees the job.
+void spritebatch_atlas_job_finish(spritebatch_t* sb, spritebatch_atlas_job_t* job);
+
+// How `spritebatch_make_atlas` arranges images within an atlas. Images are always placed from largest to
+// smallest perimeter.
+typedef enum spritebatch_atlas_packing_t
+{
+	// Splits the free space into two rectangles after each placement, and picks the smallest free
+	// rectangle the next image fits in. Fast, but fragments the free space the most.
+	SPRITEBATCH_ATLAS_PACKING_BEST_FIT,
+
+	// Tracks the top edge of the placed images, and puts each image where that edge ends up lowest.
+	// Fast, and packs images of similar heights well.
+	SPRITEBATCH_ATLAS_PACKING_SKYLINE,
+
+	// Tracks every maximal free rectangle and picks the one that leaves the least space on the shorter
+	// side (best short side fit). Usually packs the tightest, but is the slowest, roughly quadratic in
+	// the number of images.
+	SPRITEBATCH_ATLAS_PACKING_MAXRECTS,
+} spritebatch_atlas_packing_t;
+
+typedef struct spritebatch_atlas_stats_t
+{
+	int atlas_count;          // number of atlases currently alive
+	int lonely_texture_count; // number of images not in any atlas
+	float fill_ratio;         // from 0 to 1, how much of all atlases is covered by images (including border pixels)
+	int atlases_built;        // total atlases built so far
+	int atlases_flushed;      // total atlases removed by `spritebatch_defrag`, either decayed or merged into new ones
+} spritebatch_atlas_stats_t;
+
+// Fills out `stats` with the current state of the atlases, for tuning the config.
+void spritebatch_get_atlas_stats(spritebatch_t* sb, spritebatch_atlas_stats_t* stats);
+
 // Sets all function pointers originally defined in the `config` struct when calling `spritebatch_init`.
 // Useful if DLL's are reloaded, or swapped, etc.
 void spritebatch_reset_function_ptrs(spritebatch_t* sb, submit_batch_fn* batch_callback, get_pixels_fn* get_pixels_callback, generate_texture_handle_fn* generate_texture_callback, destroy_texture_handle_fn* delete_texture_callback);
@@ -294,11 +349,13 @@ struct spritebatch_config_t
 	                                    // been warned! Use `SPRITEBATCH_LOG` to gain some insight on what's going on inside the spritebatch when tuning these settings.
 	float ratio_to_decay_atlas;         // from 0 to 1, once ratio is less than `ratio_to_decay_atlas`, flush active textures in atlas to lonely buffer
 	float ratio_to_merge_atlases;       // from 0 to 0.5, attempts to merge atlases with some ratio of empty space
+	spritebatch_atlas_packing_t atlas_packing;
 	submit_batch_fn* batch_callback;
 	get_pixels_fn* get_pixels_callback;
 	generate_texture_handle_fn* generate_texture_callback;
 	destroy_texture_handle_fn* delete_texture_callback;
 	sprites_sorter_fn* sprites_sorter_callback; // (Optional)
+	build_atlas_fn* build_atlas_callback;       // (Optional)
 	void* allocator_context;
 };
 
@@ -429,6 +486,7 @@ typedef struct
 	int w, h;
 	SPRITEBATCH_U64 image_id;
 	SPRITEBATCH_U64 texture_id;
+	int pending; // non-zero while waiting on an atlas job, see `build_atlas_fn`
 } spritebatch_internal_lonely_texture_t;
 
 
@@ -443,6 +501,7 @@ struct spritebatch_t
 	int sprite_capacity;
 	spritebatch_sprite_t* sprites;
 	spritebatch_sprite_t* sprites_scratch;
+	void* sort_buffer; // radix sort keys and indices, see `spritebatch_internal_radix_sort`
 
 	int key_buffer_count;
 	int key_buffer_capacity;
@@ -465,11 +524,15 @@ struct spritebatch_t
 	int lonely_buffer_count_till_decay;
 	float ratio_to_decay_atlas;
 	float ratio_to_merge_atlases;
+	spritebatch_atlas_packing_t atlas_packing;
+	int atlases_built;
+	int atlases_flushed;
 	submit_batch_fn* batch_callback;
 	get_pixels_fn* get_pixels_callback;
 	generate_texture_handle_fn* generate_texture_callback;
 	destroy_texture_handle_fn* delete_texture_callback;
 	sprites_sorter_fn* sprites_sorter_callback;
+	build_atlas_fn* build_atlas_callback;
 	void* mem_ctx;
 	void* udata;
 };
@@ -942,6 +1005,9 @@ WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 // end of hashtable.h
 
 
+// two keys and two indices per sprite, one of each being scratch space for the radix sort passes
+#define SPRITEBATCH_INTERNAL_SORT_BYTES_PER_SPRITE (sizeof(SPRITEBATCH_U64) * 2 + sizeof(int) * 2)
+
 bool sprite_batch_internal_use_scratch_buffer(spritebatch_t* sb)
 {
 	return sb->sprites_sorter_callback == 0;
@@ -961,11 +1027,15 @@ int spritebatch_init(spritebatch_t* sb, spritebatch_config_t* config, void* udat
 	if (sb->lonely_buffer_count_till_decay <= 0) sb->lonely_buffer_count_till_decay = 1;
 	sb->ratio_to_decay_atlas = config->ratio_to_decay_atlas;
 	sb->ratio_to_merge_atlases = config->ratio_to_merge_atlases;
+	sb->atlas_packing = config->atlas_packing;
+	sb->atlases_built = 0;
+	sb->atlases_flushed = 0;
 	sb->batch_callback = config->batch_callback;
 	sb->get_pixels_callback = config->get_pixels_callback;
 	sb->generate_texture_callback = config->generate_texture_callback;
 	sb->delete_texture_callback = config->delete_texture_callback;
 	sb->sprites_sorter_callback = config->sprites_sorter_callback;
+	sb->build_atlas_callback = config->build_atlas_callback;
 	sb->mem_ctx = config->allocator_context;
 	sb->udata = udata;
 
@@ -990,15 +1060,18 @@ int spritebatch_init(spritebatch_t* sb, spritebatch_config_t* config, void* udat
 	sb->sprites = (spritebatch_sprite_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_sprite_t) * sb->sprite_capacity, sb->mem_ctx);
 
 	sb->sprites_scratch = 0;
+	sb->sort_buffer = 0;
 	if (sprite_batch_internal_use_scratch_buffer(sb))
 	{
 		sb->sprites_scratch = (spritebatch_sprite_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_sprite_t) * sb->sprite_capacity, sb->mem_ctx);
+		sb->sort_buffer = SPRITEBATCH_MALLOC(SPRITEBATCH_INTERNAL_SORT_BYTES_PER_SPRITE * sb->sprite_capacity, sb->mem_ctx);
 	}
 	if (!sb->sprites) return 1;
 
 	if (sprite_batch_internal_use_scratch_buffer(sb))
 	{
 		if (!sb->sprites_scratch) return 1;
+		if (!sb->sort_buffer) return 1;
 	}
 
 	// initialize key buffer (for marking hash table entries for deletion)
@@ -1027,6 +1100,10 @@ void spritebatch_term(spritebatch_t* sb)
 	{
 		SPRITEBATCH_FREE(sb->sprites_scratch, sb->mem_ctx);
 	}
+	if (sb->sort_buffer)
+	{
+		SPRITEBATCH_FREE(sb->sort_buffer, sb->mem_ctx);
+	}
 	SPRITEBATCH_FREE(sb->key_buffer, sb->mem_ctx);
 	SPRITEBATCH_FREE(sb->pixel_buffer, ctx->mem_ctx);
 	hashtable_term(&sb->sprites_to_lonely_textures);
@@ -1068,10 +1145,12 @@ void spritebatch_set_default_config(spritebatch_config_t* config)
 	config->lonely_buffer_count_till_flush = 64;
 	config->ratio_to_decay_atlas = 0.5f;
 	config->ratio_to_merge_atlases = 0.25f;
+	config->atlas_packing = SPRITEBATCH_ATLAS_PACKING_BEST_FIT;
 	config->batch_callback = 0;
 	config->generate_texture_callback = 0;
 	config->delete_texture_callback = 0;
 	config->sprites_sorter_callback = 0;
+	config->build_atlas_callback = 0;
 	config->allocator_context = 0;
 }
 
@@ -1089,26 +1168,53 @@ void spritebatch_set_default_config(spritebatch_config_t* config)
 		} \
 	} while (0)
 
-int spritebatch_push(spritebatch_t* sb, spritebatch_sprite_t sprite)
+static inline void spritebatch_internal_push_input(spritebatch_t* sb, const spritebatch_sprite_t* sprite)
 {
-	SPRITEBATCH_ASSERT(sprite.w <= sb->atlas_width_in_pixels);
-	SPRITEBATCH_ASSERT(sprite.h <= sb->atlas_height_in_pixels);
-	SPRITEBATCH_CHECK_BUFFER_GROW(sb, input_count, input_capacity, input_buffer, spritebatch_internal_sprite_t);
+	SPRITEBATCH_ASSERT(sprite->w <= sb->atlas_width_in_pixels);
+	SPRITEBATCH_ASSERT(sprite->h <= sb->atlas_height_in_pixels);
 	spritebatch_internal_sprite_t sprite_out;
-	sprite_out.image_id = sprite.image_id;
-	sprite_out.sort_bits = sprite.sort_bits;
-	sprite_out.w = sprite.w;
-	sprite_out.h = sprite.h;
-	sprite_out.x = sprite.x;
-	sprite_out.y = sprite.y;
-	sprite_out.sx = sprite.sx + (sb->atlas_use_border_pixels ? (sprite.sx / (float)sprite.w) * 2.0f : 0);
-	sprite_out.sy = sprite.sy + (sb->atlas_use_border_pixels ? (sprite.sy / (float)sprite.h) * 2.0f : 0);
-	sprite_out.c = sprite.c;
-	sprite_out.s = sprite.s;
+	sprite_out.image_id = sprite->image_id;
+	sprite_out.sort_bits = sprite->sort_bits;
+	sprite_out.w = sprite->w;
+	sprite_out.h = sprite->h;
+	sprite_out.x = sprite->x;
+	sprite_out.y = sprite->y;
+	sprite_out.sx = sprite->sx + (sb->atlas_use_border_pixels ? (sprite->sx / (float)sprite->w) * 2.0f : 0);
+	sprite_out.sy = sprite->sy + (sb->atlas_use_border_pixels ? (sprite->sy / (float)sprite->h) * 2.0f : 0);
+	sprite_out.c = sprite->c;
+	sprite_out.s = sprite->s;
 #ifdef SPRITEBATCH_SPRITE_USERDATA
-	sprite_out.udata = sprite.udata;
+	sprite_out.udata = sprite->udata;
 #endif
 	sb->input_buffer[sb->input_count++] = sprite_out;
+}
+
+int spritebatch_push(spritebatch_t* sb, spritebatch_sprite_t sprite)
+{
+	SPRITEBATCH_CHECK_BUFFER_GROW(sb, input_count, input_capacity, input_buffer, spritebatch_internal_sprite_t);
+	spritebatch_internal_push_input(sb, &sprite);
+	return 1;
+}
+
+int spritebatch_push_many(spritebatch_t* sb, const spritebatch_sprite_t* sprites, int count)
+{
+	if (sb->input_count + count > sb->input_capacity)
+	{
+		int new_capacity = sb->input_capacity * 2;
+		if (new_capacity < sb->input_count + count) new_capacity = sb->input_count + count;
+		void* new_data = SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_sprite_t) * new_capacity, sb->mem_ctx);
+		if (!new_data) return 0;
+		SPRITEBATCH_MEMCPY(new_data, sb->input_buffer, sizeof(spritebatch_internal_sprite_t) * sb->input_count);
+		SPRITEBATCH_FREE(sb->input_buffer, sb->mem_ctx);
+		sb->input_buffer = (spritebatch_internal_sprite_t*)new_data;
+		sb->input_capacity = new_capacity;
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		spritebatch_internal_push_input(sb, sprites + i);
+	}
+
 	return 1;
 }
 
@@ -1185,26 +1291,110 @@ void spritebatch_internal_merge_sort(spritebatch_sprite_t* a, spritebatch_sprite
 	spritebatch_internal_merge_sort_recurse(b, 0, n, a);
 }
 
+// Stable LSD radix sort, ordering the same way as `spritebatch_internal_merge_sort`. Each sprite gets a
+// 64-bit key of `sort_bits` (high half) and the low 32 bits of `texture_id` (low half), and only the keys
+// and sprite indices are moved around during the passes. The sprites themselves are copied just once at
+// the end, from `sprites` into `out`. `sort_buffer` must hold `SPRITEBATCH_INTERNAL_SORT_BYTES_PER_SPRITE * n`
+// bytes.
+void spritebatch_internal_radix_sort(spritebatch_sprite_t* sprites, spritebatch_sprite_t* out, void* sort_buffer, int n)
+{
+	SPRITEBATCH_U64* keys = (SPRITEBATCH_U64*)sort_buffer;
+	SPRITEBATCH_U64* keys_scratch = keys + n;
+	int* indices = (int*)(keys_scratch + n);
+	int* indices_scratch = indices + n;
+	if (n <= 0) return;
+	int counts[8][256];
+	SPRITEBATCH_MEMSET(counts, 0, sizeof(counts));
+
+	SPRITEBATCH_U64 min_key = ~0ULL, max_key = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		// flipping the sign bit orders negative sort bits before positive ones when compared unsigned
+		SPRITEBATCH_U64 key = ((SPRITEBATCH_U64)((unsigned)sprites[i].sort_bits ^ 0x80000000u) << 32) | (SPRITEBATCH_U64)(unsigned)sprites[i].texture_id;
+		keys[i] = key;
+		indices[i] = i;
+		if (key < min_key) min_key = key;
+		if (key > max_key) max_key = key;
+	}
+
+	// keys relative to the smallest one only need as many digits as the range spans, so a few layers
+	// straddling zero or a handful of textures take one or two passes instead of eight
+	int pass_count = 0;
+	for (SPRITEBATCH_U64 range = max_key - min_key; range; range >>= 8) ++pass_count;
+	for (int i = 0; i < n; ++i)
+	{
+		SPRITEBATCH_U64 key = keys[i] - min_key;
+		keys[i] = key;
+		for (int pass = 0; pass < pass_count; ++pass) counts[pass][(key >> (pass * 8)) & 0xFF]++;
+	}
+
+	for (int pass = 0; pass < pass_count; ++pass)
+	{
+		int* count = counts[pass];
+		int shift = pass * 8;
+
+		// skip digits shared by all keys
+		if (count[(keys[0] >> shift) & 0xFF] == n) continue;
+
+		int offset = 0;
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			int c = count[digit];
+			count[digit] = offset;
+			offset += c;
+		}
+
+		for (int i = 0; i < n; ++i)
+		{
+			SPRITEBATCH_U64 key = keys[i];
+			int index = count[(key >> shift) & 0xFF]++;
+			keys_scratch[index] = key;
+			indices_scratch[index] = indices[i];
+		}
+
+		SPRITEBATCH_U64* keys_temp = keys;
+		keys = keys_scratch;
+		keys_scratch = keys_temp;
+		int* indices_temp = indices;
+		indices = indices_scratch;
+		indices_scratch = indices_temp;
+	}
+
+	for (int i = 0; i < n; ++i) out[i] = sprites[indices[i]];
+}
+
 void spritebatch_internal_sort_sprites(spritebatch_t* sb)
 {
 	if (sb->sprites_sorter_callback) sb->sprites_sorter_callback(sb->sprites, sb->sprite_count);
-	else spritebatch_internal_merge_sort(sb->sprites, sb->sprites_scratch, sb->sprite_count);
+	else
+	{
+		spritebatch_internal_radix_sort(sb->sprites, sb->sprites_scratch, sb->sort_buffer, sb->sprite_count);
+		spritebatch_sprite_t* sorted = sb->sprites_scratch;
+		sb->sprites_scratch = sb->sprites;
+		sb->sprites = sorted;
+	}
 }
 
-static inline void spritebatch_internal_get_pixels(spritebatch_t* sb, SPRITEBATCH_U64 image_id, int w, int h)
+// Fetches the pixels of an image into `*pixel_buffer`, growing it as needed. Only reads the config
+// and callbacks of `sb`, so atlas jobs can call this from any thread with their own buffer.
+static inline void spritebatch_internal_get_pixels_into(spritebatch_t* sb, void** pixel_buffer, int* pixel_buffer_size, SPRITEBATCH_U64 image_id, int w, int h)
 {
 	int size = sb->atlas_use_border_pixels ? sb->pixel_stride * (w + 2) * (h + 2) : sb->pixel_stride * w * h;
-	if (size > sb->pixel_buffer_size)
+	if (size > *pixel_buffer_size)
 	{
-		SPRITEBATCH_FREE(sb->pixel_buffer, ctx->mem_ctx);
-		sb->pixel_buffer_size = size;
-		sb->pixel_buffer = SPRITEBATCH_MALLOC(sb->pixel_buffer_size, ctx->mem_ctx);
-		if (!sb->pixel_buffer) return;
+		SPRITEBATCH_FREE(*pixel_buffer, sb->mem_ctx);
+		*pixel_buffer_size = size;
+		*pixel_buffer = SPRITEBATCH_MALLOC(size, sb->mem_ctx);
+		if (!*pixel_buffer)
+		{
+			*pixel_buffer_size = 0;
+			return;
+		}
 	}
 
-	SPRITEBATCH_MEMSET(sb->pixel_buffer, 0, size);
+	SPRITEBATCH_MEMSET(*pixel_buffer, 0, size);
 	int size_from_user = sb->pixel_stride * w * h;
-	sb->get_pixels_callback(image_id, sb->pixel_buffer, size_from_user, sb->udata);
+	sb->get_pixels_callback(image_id, *pixel_buffer, size_from_user, sb->udata);
 
 	if (sb->atlas_use_border_pixels) {
 		// Expand image from top-left corner, offset by (1, 1).
@@ -1212,7 +1402,7 @@ static inline void spritebatch_internal_get_pixels(spritebatch_t* sb, SPRITEBATC
 		int h0 = h;
 		w += 2;
 		h += 2;
-		char* buffer = (char*)sb->pixel_buffer;
+		char* buffer = (char*)*pixel_buffer;
 		int dst_row_stride = w * sb->pixel_stride;
 		int src_row_stride = w0 * sb->pixel_stride;
 		int src_row_offset = sb->pixel_stride;
@@ -1235,6 +1425,11 @@ static inline void spritebatch_internal_get_pixels(spritebatch_t* sb, SPRITEBATC
 	}
 }
 
+static inline void spritebatch_internal_get_pixels(spritebatch_t* sb, SPRITEBATCH_U64 image_id, int w, int h)
+{
+	spritebatch_internal_get_pixels_into(sb, &sb->pixel_buffer, &sb->pixel_buffer_size, image_id, w, h);
+}
+
 static inline SPRITEBATCH_U64 spritebatch_internal_generate_texture_handle(spritebatch_t* sb, SPRITEBATCH_U64 image_id, int w, int h)
 {
 	spritebatch_internal_get_pixels(sb, image_id, w, h);
@@ -1253,6 +1448,7 @@ spritebatch_internal_lonely_texture_t* spritebatch_internal_lonelybuffer_push(sp
 	texture.w = w;
 	texture.h = h;
 	texture.image_id = image_id;
+	texture.pending = 0;
 	texture.texture_id = make_tex ? spritebatch_internal_generate_texture_handle(sb, image_id, w, h) : ~0;
 	return (spritebatch_internal_lonely_texture_t*)hashtable_insert(&sb->sprites_to_lonely_textures, image_id, &texture);
 }
@@ -1343,9 +1539,15 @@ int spritebatch_internal_push_sprite(spritebatch_t* sb, spritebatch_internal_spr
 				SPRITEBATCH_FREE(sb->sprites_scratch, sb->mem_ctx);
 			}
 
+			if (sb->sort_buffer)
+			{
+				SPRITEBATCH_FREE(sb->sort_buffer, sb->mem_ctx);
+			}
+
 			if (sprite_batch_internal_use_scratch_buffer(sb))
 			{
 				sb->sprites_scratch = (spritebatch_sprite_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_sprite_t) * new_capacity, sb->mem_ctx);
+				sb->sort_buffer = SPRITEBATCH_MALLOC(SPRITEBATCH_INTERNAL_SORT_BYTES_PER_SPRITE * new_capacity, sb->mem_ctx);
 			}
 		}
 		sb->sprites[sb->sprite_count++] = sprite;
@@ -1586,41 +1788,15 @@ typedef struct
 
 #define SPRITEBATCH_CHECK( X, Y ) do { if ( !(X) ) { SPRITEBATCH_LOG(Y); goto sb_err; } } while ( 0 )
 
-void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atlas_out, const spritebatch_internal_lonely_texture_t* imgs, int img_count)
+static int spritebatch_internal_pack_best_fit(spritebatch_internal_integer_image_t* images, int img_count, int atlas_width, int atlas_height, void* mem_ctx)
 {
-	float w0, h0, div, wTol, hTol;
-	int atlas_image_size, atlas_stride, sp;
-	void* atlas_pixels = 0;
 	int atlas_node_capacity = img_count * 2;
-	spritebatch_internal_integer_image_t* images = 0;
-	spritebatch_internal_integer_image_t* images_scratch = 0;
-	spritebatch_internal_atlas_node_t* nodes = 0;
-	int pixel_stride = sb->pixel_stride;
-	int atlas_width = sb->atlas_width_in_pixels;
-	int atlas_height = sb->atlas_height_in_pixels;
-	float volume_used = 0;
-
-	images = (spritebatch_internal_integer_image_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_integer_image_t) * img_count, sb->mem_ctx);
-	images_scratch = (spritebatch_internal_integer_image_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_integer_image_t) * img_count, sb->mem_ctx);
-	nodes = (spritebatch_internal_atlas_node_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_atlas_node_t) * atlas_node_capacity, sb->mem_ctx);
-	SPRITEBATCH_CHECK(images, "out of mem");
-	SPRITEBATCH_CHECK(nodes, "out of mem");
-
-	for (int i = 0; i < img_count; ++i)
-	{
-		const spritebatch_internal_lonely_texture_t* img = imgs + i;
-		spritebatch_internal_integer_image_t* image = images + i;
-		image->fit = 0;
-		image->size = sb->atlas_use_border_pixels ? spritebatch_v2(img->w + 2, img->h + 2) : spritebatch_v2(img->w, img->h);
-		image->img_index = i;
-	}
-
-	// Sort PNGs from largest to smallest
-	spritebatch_internal_image_merge_sort(images, images_scratch, img_count);
+	spritebatch_internal_atlas_node_t* nodes = (spritebatch_internal_atlas_node_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_atlas_node_t) * atlas_node_capacity, mem_ctx);
+	if (!nodes) return 0;
 
 	// stack pointer, the stack is the nodes array which we will
 	// allocate nodes from as necessary.
-	sp = 1;
+	int sp = 1;
 
 	nodes[0].min = spritebatch_v2(0, 0);
 	nodes[0].max = spritebatch_v2(atlas_width, atlas_height);
@@ -1659,10 +1835,16 @@ void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atl
 		{
 			int new_capacity = atlas_node_capacity * 2;
 			spritebatch_internal_atlas_node_t* new_nodes = (spritebatch_internal_atlas_node_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_atlas_node_t) * new_capacity, mem_ctx);
-			SPRITEBATCH_CHECK(new_nodes, "out of mem");
-			memcpy(new_nodes, nodes, sizeof(spritebatch_internal_atlas_node_t) * sp);
+			if (!new_nodes)
+			{
+				SPRITEBATCH_FREE(nodes, mem_ctx);
+				return 0;
+			}
+			int best_fit_index = (int)(best_fit - nodes);
+			SPRITEBATCH_MEMCPY(new_nodes, nodes, sizeof(spritebatch_internal_atlas_node_t) * sp);
 			SPRITEBATCH_FREE(nodes, mem_ctx);
 			nodes = new_nodes;
+			best_fit = nodes + best_fit_index;
 			atlas_node_capacity = new_capacity;
 		}
 
@@ -1695,11 +1877,325 @@ void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atl
 		new_node->max = spritebatch_add(new_node->min, new_node->size);
 	}
 
+	SPRITEBATCH_FREE(nodes, mem_ctx);
+	return 1;
+}
+
+typedef struct
+{
+	int x, y, w;
+} spritebatch_internal_skyline_segment_t;
+
+static int spritebatch_internal_pack_skyline(spritebatch_internal_integer_image_t* images, int img_count, int atlas_width, int atlas_height, void* mem_ctx)
+{
+	// Each placement adds at most one segment to the skyline, segments are kept sorted by x and always
+	// span the full atlas width.
+	spritebatch_internal_skyline_segment_t* segments = (spritebatch_internal_skyline_segment_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_skyline_segment_t) * (img_count + 1), mem_ctx);
+	if (!segments) return 0;
+	int count = 1;
+	segments[0].x = 0;
+	segments[0].y = 0;
+	segments[0].w = atlas_width;
+
+	for (int i = 0; i < img_count; ++i)
+	{
+		spritebatch_internal_integer_image_t* image = images + i;
+		int width = image->size.x;
+		int height = image->size.y;
+
+		// Bottom-left rule, rest the image on the skyline where its top edge ends up lowest.
+		int best = -1;
+		int best_y = 0;
+		int best_top = INT_MAX;
+		for (int j = 0; j < count; ++j)
+		{
+			int x = segments[j].x;
+			if (x + width > atlas_width) break;
+			int y = 0;
+			int width_left = width;
+			for (int k = j; width_left > 0; ++k)
+			{
+				if (segments[k].y > y) y = segments[k].y;
+				width_left -= segments[k].w;
+			}
+			if (y + height > atlas_height) continue;
+			if (y + height < best_top)
+			{
+				best = j;
+				best_y = y;
+				best_top = y + height;
+			}
+		}
+
+		if (best < 0) {
+			image->fit = 0;
+			continue;
+		}
+
+		image->fit = 1;
+		image->min = spritebatch_v2(segments[best].x, best_y);
+		image->max = spritebatch_add(image->min, image->size);
+
+		// Drop or shorten the segments now underneath the image.
+		int end = image->max.x;
+		int j = best;
+		while (j < count && segments[j].x < end)
+		{
+			int segment_end = segments[j].x + segments[j].w;
+			if (segment_end <= end)
+			{
+				SPRITEBATCH_MEMMOVE(segments + j, segments + j + 1, sizeof(spritebatch_internal_skyline_segment_t) * (count - j - 1));
+				--count;
+			}
+			else
+			{
+				segments[j].w = segment_end - end;
+				segments[j].x = end;
+				break;
+			}
+		}
+
+		// Put the top of the image in their place.
+		SPRITEBATCH_MEMMOVE(segments + best + 1, segments + best, sizeof(spritebatch_internal_skyline_segment_t) * (count - best));
+		segments[best].x = image->min.x;
+		segments[best].y = image->max.y;
+		segments[best].w = width;
+		++count;
+
+		// Merge neighbours of equal height.
+		for (j = 0; j < count - 1;)
+		{
+			if (segments[j].y == segments[j + 1].y)
+			{
+				segments[j].w += segments[j + 1].w;
+				SPRITEBATCH_MEMMOVE(segments + j + 1, segments + j + 2, sizeof(spritebatch_internal_skyline_segment_t) * (count - j - 2));
+				--count;
+			}
+			else ++j;
+		}
+	}
+
+	SPRITEBATCH_FREE(segments, mem_ctx);
+	return 1;
+}
+
+typedef struct
+{
+	int x, y, w, h;
+} spritebatch_internal_rect_t;
+
+static int spritebatch_internal_rect_contains(spritebatch_internal_rect_t a, spritebatch_internal_rect_t b)
+{
+	return b.x >= a.x && b.y >= a.y && b.x + b.w <= a.x + a.w && b.y + b.h <= a.y + a.h;
+}
+
+static int spritebatch_internal_pack_maxrects(spritebatch_internal_integer_image_t* images, int img_count, int atlas_width, int atlas_height, void* mem_ctx)
+{
+	// Placing an image splits every free rectangle it overlaps into up to four, so the split results go
+	// into a second list, and the two lists swap roles.
+	int capacity = 64;
+	spritebatch_internal_rect_t* free_rects = (spritebatch_internal_rect_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_rect_t) * capacity, mem_ctx);
+	spritebatch_internal_rect_t* split_rects = (spritebatch_internal_rect_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_rect_t) * capacity, mem_ctx);
+	int result = 0;
+	int count = 1;
+	if (!free_rects || !split_rects) goto sb_maxrects_done;
+	free_rects[0].x = 0;
+	free_rects[0].y = 0;
+	free_rects[0].w = atlas_width;
+	free_rects[0].h = atlas_height;
+
+	for (int i = 0; i < img_count; ++i)
+	{
+		spritebatch_internal_integer_image_t* image = images + i;
+		int width = image->size.x;
+		int height = image->size.y;
+
+		// Best short side fit.
+		int best = -1;
+		int best_short = INT_MAX;
+		int best_long = INT_MAX;
+		for (int j = 0; j < count; ++j)
+		{
+			spritebatch_internal_rect_t r = free_rects[j];
+			if (r.w < width || r.h < height) continue;
+			int dx = r.w - width;
+			int dy = r.h - height;
+			int short_side = dx < dy ? dx : dy;
+			int long_side = dx < dy ? dy : dx;
+			if (short_side < best_short || (short_side == best_short && long_side < best_long))
+			{
+				best = j;
+				best_short = short_side;
+				best_long = long_side;
+			}
+		}
+
+		if (best < 0) {
+			image->fit = 0;
+			continue;
+		}
+
+		spritebatch_internal_rect_t placed;
+		placed.x = free_rects[best].x;
+		placed.y = free_rects[best].y;
+		placed.w = width;
+		placed.h = height;
+		image->fit = 1;
+		image->min = spritebatch_v2(placed.x, placed.y);
+		image->max = spritebatch_add(image->min, image->size);
+
+		if (count * 4 > capacity)
+		{
+			int new_capacity = capacity * 2;
+			while (count * 4 > new_capacity) new_capacity *= 2;
+			SPRITEBATCH_FREE(split_rects, mem_ctx);
+			split_rects = (spritebatch_internal_rect_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_rect_t) * new_capacity, mem_ctx);
+			spritebatch_internal_rect_t* new_free_rects = (spritebatch_internal_rect_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_rect_t) * new_capacity, mem_ctx);
+			if (!split_rects || !new_free_rects)
+			{
+				SPRITEBATCH_FREE(new_free_rects, mem_ctx);
+				goto sb_maxrects_done;
+			}
+			SPRITEBATCH_MEMCPY(new_free_rects, free_rects, sizeof(spritebatch_internal_rect_t) * count);
+			SPRITEBATCH_FREE(free_rects, mem_ctx);
+			free_rects = new_free_rects;
+			capacity = new_capacity;
+		}
+
+		int split_count = 0;
+		for (int j = 0; j < count; ++j)
+		{
+			spritebatch_internal_rect_t r = free_rects[j];
+			int overlaps = placed.x < r.x + r.w && placed.x + placed.w > r.x && placed.y < r.y + r.h && placed.y + placed.h > r.y;
+			if (!overlaps)
+			{
+				split_rects[split_count++] = r;
+				continue;
+			}
+
+			spritebatch_internal_rect_t piece;
+			if (placed.x > r.x)
+			{
+				piece = r;
+				piece.w = placed.x - r.x;
+				split_rects[split_count++] = piece;
+			}
+			if (placed.x + placed.w < r.x + r.w)
+			{
+				piece = r;
+				piece.x = placed.x + placed.w;
+				piece.w = r.x + r.w - piece.x;
+				split_rects[split_count++] = piece;
+			}
+			if (placed.y > r.y)
+			{
+				piece = r;
+				piece.h = placed.y - r.y;
+				split_rects[split_count++] = piece;
+			}
+			if (placed.y + placed.h < r.y + r.h)
+			{
+				piece = r;
+				piece.y = placed.y + placed.h;
+				piece.h = r.y + r.h - piece.y;
+				split_rects[split_count++] = piece;
+			}
+		}
+
+		// Only keep maximal rectangles.
+		for (int j = 0; j < split_count; ++j)
+		{
+			for (int k = 0; k < split_count; ++k)
+			{
+				if (j == k) continue;
+				if (spritebatch_internal_rect_contains(split_rects[k], split_rects[j]))
+				{
+					split_rects[j--] = split_rects[--split_count];
+					break;
+				}
+			}
+		}
+
+		spritebatch_internal_rect_t* tmp = free_rects;
+		free_rects = split_rects;
+		split_rects = tmp;
+		count = split_count;
+	}
+
+	result = 1;
+
+sb_maxrects_done:
+	SPRITEBATCH_FREE(free_rects, mem_ctx);
+	SPRITEBATCH_FREE(split_rects, mem_ctx);
+	return result;
+}
+
+// Places `images` within an atlas, setting `fit`, `min` and `max` of each. Returns 0 when out of memory.
+int spritebatch_internal_pack_rects(spritebatch_atlas_packing_t packing, spritebatch_internal_integer_image_t* images, int img_count, int atlas_width, int atlas_height, void* mem_ctx)
+{
+	switch (packing)
+	{
+	case SPRITEBATCH_ATLAS_PACKING_SKYLINE: return spritebatch_internal_pack_skyline(images, img_count, atlas_width, atlas_height, mem_ctx);
+	case SPRITEBATCH_ATLAS_PACKING_MAXRECTS: return spritebatch_internal_pack_maxrects(images, img_count, atlas_width, atlas_height, mem_ctx);
+	default: return spritebatch_internal_pack_best_fit(images, img_count, atlas_width, atlas_height, mem_ctx);
+	}
+}
+
+struct spritebatch_atlas_job_t
+{
+	spritebatch_t* sb;
+	spritebatch_atlas_packing_t packing;
+	int img_count;
+	spritebatch_internal_lonely_texture_t* imgs;
+	spritebatch_internal_integer_image_t* images; // packing results, sorted from largest to smallest
+	void* atlas_pixels;
+	void* pixel_buffer;
+	int pixel_buffer_size;
+	int failed;
+};
+
+// Packs `job->imgs` into an atlas and writes out the atlas pixels. Only reads the config and callbacks
+// of `sb`, see `build_atlas_fn`.
+static void spritebatch_internal_pack_atlas(spritebatch_atlas_job_t* job)
+{
+	spritebatch_t* sb = job->sb;
+	const spritebatch_internal_lonely_texture_t* imgs = job->imgs;
+	int img_count = job->img_count;
+	int atlas_image_size, atlas_stride;
+	void* atlas_pixels = 0;
+	spritebatch_internal_integer_image_t* images = 0;
+	spritebatch_internal_integer_image_t* images_scratch = 0;
+	int pixel_stride = sb->pixel_stride;
+	int atlas_width = sb->atlas_width_in_pixels;
+	int atlas_height = sb->atlas_height_in_pixels;
+
+	job->failed = 1;
+	images = (spritebatch_internal_integer_image_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_integer_image_t) * img_count, sb->mem_ctx);
+	images_scratch = (spritebatch_internal_integer_image_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_integer_image_t) * img_count, sb->mem_ctx);
+	job->images = images;
+	SPRITEBATCH_CHECK(images, "out of mem");
+	SPRITEBATCH_CHECK(images_scratch, "out of mem");
+
+	for (int i = 0; i < img_count; ++i)
+	{
+		const spritebatch_internal_lonely_texture_t* img = imgs + i;
+		spritebatch_internal_integer_image_t* image = images + i;
+		image->fit = 0;
+		image->size = sb->atlas_use_border_pixels ? spritebatch_v2(img->w + 2, img->h + 2) : spritebatch_v2(img->w, img->h);
+		image->img_index = i;
+	}
+
+	// Sort PNGs from largest to smallest
+	spritebatch_internal_image_merge_sort(images, images_scratch, img_count);
+
+	SPRITEBATCH_CHECK(spritebatch_internal_pack_rects(job->packing, images, img_count, atlas_width, atlas_height, sb->mem_ctx), "out of mem");
+
 	// Write the final atlas image, use SPRITEBATCH_ATLAS_EMPTY_COLOR as base color
 	atlas_stride = atlas_width * pixel_stride;
 	atlas_image_size = atlas_width * atlas_height * pixel_stride;
 	atlas_pixels = SPRITEBATCH_MALLOC(atlas_image_size, mem_ctx);
-	SPRITEBATCH_CHECK(atlas_image_size, "out of mem");
+	job->atlas_pixels = atlas_pixels;
+	SPRITEBATCH_CHECK(atlas_pixels, "out of mem");
 	SPRITEBATCH_MEMSET(atlas_pixels, SPRITEBATCH_ATLAS_EMPTY_COLOR, atlas_image_size);
 
 	for (int i = 0; i < img_count; ++i)
@@ -1709,8 +2205,9 @@ void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atl
 		if (image->fit)
 		{
 			const spritebatch_internal_lonely_texture_t* img = imgs + image->img_index;
-			spritebatch_internal_get_pixels(sb, img->image_id, img->w, img->h);
-			char* pixels = (char*)sb->pixel_buffer;
+			spritebatch_internal_get_pixels_into(sb, &job->pixel_buffer, &job->pixel_buffer_size, img->image_id, img->w, img->h);
+			char* pixels = (char*)job->pixel_buffer;
+			SPRITEBATCH_CHECK(pixels, "out of mem");
 
 			spritebatch_v2_t min = image->min;
 			spritebatch_v2_t max = image->max;
@@ -1725,8 +2222,24 @@ void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atl
 		}
 	}
 
-	hashtable_init(&atlas_out->sprites_to_textures, sizeof(spritebatch_internal_texture_t), img_count, sb->mem_ctx);
-	atlas_out->texture_id = sb->generate_texture_callback(atlas_pixels, atlas_width, atlas_height, sb->udata);
+	job->failed = 0;
+
+sb_err:
+	SPRITEBATCH_FREE(images_scratch, mem_ctx);
+	return;
+}
+
+// Fills out `atlas_out` from a packed job and makes its texture. With `skip_mapped_images` set, images
+// that went into another atlas while the job was running are left out of this one.
+static void spritebatch_internal_fill_atlas(spritebatch_atlas_job_t* job, spritebatch_internal_atlas_t* atlas_out, int skip_mapped_images)
+{
+	spritebatch_t* sb = job->sb;
+	float w0, h0, div, wTol, hTol;
+	int atlas_width = sb->atlas_width_in_pixels;
+	int atlas_height = sb->atlas_height_in_pixels;
+	float volume_used = 0;
+
+	hashtable_init(&atlas_out->sprites_to_textures, sizeof(spritebatch_internal_texture_t), job->img_count, sb->mem_ctx);
 
 	// squeeze UVs inward by 128th of a pixel
 	// this prevents atlas bleeding. tune as necessary for good results.
@@ -1736,12 +2249,15 @@ void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atl
 	wTol = w0 * div;
 	hTol = h0 * div;
 
-	for (int i = 0; i < img_count; ++i)
+	for (int i = 0; i < job->img_count; ++i)
 	{
-		spritebatch_internal_integer_image_t* img = images + i;
+		spritebatch_internal_integer_image_t* img = job->images + i;
 
 		if (img->fit)
 		{
+			SPRITEBATCH_U64 image_id = job->imgs[img->img_index].image_id;
+			if (skip_mapped_images && hashtable_find(&sb->sprites_to_atlases, image_id)) continue;
+
 			spritebatch_v2_t min = img->min;
 			spritebatch_v2_t max = img->max;
 			volume_used += img->size.x * img->size.y;
@@ -1773,26 +2289,55 @@ void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atl
 			SPRITEBATCH_ASSERT(!(max_x < 0));
 			SPRITEBATCH_ASSERT(!(min_y < 0));
 			SPRITEBATCH_ASSERT(!(max_y < 0));
-			texture.image_id = imgs[img->img_index].image_id;
+			texture.image_id = image_id;
 			hashtable_insert(&atlas_out->sprites_to_textures, texture.image_id, &texture);
 		}
 	}
 
-	// Need to adjust atlas_width and atlas_height in config params, as none of the images for this
-	// atlas actually fit inside of the atlas! Either adjust the config, or stop sending giant images
-	// to the sprite batcher.
-	SPRITEBATCH_ASSERT(volume_used > 0);
-
+	atlas_out->texture_id = volume_used > 0 ? sb->generate_texture_callback(job->atlas_pixels, atlas_width, atlas_height, sb->udata) : (SPRITEBATCH_U64)~0ULL;
 	atlas_out->volume_ratio = volume_used / (atlas_width * atlas_height);
+}
 
-sb_err:
-	// no specific error handling needed here (yet)
+static void spritebatch_internal_free_atlas_job_buffers(spritebatch_atlas_job_t* job)
+{
+	SPRITEBATCH_FREE(job->atlas_pixels, job->sb->mem_ctx);
+	SPRITEBATCH_FREE(job->images, job->sb->mem_ctx);
+	job->atlas_pixels = 0;
+	job->images = 0;
+}
 
-	SPRITEBATCH_FREE(atlas_pixels, mem_ctx);
-	SPRITEBATCH_FREE(nodes, mem_ctx);
-	SPRITEBATCH_FREE(images, mem_ctx);
-	SPRITEBATCH_FREE(images_scratch, mem_ctx);
-	return;
+void spritebatch_make_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atlas_out, const spritebatch_internal_lonely_texture_t* imgs, int img_count)
+{
+	spritebatch_atlas_job_t job;
+	SPRITEBATCH_MEMSET(&job, 0, sizeof(job));
+	job.sb = sb;
+	job.packing = sb->atlas_packing;
+	job.img_count = img_count;
+	job.imgs = (spritebatch_internal_lonely_texture_t*)imgs;
+	job.pixel_buffer = sb->pixel_buffer;
+	job.pixel_buffer_size = sb->pixel_buffer_size;
+
+	spritebatch_internal_pack_atlas(&job);
+	sb->pixel_buffer = job.pixel_buffer;
+	sb->pixel_buffer_size = job.pixel_buffer_size;
+
+	if (!job.failed)
+	{
+		spritebatch_internal_fill_atlas(&job, atlas_out, 0);
+		sb->atlases_built++;
+
+		// Need to adjust atlas_width and atlas_height in config params, as none of the images for this
+		// atlas actually fit inside of the atlas! Either adjust the config, or stop sending giant images
+		// to the sprite batcher.
+		SPRITEBATCH_ASSERT(atlas_out->volume_ratio > 0);
+	}
+
+	spritebatch_internal_free_atlas_job_buffers(&job);
+}
+
+void spritebatch_atlas_job_run(spritebatch_atlas_job_t* job)
+{
+	spritebatch_internal_pack_atlas(job);
 }
 
 static int spritebatch_internal_lonely_pred(spritebatch_internal_lonely_texture_t* a, spritebatch_internal_lonely_texture_t* b)
@@ -1886,6 +2431,7 @@ void spritebatch_internal_flush_atlas(spritebatch_t* sb, spritebatch_internal_at
 	hashtable_term(&atlas->sprites_to_textures);
 	sb->delete_texture_callback(atlas->texture_id, sb->udata);
 	SPRITEBATCH_FREE(atlas, sb->mem_ctx);
+	sb->atlases_flushed++;
 }
 
 void spritebatch_internal_log_chain(spritebatch_internal_atlas_t* atlas)
@@ -1904,6 +2450,104 @@ void spritebatch_internal_log_chain(spritebatch_internal_atlas_t* atlas)
 	}
 }
 
+static void spritebatch_internal_link_atlas(spritebatch_t* sb, spritebatch_internal_atlas_t* atlas)
+{
+	if (sb->atlases)
+	{
+		atlas->prev = sb->atlases;
+		atlas->next = sb->atlases->next;
+		sb->atlases->next->prev = atlas;
+		sb->atlases->next = atlas;
+	}
+
+	else
+	{
+		atlas->next = atlas;
+		atlas->prev = atlas;
+		sb->atlases = atlas;
+	}
+}
+
+// Hands all lonely textures not already waiting on a job over to `build_atlas_callback`.
+static void spritebatch_internal_queue_atlas_job(spritebatch_t* sb)
+{
+	int lonely_count = hashtable_count(&sb->sprites_to_lonely_textures);
+	spritebatch_internal_lonely_texture_t* lonely_textures = (spritebatch_internal_lonely_texture_t*)hashtable_items(&sb->sprites_to_lonely_textures);
+	int img_count = 0;
+	for (int i = 0; i < lonely_count; ++i) if (!lonely_textures[i].pending) img_count++;
+	if (img_count <= sb->lonely_buffer_count_till_flush) return;
+
+	spritebatch_atlas_job_t* job = (spritebatch_atlas_job_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_atlas_job_t), sb->mem_ctx);
+	if (!job) return;
+	SPRITEBATCH_MEMSET(job, 0, sizeof(*job));
+	job->sb = sb;
+	job->packing = sb->atlas_packing;
+	job->imgs = (spritebatch_internal_lonely_texture_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_lonely_texture_t) * img_count, sb->mem_ctx);
+	if (!job->imgs)
+	{
+		SPRITEBATCH_FREE(job, sb->mem_ctx);
+		return;
+	}
+
+	for (int i = 0; i < lonely_count; ++i)
+	{
+		if (lonely_textures[i].pending) continue;
+		lonely_textures[i].pending = 1;
+		job->imgs[job->img_count++] = lonely_textures[i];
+	}
+
+	SPRITEBATCH_LOG("queued atlas job for %d textures\n", img_count);
+	sb->build_atlas_callback(job, sb->udata);
+}
+
+void spritebatch_atlas_job_finish(spritebatch_t* sb, spritebatch_atlas_job_t* job)
+{
+	// Images that did not fit are free to go into the next job.
+	for (int i = 0; i < job->img_count; ++i)
+	{
+		spritebatch_internal_lonely_texture_t* lonely = (spritebatch_internal_lonely_texture_t*)hashtable_find(&sb->sprites_to_lonely_textures, job->imgs[i].image_id);
+		if (lonely) lonely->pending = 0;
+	}
+
+	if (!job->failed)
+	{
+		spritebatch_internal_atlas_t* atlas = (spritebatch_internal_atlas_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_atlas_t), sb->mem_ctx);
+		spritebatch_internal_fill_atlas(job, atlas, 1);
+
+		int texture_count = hashtable_count(&atlas->sprites_to_textures);
+		if (!texture_count)
+		{
+			hashtable_term(&atlas->sprites_to_textures);
+			SPRITEBATCH_FREE(atlas, sb->mem_ctx);
+		}
+
+		else
+		{
+			spritebatch_internal_link_atlas(sb, atlas);
+			sb->atlases_built++;
+			spritebatch_internal_texture_t* textures = (spritebatch_internal_texture_t*)hashtable_items(&atlas->sprites_to_textures);
+			for (int i = 0; i < texture_count; ++i)
+			{
+				SPRITEBATCH_U64 key = textures[i].image_id;
+				spritebatch_internal_lonely_texture_t* lonely = (spritebatch_internal_lonely_texture_t*)hashtable_find(&sb->sprites_to_lonely_textures, key);
+				if (lonely)
+				{
+					if (lonely->texture_id != (SPRITEBATCH_U64)~0ULL) sb->delete_texture_callback(lonely->texture_id, sb->udata);
+					spritebatch_internal_buffer_key(sb, key);
+				}
+				hashtable_insert(&sb->sprites_to_atlases, key, &atlas);
+			}
+			spritebatch_internal_remove_table_entries(sb, &sb->sprites_to_lonely_textures);
+			SPRITEBATCH_LOG("finished atlas job, %d textures went into atlas %p\n", texture_count, atlas);
+		}
+	}
+
+	spritebatch_internal_free_atlas_job_buffers(job);
+	SPRITEBATCH_FREE(job->pixel_buffer, sb->mem_ctx);
+	SPRITEBATCH_FREE(job->imgs, sb->mem_ctx);
+	SPRITEBATCH_FREE(job, sb->mem_ctx);
+}
+
 int spritebatch_defrag(spritebatch_t* sb)
 {
 	// remove decayed atlases and flush them to the lonely buffer
@@ -2002,7 +2646,16 @@ int spritebatch_defrag(spritebatch_t* sb)
 
 	// process input, but don't make textures just yet
 	spritebatch_internal_process_input(sb, 1);
+
+	if (sb->build_atlas_callback)
+	{
+		spritebatch_internal_queue_atlas_job(sb);
+		return 1;
+	}
+
+	// the lonely table may have grown while processing input
 	lonely_count = hashtable_count(&sb->sprites_to_lonely_textures);
+	lonely_textures = (spritebatch_internal_lonely_texture_t*)hashtable_items(&sb->sprites_to_lonely_textures);
 
 	// while greater than lonely_buffer_count_till_flush elements in lonely buffer
 	// grab lonely_buffer_count_till_flush of them and make an atlas
@@ -2011,21 +2664,7 @@ int spritebatch_defrag(spritebatch_t* sb)
 	while (lonely_count > lonely_buffer_count_till_flush && !stuck)
 	{
 		atlas = (spritebatch_internal_atlas_t*)SPRITEBATCH_MALLOC(sizeof(spritebatch_internal_atlas_t), sb->mem_ctx);
-		if (sb->atlases)
-		{
-			atlas->prev = sb->atlases;
-			atlas->next = sb->atlases->next;
-			sb->atlases->next->prev = atlas;
-			sb->atlases->next = atlas;
-		}
-
-		else
-		{
-			atlas->next = atlas;
-			atlas->prev = atlas;
-			sb->atlases = atlas;
-		}
-
+		spritebatch_internal_link_atlas(sb, atlas);
 		spritebatch_make_atlas(sb, atlas, lonely_textures, lonely_count);
 		SPRITEBATCH_LOG("making atlas\n");
 
@@ -2083,6 +2722,30 @@ int spritebatch_defrag(spritebatch_t* sb)
 	return 1;
 }
 
+void spritebatch_get_atlas_stats(spritebatch_t* sb, spritebatch_atlas_stats_t* stats)
+{
+	float volume_ratio = 0;
+	stats->atlas_count = 0;
+	spritebatch_internal_atlas_t* atlas = sb->atlases;
+	if (atlas)
+	{
+		spritebatch_internal_atlas_t* sentinel = atlas;
+		do
+		{
+			stats->atlas_count++;
+			volume_ratio += atlas->volume_ratio;
+			atlas = atlas->next;
+		}
+		while (atlas != sentinel);
+	}
+
+	// every atlas is the same size, so the average ratio is the ratio over all of them
+	stats->fill_ratio = stats->atlas_count ? volume_ratio / (float)stats->atlas_count : 0;
+	stats->lonely_texture_count = hashtable_count(&sb->sprites_to_lonely_textures);
+	stats->atlases_built = sb->atlases_built;
+	stats->atlases_flushed = sb->atlases_flushed;
+}
+
 #endif // SPRITEBATCH_IMPLEMENTATION_ONCE
 #endif // SPRITEBATCH_IMPLEMENTATION
 
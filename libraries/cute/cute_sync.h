@@ -1166,6 +1166,7 @@ typedef struct cute_threadpool_t
 	int task_count;
 	cute_task_t* tasks;
 	cute_mutex_t task_mutex;
+	cute_atomic_int_t tasks_in_flight; // Added but not yet finished tasks, including ones being worked on.
 
 	int thread_count;
 	cute_thread_t** threads;
@@ -1197,6 +1198,7 @@ int cute_worker_thread_internal(void* udata)
 		cute_task_t task;
 		if (cute_try_pop_task_internal(pool, &task)) {
 			task.do_work(task.param);
+			cute_atomic_add(&pool->tasks_in_flight, -1);
 		}
 
 		cute_semaphore_wait(&pool->semaphore);
@@ -1213,6 +1215,7 @@ cute_threadpool_t* cute_threadpool_create(int thread_count, void* mem_ctx)
 	pool->task_count = 0;
 	pool->tasks = (cute_task_t*)cute_malloc_aligned(sizeof(cute_task_t) * pool->task_capacity, CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
 	pool->task_mutex = cute_mutex_create();
+	cute_atomic_set(&pool->tasks_in_flight, 0);
 	pool->thread_count = thread_count;
 	pool->threads = (cute_thread_t**)cute_malloc_aligned(sizeof(cute_thread_t*) * thread_count, CUTE_SYNC_CACHELINE_SIZE, mem_ctx);
 	cute_atomic_set(&pool->running, 1);
@@ -1244,6 +1247,7 @@ void cute_threadpool_add_task(cute_threadpool_t* pool, void (*func)(void*), void
 	task.do_work = func;
 	task.param = param;
 	pool->tasks[pool->task_count++] = task;
+	cute_atomic_add(&pool->tasks_in_flight, 1);
 
 	cute_unlock(&pool->task_mutex);
 }
@@ -1252,11 +1256,13 @@ void cute_threadpool_kick_and_wait(cute_threadpool_t* pool)
 {
 	cute_threadpool_kick(pool);
 
-	while (pool->task_count) {
+	// Wait on tasks being worked on by other threads as well, not just for the task list to empty.
+	while (cute_atomic_get(&pool->tasks_in_flight)) {
 		cute_task_t task;
 		if (cute_try_pop_task_internal(pool, &task)) {
 			cute_semaphore_try(&pool->semaphore);
 			task.do_work(task.param);
+			cute_atomic_add(&pool->tasks_in_flight, -1);
 		}
 		CUTE_SYNC_YIELD();
 	}
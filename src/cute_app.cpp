@@ -29,6 +29,7 @@
 #include <cute_c_runtime.h>
 #include <cute_kv.h>
 #include <cute_font.h>
+#include <cute_render_graph.h>
 
 #include <internal/cute_app_internal.h>
 #include <internal/cute_file_system_internal.h>
@@ -78,6 +79,14 @@ error_t app_make(const char* window_title, int x, int y, int w, int h, uint32_t
 {
 	SDL_SetMainReady();
 
+#ifdef SOKOL_DUMMY_BACKEND
+	// The dummy backend doesn't need a window or a real graphics context, so any request for one
+	// just sets up sokol_gfx instead.
+	uint32_t gfx_options = CUTE_APP_OPTIONS_OPENGL_CONTEXT | CUTE_APP_OPTIONS_OPENGLES_CONTEXT | CUTE_APP_OPTIONS_D3D11_CONTEXT | CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT;
+	bool dummy_gfx = !!(options & gfx_options);
+	options &= ~gfx_options;
+#endif
+
 #ifdef CUTE_EMSCRIPTEN
 	Uint32 sdl_options = SDL_INIT_EVENTS | SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER;
 #else
@@ -172,6 +181,15 @@ error_t app_make(const char* window_title, int x, int y, int w, int h, uint32_t
 		font_init();
 	}
 
+#ifdef SOKOL_DUMMY_BACKEND
+	if (dummy_gfx) {
+		sg_desc params = { 0 };
+		sg_setup(params);
+		app->gfx_enabled = true;
+		font_init();
+	}
+#endif
+
 	if (options & CUTE_APP_OPTIONS_D3D11_CONTEXT) {
 		dx11_init(hwnd, w, h, 1);
 		app->gfx_ctx_params = dx11_get_context();
@@ -196,6 +214,8 @@ error_t app_make(const char* window_title, int x, int y, int w, int h, uint32_t
 	}
 
 	app->strpool = make_strpool();
+	app->command_buffers.ensure_count(core_count() + 1);
+	thread_claims_init(&app->command_buffer_claims, app->command_buffers.count());
 
 	return error_success();
 }
@@ -203,6 +223,7 @@ error_t app_make(const char* window_title, int x, int y, int w, int h, uint32_t
 void app_destroy()
 {
 	destroy_strpool(app->strpool);
+	thread_claims_destroy(&app->command_buffer_claims);
 	if (app->using_imgui) {
 		simgui_shutdown();
 		ImGui_ImplSDL2_Shutdown();
@@ -221,6 +242,10 @@ void app_destroy()
 	int schema_count = app->entity_parsed_schemas.count();
 	kv_t** schemas = app->entity_parsed_schemas.items();
 	for (int i = 0; i < schema_count; ++i) kv_destroy(schemas[i]);
+	for (int i = 0; i < app->queries.count(); ++i) {
+		app->queries[i]->~query_internal_t();
+		CUTE_FREE(app->queries[i], app->mem_ctx);
+	}
 	if (app->ase_cache) {
 		aseprite_cache_destroy(app->ase_cache);
 		batch_destroy(app->ase_batch);
@@ -229,6 +254,7 @@ void app_destroy()
 		png_cache_destroy(app->png_cache);
 		batch_destroy(app->png_batch);
 	}
+	font_layout_cache(false);
 	if (app->courier_new) {
 		font_free((font_t*)app->courier_new);
 	}
@@ -291,9 +317,29 @@ void app_present()
 	if (app->offscreen_enabled) {
 		sg_end_pass();
 
+		sg_image upscale_image = app->offscreen_color_buffer;
+		v2 upscale_size = v2((float)app->offscreen_w, (float)app->offscreen_h);
+		if (app->render_graph) {
+			error_t err = render_graph_execute(app->render_graph);
+			if (err.is_error()) {
+				// A broken graph stays broken every frame, so only report it the first time.
+				if (!app->render_graph_failed) {
+					CUTE_DEBUG_PRINTF("Unable to execute render graph: %s\n", err.details);
+				}
+				app->render_graph_failed = true;
+			} else {
+				app->render_graph_failed = false;
+				render_graph_texture_t output = render_graph_get_output(app->render_graph);
+				int w, h;
+				render_graph_get_texture_size(app->render_graph, output, &w, &h);
+				upscale_image = render_graph_get_image(app->render_graph, output);
+				upscale_size = v2((float)w, (float)h);
+			}
+		}
+
 		sg_bindings bind = { 0 };
 		bind.vertex_buffers[0] = app->quad;
-		bind.fs_images[0] = app->offscreen_color_buffer;
+		bind.fs_images[0] = upscale_image;
 
 		sg_pass_action clear_to_black = { 0 };
 		clear_to_black.colors[0] = { SG_ACTION_CLEAR, { 0.0f, 0.0f, 0.0f, 1.0f } };
@@ -302,7 +348,7 @@ void app_present()
 		sg_apply_bindings(bind);
 		upscale_vs_params_t vs_params = { app->upscale };
 		sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, SG_RANGE(vs_params));
-		upscale_fs_params_t fs_params = { v2((float)app->offscreen_w, (float)app->offscreen_h) };
+		upscale_fs_params_t fs_params = { upscale_size };
 		sg_apply_uniforms(SG_SHADERSTAGE_FS, 0, SG_RANGE(fs_params));
 		sg_draw(0, 6, 1);
 		if (app->using_imgui) {
@@ -326,6 +372,7 @@ void app_present()
 
 	// Triple buffering on the font vertices.
 	app->font_buffer.advance();
+	font_update();
 }
 
 // TODO - Move these init functions into audio/net headers.
@@ -466,7 +513,7 @@ error_t app_set_offscreen_buffer(int offscreen_w, int offscreen_h)
 	if (app->quad.id == SG_INVALID_ID) return error_failure("Unable create static quad buffer.");
 
 	// Setup upscaling shader, to draw the offscreen buffer onto the screen as a textured quad.
-	app->offscreen_shader = sg_make_shader(upscale_shd_shader_desc(sg_query_backend()));
+	app->offscreen_shader = sg_make_shader(upscale_shd_shader_desc(app_shader_backend()));
 	if (app->offscreen_shader.id == SG_INVALID_ID) return error_failure("Unable create offscreen shader.");
 
 	app->upscale = { (float)app->offscreen_w / (float)app->w, (float)app->offscreen_h / (float)app->h };
@@ -490,6 +537,13 @@ error_t app_set_offscreen_buffer(int offscreen_w, int offscreen_h)
 	return error_success();
 }
 
+void app_set_render_graph(render_graph_t* graph)
+{
+	CUTE_ASSERT(!graph || app->offscreen_enabled);
+	app->render_graph = graph;
+	app->render_graph_failed = false;
+}
+
 void app_offscreen_size(int* offscreen_w, int* offscreen_h)
 {
 	*offscreen_w = app->offscreen_w;
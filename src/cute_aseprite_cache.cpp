@@ -25,6 +25,7 @@
 #include <cute_file_system.h>
 #include <cute_defer.h>
 #include <cute_strpool.h>
+#include <cute_concurrency.h>
 
 #include <internal/cute_app_internal.h>
 
@@ -48,6 +49,7 @@ struct aseprite_cache_t
 {
 	dictionary<strpool_id, aseprite_cache_entry_t> aseprites;
 	dictionary<uint64_t, void*> id_to_pixels;
+	rw_lock_t pixels_lock; // Batches may read `id_to_pixels` from worker threads, see `batch_set_async_atlases`.
 	uint64_t id_gen = 0;
 	strpool_t* strpool = NULL;
 	void* mem_ctx = NULL;
@@ -57,18 +59,21 @@ static void s_get_pixels(uint64_t image_id, void* buffer, int bytes_to_fill, voi
 {
 	aseprite_cache_t* cache = (aseprite_cache_t*)udata;
 	void* pixels = NULL;
+	read_lock(&cache->pixels_lock);
 	if (cache->id_to_pixels.find(image_id, &pixels).is_error()) {
 		CUTE_DEBUG_PRINTF("Aseprite cache -- unable to find id %lld.", (long long int)image_id);
 		CUTE_MEMSET(buffer, 0, bytes_to_fill);
 	} else {
 		CUTE_MEMCPY(buffer, pixels, bytes_to_fill);
 	}
+	read_unlock(&cache->pixels_lock);
 }
 
 aseprite_cache_t* aseprite_cache_make(void* mem_ctx)
 {
 	aseprite_cache_t* cache = CUTE_NEW(aseprite_cache_t, mem_ctx);
 	cache->strpool = make_strpool();
+	cache->pixels_lock = rw_lock_create();
 	cache->mem_ctx = mem_ctx;
 	return cache;
 }
@@ -91,6 +96,7 @@ void aseprite_cache_destroy(aseprite_cache_t* cache)
 		CUTE_FREE(entry->animations, cache->mem_ctx);
 		cute_aseprite_free(entry->ase);
 	}
+	rw_lock_destroy(&cache->pixels_lock);
 	void* mem_ctx = cache->mem_ctx;
 	cache->~aseprite_cache_t();
 	CUTE_FREE(cache, mem_ctx);
@@ -165,7 +171,9 @@ error_t aseprite_cache_load(aseprite_cache_t* cache, const char* aseprite_path,
 			}
 		}
 
+		write_lock(&cache->pixels_lock);
 		cache->id_to_pixels.insert(id, ase->frames[i].pixels);
+		write_unlock(&cache->pixels_lock);
 	}
 
 	// Fill out the animation table from the aseprite file.
@@ -242,9 +250,11 @@ void aseprite_cache_unload(aseprite_cache_t* cache, const char* aseprite_path)
 
 	for (int i = 0; i < animation_count; ++i) {
 		animation_t* animation = (animation_t*)animations[i];
+		write_lock(&cache->pixels_lock);
 		for (int j = 0; j < animation->frames.count(); ++j) {
 			cache->id_to_pixels.remove(animation->frames[j].id);
 		}
+		write_unlock(&cache->pixels_lock);
 		animation->~animation_t();
 		CUTE_FREE(animation, cache->mem_ctx);
 	}
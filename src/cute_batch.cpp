@@ -25,22 +25,21 @@
 #include <cute_file_system.h>
 #include <cute_lru_cache.h>
 #include <cute_defer.h>
+#include <cute_concurrency.h>
+#include <cute_dictionary.h>
 //#include <cute_debug_printf.h>
 
 #include <internal/cute_app_internal.h>
+#include <internal/cute_batch_internal.h>
+#include <internal/cute_thread_claims_internal.h>
+#include <internal/cute_frame_cache_internal.h>
 
 #include <shaders/sprite_shader.h>
 #include <shaders/sprite_outline_shader.h>
 #include <shaders/geom_shader.h>
 
-struct quad_udata_t
-{
-	float alpha;
-};
-
 #include <cute/cute_png.h>
 
-#define SPRITEBATCH_SPRITE_USERDATA quad_udata_t
 #define SPRITEBATCH_IMPLEMENTATION
 //#define SPRITEBATCH_LOG CUTE_DEBUG_PRINTF
 #include <cute/cute_spritebatch.h>
@@ -50,16 +49,22 @@ struct quad_udata_t
 
 #define DEBUG_VERT(v, c) batch_quad(batch, make_aabb(v, 3, 3), c)
 
+// The NEON path has not been built or run on any of our targets yet, so ARM builds stay on the scalar
+// path unless CUTE_BATCH_USE_NEON is defined.
+#if defined(__AVX__)
+#	include <immintrin.h>
+#	define CUTE_BATCH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define CUTE_BATCH_SSE2
+#elif defined(CUTE_BATCH_USE_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#	include <arm_neon.h>
+#	define CUTE_BATCH_NEON
+#endif
+
 namespace cute
 {
 
-struct quad_vertex_t
-{
-	v2 pos;
-	v2 uv;
-	float alpha;
-};
-
 struct vertex_t
 {
 	v2 p;
@@ -80,19 +85,92 @@ struct scissor_t
 
 static const color_t DEFAULT_TINT = make_color(0.5f, 0.5f, 0.5f, 1.0f);
 
+struct batch_push_buffer_t
+{
+	array<spritebatch_sprite_t> sprites;
+};
+
+struct batch_static_range_t
+{
+	uint64_t texture_id;
+	int first_quad;
+	int quad_count;
+	int texture_w;
+	int texture_h;
+};
+
+struct batch_static_t
+{
+	batch_t* batch = NULL;
+	bool dirty = true;
+	array<spritebatch_sprite_t> sprites;
+	array<quad_vertex_t> verts;
+	array<batch_static_range_t> ranges;
+	sg_buffer buffer = { 0 };
+};
+
+// Unit vectors for angles `i / iters * range`, `i` from 0 to `iters`. See `s_arc_table`.
+struct batch_arc_table_t
+{
+	array<v2> points;
+};
+
+// Tessellated polyline along with everything it was made from, see `batch_set_polyline_cache`.
+struct batch_polyline_cache_entry_t
+{
+	array<v2> points;
+	float thickness;
+	color_t color;
+	bool loop;
+	bool antialias;
+	int bevel_count;
+	float alias_scale;
+	array<vertex_t> verts;
+	array<uint16_t> indices; // Relative to the first vertex in `verts`.
+	uint64_t last_used;
+};
+
+struct batch_atlas_job_t
+{
+	spritebatch_atlas_job_t* job = NULL;
+	atomic_int_t done = atomic_zero();
+};
+
 struct batch_t
 {
 	::spritebatch_t sb;
 
+	threadpool_t* atlas_pool = NULL; // Kept apart from the app's threadpool, so its waits never run or block on atlases.
+	array<batch_atlas_job_t*> atlas_jobs; // Atlases being built on `atlas_pool`, see `batch_set_async_atlases`.
+	batch_stats_t stats; // Only the upload and draw call counters are kept here, see `batch_get_stats`.
+
+	array<batch_static_t*> statics;
+	batch_static_t* capturing = NULL; // When set, sprite batches are recorded into this static batch instead of drawn.
+	array<spritebatch_internal_sprite_t> input_stash;
+
+	thread_id_t thread = 0; // The thread that made the batch, pushes straight into `sb`.
+	array<batch_push_buffer_t*> push_buffers; // One per other thread, the last one is shared by any extra threads.
+	array<spritebatch_sprite_t> push_many_buffer; // Used by `batch_push_many` on the thread that made the batch.
+	thread_claims_t push_buffer_claims;
+
 	float atlas_width = 1024;
 	float atlas_height = 1024;
 
 	sg_pipeline geom_pip;
 	triple_buffer_t geom_buffer;
 	array<vertex_t> geom_verts;
+	array<uint16_t> geom_indices;
+	int geom_verts_transformed = 0; // Vertices from here onward are still waiting on the current `m3x2`, see `s_transform_geom`.
+	dictionary<uint64_t, batch_arc_table_t*> arc_tables;
+	array<v2> arc_scratch;
+	bool use_polyline_cache = false;
+	dictionary<uint64_t, batch_polyline_cache_entry_t*> polyline_cache;
+	uint64_t polyline_cache_updates = 0;
 
 	array<quad_vertex_t> sprite_verts;
 	triple_buffer_t sprite_buffer;
+	sg_buffer quad_indices = { 0 };
+	bool use_culling = false;
 	sg_shader default_shd = { 0 };
 	sg_shader outline_shd = { 0 };
 	sg_shader active_shd = { 0 };
@@ -129,11 +207,11 @@ static sg_shader s_load_shader(batch_t* b, batch_sprite_shader_type_t type)
 	// Default sprite shader.
 	switch (type) {
 	case BATCH_SPRITE_SHADER_TYPE_DEFAULT:
-		params = *sprite_default_shd_shader_desc(sg_query_backend());
+		params = *sprite_default_shd_shader_desc(app_shader_backend());
 		break;
 
 	default:
-		params = *sprite_outline_shd_shader_desc(sg_query_backend());
+		params = *sprite_outline_shd_shader_desc(app_shader_backend());
 		break;
 	}
 
@@ -167,117 +245,367 @@ static void s_set_shd_type(batch_t* b, batch_sprite_shader_type_t type)
 }
 
 //--------------------------------------------------------------------------------------------------
-// spritebatch_t callbacks.
+// Sprite vertex generation.
+
+void batch_make_quad_indices(uint16_t* indices, int quad_count)
+{
+	CUTE_ASSERT(quad_count <= CUTE_BATCH_MAX_QUADS_PER_DRAW);
+	for (int i = 0; i < quad_count; ++i) {
+		uint16_t base = (uint16_t)(i * 4);
+		indices[0] = base + 0;
+		indices[1] = base + 3;
+		indices[2] = base + 1;
+		indices[3] = base + 1;
+		indices[4] = base + 3;
+		indices[5] = base + 2;
+		indices += 6;
+	}
+}
 
-static void s_batch_report(spritebatch_sprite_t* sprites, int count, int texture_w, int texture_h, void* udata)
+CUTE_STATIC_ASSERT(sizeof(sprite_instance_t) == 32, "Instance records should stay tightly packed.");
+
+static CUTE_INLINE int16_t s_pack_snorm16(float f)
 {
-	batch_t* b = (batch_t*)udata;
+	f = clamp(f, -1.0f, 1.0f);
+	return (int16_t)(int)(f * 32767.0f + (f < 0 ? -0.5f : 0.5f));
+}
 
-	// Build vertex buffer of all quads for each sprite.
-	int vert_count = count * 6;
-	b->sprite_verts.ensure_count(vert_count);
-	quad_vertex_t* verts = b->sprite_verts.data();
+static CUTE_INLINE uint16_t s_pack_unorm16(float f)
+{
+	return (uint16_t)(int)(clamp01(f) * 65535.0f + 0.5f);
+}
 
-	m3x2 m = make_identity();
-	if (b->m3x2s.count()) {
-		m = b->m3x2s.last();
+static void s_make_sprite_instances_scalar(const spritebatch_sprite_t* sprites, int count, sprite_instance_t* instances)
+{
+	for (int i = 0; i < count; ++i) {
+		const spritebatch_sprite_t* s = sprites + i;
+		sprite_instance_t instance;
+		instance.pos = v2(s->x, s->y);
+		instance.rotation[0] = s_pack_snorm16(s->s);
+		instance.rotation[1] = s_pack_snorm16(s->c);
+		instance.scale = v2(s->sx, s->sy);
+		instance.uv_rect[0] = s_pack_unorm16(s->minx);
+		instance.uv_rect[1] = s_pack_unorm16(s->miny);
+		instance.uv_rect[2] = s_pack_unorm16(s->maxx);
+		instance.uv_rect[3] = s_pack_unorm16(s->maxy);
+		instance.alpha[0] = (uint8_t)(int)(clamp01(s->udata.alpha) * 255.0f + 0.5f);
+		instance.alpha[1] = instance.alpha[2] = instance.alpha[3] = 0;
+		instances[i] = instance;
 	}
+}
 
-	for (int i = 0; i < count; ++i)
+#if defined(CUTE_BATCH_AVX) || defined(CUTE_BATCH_SSE2) || defined(CUTE_BATCH_NEON)
+
+// Sprites are processed `SIMD_WIDTH` at a time to compute their corners, while each vertex is then
+// written out with a single 4-wide store (plus alpha) instead of five separate floats.
+#if defined(CUTE_BATCH_AVX)
+#	define SIMD_WIDTH 8
+#	define SIMD_GATHER(s, field) _mm256_setr_ps(s[0].field, s[1].field, s[2].field, s[3].field, s[4].field, s[5].field, s[6].field, s[7].field)
+typedef __m256 simd_t;
+static CUTE_INLINE simd_t simd_load(const float* f) { return _mm256_loadu_ps(f); }
+static CUTE_INLINE void simd_store(float* f, simd_t a) { _mm256_storeu_ps(f, a); }
+static CUTE_INLINE simd_t simd_splat(float f) { return _mm256_set1_ps(f); }
+static CUTE_INLINE simd_t simd_add(simd_t a, simd_t b) { return _mm256_add_ps(a, b); }
+static CUTE_INLINE simd_t simd_sub(simd_t a, simd_t b) { return _mm256_sub_ps(a, b); }
+static CUTE_INLINE simd_t simd_mul(simd_t a, simd_t b) { return _mm256_mul_ps(a, b); }
+static CUTE_INLINE simd_t simd_min(simd_t a, simd_t b) { return _mm256_min_ps(a, b); }
+static CUTE_INLINE simd_t simd_max(simd_t a, simd_t b) { return _mm256_max_ps(a, b); }
+static CUTE_INLINE void simd_store_rounded(int* i, simd_t a) { _mm256_storeu_si256((__m256i*)i, _mm256_cvtps_epi32(a)); }
+#elif defined(CUTE_BATCH_SSE2)
+#	define SIMD_WIDTH 4
+#	define SIMD_GATHER(s, field) _mm_setr_ps(s[0].field, s[1].field, s[2].field, s[3].field)
+typedef __m128 simd_t;
+static CUTE_INLINE simd_t simd_load(const float* f) { return _mm_loadu_ps(f); }
+static CUTE_INLINE void simd_store(float* f, simd_t a) { _mm_storeu_ps(f, a); }
+static CUTE_INLINE simd_t simd_splat(float f) { return _mm_set1_ps(f); }
+static CUTE_INLINE simd_t simd_add(simd_t a, simd_t b) { return _mm_add_ps(a, b); }
+static CUTE_INLINE simd_t simd_sub(simd_t a, simd_t b) { return _mm_sub_ps(a, b); }
+static CUTE_INLINE simd_t simd_mul(simd_t a, simd_t b) { return _mm_mul_ps(a, b); }
+static CUTE_INLINE simd_t simd_min(simd_t a, simd_t b) { return _mm_min_ps(a, b); }
+static CUTE_INLINE simd_t simd_max(simd_t a, simd_t b) { return _mm_max_ps(a, b); }
+static CUTE_INLINE void simd_store_rounded(int* i, simd_t a) { _mm_storeu_si128((__m128i*)i, _mm_cvtps_epi32(a)); }
+#else
+#	define SIMD_WIDTH 4
+#	define SIMD_GATHER(s, field) simd4_make(s[0].field, s[1].field, s[2].field, s[3].field)
+typedef float32x4_t simd_t;
+static CUTE_INLINE simd_t simd_load(const float* f) { return vld1q_f32(f); }
+static CUTE_INLINE void simd_store(float* f, simd_t a) { vst1q_f32(f, a); }
+static CUTE_INLINE simd_t simd_splat(float f) { return vdupq_n_f32(f); }
+static CUTE_INLINE simd_t simd_add(simd_t a, simd_t b) { return vaddq_f32(a, b); }
+static CUTE_INLINE simd_t simd_sub(simd_t a, simd_t b) { return vsubq_f32(a, b); }
+static CUTE_INLINE simd_t simd_mul(simd_t a, simd_t b) { return vmulq_f32(a, b); }
+static CUTE_INLINE simd_t simd_min(simd_t a, simd_t b) { return vminq_f32(a, b); }
+static CUTE_INLINE simd_t simd_max(simd_t a, simd_t b) { return vmaxq_f32(a, b); }
+static CUTE_INLINE void simd_store_rounded(int* i, simd_t a) { simd_t half = vbslq_f32(vcltq_f32(a, vdupq_n_f32(0)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f)); vst1q_s32(i, vcvtq_s32_f32(vaddq_f32(a, half))); }
+#endif
+
+#if defined(CUTE_BATCH_NEON)
+typedef float32x4_t simd4_t;
+static CUTE_INLINE simd4_t simd4_make(float a, float b, float c, float d) { float f[4] = { a, b, c, d }; return vld1q_f32(f); }
+static CUTE_INLINE void simd4_store(float* f, simd4_t a) { vst1q_f32(f, a); }
+#else
+typedef __m128 simd4_t;
+static CUTE_INLINE simd4_t simd4_make(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static CUTE_INLINE void simd4_store(float* f, simd4_t a) { _mm_storeu_ps(f, a); }
+#endif
+
+// `m3x2` splatted across all lanes, shared by the sprite, culling and geometry transforms.
+struct simd_m3x2_t
+{
+	simd_t m00, m01, m10, m11;
+	simd_t tx, ty;
+};
+
+static CUTE_INLINE simd_m3x2_t simd_m3x2(m3x2 m)
+{
+	simd_m3x2_t result;
+	result.m00 = simd_splat(m.m.x.x);
+	result.m01 = simd_splat(m.m.y.x);
+	result.m10 = simd_splat(m.m.x.y);
+	result.m11 = simd_splat(m.m.y.y);
+	result.tx = simd_splat(m.p.x);
+	result.ty = simd_splat(m.p.y);
+	return result;
+}
+
+static CUTE_INLINE void simd_mul_point(const simd_m3x2_t& m, simd_t x, simd_t y, simd_t* x_out, simd_t* y_out)
+{
+	*x_out = simd_add(simd_add(simd_mul(m.m00, x), simd_mul(m.m01, y)), m.tx);
+	*y_out = simd_add(simd_add(simd_mul(m.m10, x), simd_mul(m.m11, y)), m.ty);
+}
+
+static CUTE_INLINE void simd_mul_vector(const simd_m3x2_t& m, simd_t x, simd_t y, simd_t* x_out, simd_t* y_out)
+{
+	*x_out = simd_add(simd_mul(m.m00, x), simd_mul(m.m01, y));
+	*y_out = simd_add(simd_mul(m.m10, x), simd_mul(m.m11, y));
+}
+
+static CUTE_INLINE void s_store_vert(quad_vertex_t* out_vert, simd4_t pos_and_uv, float alpha)
+{
+	simd4_store(&out_vert->pos.x, pos_and_uv);
+	out_vert->alpha = alpha;
+}
+
+void batch_make_sprite_verts(const spritebatch_sprite_t* sprites, int count, m3x2 m, quad_vertex_t* verts)
+{
+	simd_t half = simd_splat(0.5f);
+	simd_m3x2_t mw = simd_m3x2(m);
+
+	int simd_count = count - count % SIMD_WIDTH;
+	for (int i = 0; i < simd_count; i += SIMD_WIDTH)
 	{
-		spritebatch_sprite_t* s = sprites + i;
-
-		v2 quad[] = {
-			{ -0.5f,  0.5f },
-			{  0.5f,  0.5f },
-			{  0.5f, -0.5f },
-			{ -0.5f, -0.5f },
-		};
-
-		for (int j = 0; j < 4; ++j)
-		{
-			float x = quad[j].x;
-			float y = quad[j].y;
-
-			// Rotate sprite about origin.
-			float x0 = s->c * x - s->s * y;
-			float y0 = s->s * x + s->c * y;
-			x = x0;
-			y = y0;
-
-			// Scale sprite about origin.
-			x *= s->sx;
-			y *= s->sy;
-
-			// Translate sprite into the world.
-			x += s->x;
-			y += s->y;
-
-			// Apply final batch transformation.
-			v2 p = v2(x, y);
-			p = mul(m, p);
-
-			quad[j].x = p.x;
-			quad[j].y = p.y;
+		const spritebatch_sprite_t* s = sprites + i;
+		simd_t x = SIMD_GATHER(s, x);
+		simd_t y = SIMD_GATHER(s, y);
+		simd_t hsx = simd_mul(SIMD_GATHER(s, sx), half);
+		simd_t hsy = simd_mul(SIMD_GATHER(s, sy), half);
+		simd_t c = SIMD_GATHER(s, c);
+		simd_t sn = SIMD_GATHER(s, s);
+
+		// Instead of transforming all four corners, transform the center of each sprite along with
+		// its two half-extent axes. Corners are then just sums of these three vectors.
+		simd_t ax = simd_mul(c, hsx);
+		simd_t ay = simd_mul(sn, hsy);
+		simd_t bx = simd_sub(simd_splat(0), simd_mul(sn, hsx));
+		simd_t by = simd_mul(c, hsy);
+
+		simd_t cx, cy, ux, uy, vx, vy;
+		simd_mul_point(mw, x, y, &cx, &cy);
+		simd_mul_vector(mw, ax, ay, &ux, &uy);
+		simd_mul_vector(mw, bx, by, &vx, &vy);
+
+		float q[8][SIMD_WIDTH];
+		simd_t cx_minus_ux = simd_sub(cx, ux);
+		simd_t cy_minus_uy = simd_sub(cy, uy);
+		simd_t cx_plus_ux = simd_add(cx, ux);
+		simd_t cy_plus_uy = simd_add(cy, uy);
+		simd_store(q[0], simd_add(cx_minus_ux, vx));
+		simd_store(q[1], simd_add(cy_minus_uy, vy));
+		simd_store(q[2], simd_add(cx_plus_ux, vx));
+		simd_store(q[3], simd_add(cy_plus_uy, vy));
+		simd_store(q[4], simd_sub(cx_plus_ux, vx));
+		simd_store(q[5], simd_sub(cy_plus_uy, vy));
+		simd_store(q[6], simd_sub(cx_minus_ux, vx));
+		simd_store(q[7], simd_sub(cy_minus_uy, vy));
+
+		for (int j = 0; j < SIMD_WIDTH; ++j) {
+			const spritebatch_sprite_t* sj = s + j;
+			quad_vertex_t* out_verts = verts + (i + j) * 4;
+			float alpha = sj->udata.alpha;
+			simd4_t p0 = simd4_make(q[0][j], q[1][j], sj->minx, sj->maxy);
+			simd4_t p1 = simd4_make(q[2][j], q[3][j], sj->maxx, sj->maxy);
+			simd4_t p2 = simd4_make(q[4][j], q[5][j], sj->maxx, sj->miny);
+			simd4_t p3 = simd4_make(q[6][j], q[7][j], sj->minx, sj->miny);
+			s_store_vert(out_verts + 0, p0, alpha);
+			s_store_vert(out_verts + 1, p1, alpha);
+			s_store_vert(out_verts + 2, p2, alpha);
+			s_store_vert(out_verts + 3, p3, alpha);
 		}
+	}
 
-		// output transformed quad into CPU buffer
-		quad_vertex_t* out_verts = verts + i * 6;
+	batch_make_sprite_verts_scalar(sprites + simd_count, count - simd_count, m, verts + simd_count * 4);
+}
 
-		for (int i = 0; i < 6; ++i) {
-			out_verts[i].alpha = s->udata.alpha;
+void batch_make_sprite_instances(const spritebatch_sprite_t* sprites, int count, sprite_instance_t* instances)
+{
+	simd_t zero = simd_splat(0);
+	simd_t one = simd_splat(1.0f);
+	simd_t neg_one = simd_splat(-1.0f);
+	simd_t snorm16 = simd_splat(32767.0f);
+	simd_t unorm16 = simd_splat(65535.0f);
+	simd_t unorm8 = simd_splat(255.0f);
+
+	int simd_count = count - count % SIMD_WIDTH;
+	for (int i = 0; i < simd_count; i += SIMD_WIDTH)
+	{
+		// Quantize all the packed fields wide, then assemble the records one at a time.
+		const spritebatch_sprite_t* s = sprites + i;
+		int q[7][SIMD_WIDTH];
+		simd_store_rounded(q[0], simd_mul(simd_max(simd_min(SIMD_GATHER(s, s), one), neg_one), snorm16));
+		simd_store_rounded(q[1], simd_mul(simd_max(simd_min(SIMD_GATHER(s, c), one), neg_one), snorm16));
+		simd_store_rounded(q[2], simd_mul(simd_max(simd_min(SIMD_GATHER(s, minx), one), zero), unorm16));
+		simd_store_rounded(q[3], simd_mul(simd_max(simd_min(SIMD_GATHER(s, miny), one), zero), unorm16));
+		simd_store_rounded(q[4], simd_mul(simd_max(simd_min(SIMD_GATHER(s, maxx), one), zero), unorm16));
+		simd_store_rounded(q[5], simd_mul(simd_max(simd_min(SIMD_GATHER(s, maxy), one), zero), unorm16));
+		simd_store_rounded(q[6], simd_mul(simd_max(simd_min(SIMD_GATHER(s, udata.alpha), one), zero), unorm8));
+
+		for (int j = 0; j < SIMD_WIDTH; ++j) {
+			sprite_instance_t instance;
+			instance.pos = v2(s[j].x, s[j].y);
+			instance.rotation[0] = (int16_t)q[0][j];
+			instance.rotation[1] = (int16_t)q[1][j];
+			instance.scale = v2(s[j].sx, s[j].sy);
+			instance.uv_rect[0] = (uint16_t)q[2][j];
+			instance.uv_rect[1] = (uint16_t)q[3][j];
+			instance.uv_rect[2] = (uint16_t)q[4][j];
+			instance.uv_rect[3] = (uint16_t)q[5][j];
+			instance.alpha[0] = (uint8_t)q[6][j];
+			instance.alpha[1] = instance.alpha[2] = instance.alpha[3] = 0;
+			instances[i + j] = instance;
 		}
+	}
 
-		out_verts[0].pos.x = quad[0].x;
-		out_verts[0].pos.y = quad[0].y;
-		out_verts[0].uv.x = s->minx;
-		out_verts[0].uv.y = s->maxy;
+	s_make_sprite_instances_scalar(sprites + simd_count, count - simd_count, instances + simd_count);
+}
 
-		out_verts[1].pos.x = quad[3].x;
-		out_verts[1].pos.y = quad[3].y;
-		out_verts[1].uv.x = s->minx;
-		out_verts[1].uv.y = s->miny;
+static CUTE_INLINE simd_t simd_abs(simd_t a) { return simd_max(a, simd_sub(simd_splat(0), a)); }
 
-		out_verts[2].pos.x = quad[1].x;
-		out_verts[2].pos.y = quad[1].y;
-		out_verts[2].uv.x = s->maxx;
-		out_verts[2].uv.y = s->maxy;
+int batch_cull_sprites(spritebatch_internal_sprite_t* sprites, int count, m3x2 m)
+{
+	simd_t half = simd_splat(0.5f);
+	simd_m3x2_t mw = simd_m3x2(m);
 
-		out_verts[3].pos.x = quad[1].x;
-		out_verts[3].pos.y = quad[1].y;
-		out_verts[3].uv.x = s->maxx;
-		out_verts[3].uv.y = s->maxy;
+	int visible_count = 0;
+	int simd_count = count - count % SIMD_WIDTH;
+	for (int i = 0; i < simd_count; i += SIMD_WIDTH)
+	{
+		const spritebatch_internal_sprite_t* s = sprites + i;
+		simd_t hsx = simd_mul(SIMD_GATHER(s, sx), half);
+		simd_t hsy = simd_mul(SIMD_GATHER(s, sy), half);
+		simd_t c = SIMD_GATHER(s, c);
+		simd_t sn = SIMD_GATHER(s, s);
+		simd_t x = SIMD_GATHER(s, x);
+		simd_t y = SIMD_GATHER(s, y);
+
+		// Same axes as in `batch_make_sprite_verts`, but only the extents of their bounding box are needed.
+		simd_t ax = simd_mul(c, hsx);
+		simd_t ay = simd_mul(sn, hsy);
+		simd_t bx = simd_sub(simd_splat(0), simd_mul(sn, hsx));
+		simd_t by = simd_mul(c, hsy);
+
+		simd_t cx, cy, ux, uy, vx, vy;
+		simd_mul_point(mw, x, y, &cx, &cy);
+		simd_mul_vector(mw, ax, ay, &ux, &uy);
+		simd_mul_vector(mw, bx, by, &vx, &vy);
+		simd_t ex = simd_add(simd_abs(ux), simd_abs(vx));
+		simd_t ey = simd_add(simd_abs(uy), simd_abs(vy));
+
+		float d[SIMD_WIDTH];
+		simd_store(d, simd_max(simd_sub(simd_abs(cx), ex), simd_sub(simd_abs(cy), ey)));
+
+		// Compact in place, the remaining sprites keep their order.
+		for (int j = 0; j < SIMD_WIDTH; ++j) {
+			if (d[j] <= 1.0f) {
+				sprites[visible_count++] = s[j];
+			}
+		}
+	}
 
-		out_verts[4].pos.x = quad[3].x;
-		out_verts[4].pos.y = quad[3].y;
-		out_verts[4].uv.x = s->minx;
-		out_verts[4].uv.y = s->miny;
+	int tail_count = count - simd_count;
+	for (int i = 0; i < tail_count; ++i) {
+		sprites[visible_count + i] = sprites[simd_count + i];
+	}
+	return visible_count + batch_cull_sprites_scalar(sprites + visible_count, tail_count, m);
+}
+
+void batch_transform_points(v2* points, int count, int stride, m3x2 m)
+{
+	simd_m3x2_t mw = simd_m3x2(m);
+	uint8_t* bytes = (uint8_t*)points;
 
-		out_verts[5].pos.x = quad[2].x;
-		out_verts[5].pos.y = quad[2].y;
-		out_verts[5].uv.x = s->maxx;
-		out_verts[5].uv.y = s->miny;
+	int simd_count = count - count % SIMD_WIDTH;
+	for (int i = 0; i < simd_count; i += SIMD_WIDTH)
+	{
+		// Points are usually interleaved with other vertex attributes, so gather them up first.
+		float x[SIMD_WIDTH];
+		float y[SIMD_WIDTH];
+		for (int j = 0; j < SIMD_WIDTH; ++j) {
+			v2* p = (v2*)(bytes + (i + j) * stride);
+			x[j] = p->x;
+			y[j] = p->y;
+		}
+
+		simd_t tx, ty;
+		simd_mul_point(mw, simd_load(x), simd_load(y), &tx, &ty);
+		simd_store(x, tx);
+		simd_store(y, ty);
+
+		for (int j = 0; j < SIMD_WIDTH; ++j) {
+			v2* p = (v2*)(bytes + (i + j) * stride);
+			p->x = x[j];
+			p->y = y[j];
+		}
 	}
 
-	// Map the vertex buffer with sprite vertex data.
-	error_t err = triple_buffer_append(&b->sprite_buffer, vert_count, verts);
-	CUTE_ASSERT(!err.is_error());
+	batch_transform_points_scalar((v2*)(bytes + simd_count * stride), count - simd_count, stride, m);
+}
 
-	// Setup resource bindings.
-	sg_bindings bind = b->sprite_buffer.bind();
-	bind.fs_images[0].id = (uint32_t)sprites->texture_id;
-	sg_apply_bindings(bind);
+#else
 
-	// Apply uniforms.
-	// TODO - Move MVP to the spritebatch_flush function as an optimization.
+void batch_make_sprite_verts(const spritebatch_sprite_t* sprites, int count, m3x2 m, quad_vertex_t* verts)
+{
+	batch_make_sprite_verts_scalar(sprites, count, m, verts);
+}
 
+void batch_make_sprite_instances(const spritebatch_sprite_t* sprites, int count, sprite_instance_t* instances)
+{
+	s_make_sprite_instances_scalar(sprites, count, instances);
+}
+
+int batch_cull_sprites(spritebatch_internal_sprite_t* sprites, int count, m3x2 m)
+{
+	return batch_cull_sprites_scalar(sprites, count, m);
+}
+
+void batch_transform_points(v2* points, int count, int stride, m3x2 m)
+{
+	batch_transform_points_scalar(points, count, stride, m);
+}
+
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// spritebatch_t callbacks.
+
+static void s_apply_sprite_uniforms(batch_t* b, matrix_t mvp, int texture_w, int texture_h)
+{
 	// Set shader-specific uniforms.
 	switch (b->sprite_shd_type)
 	{
 	case BATCH_SPRITE_SHADER_TYPE_DEFAULT:
 	{
 		sprite_default_vs_params_t vs_params;
-		vs_params.u_mvp = b->projection;
+		vs_params.u_mvp = mvp;
 		sprite_default_fs_params_t fs_params;
 		fs_params.u_texture_size = v2(b->atlas_width, b->atlas_height);
 		fs_params.u_tint = b->tints.last();
@@ -288,7 +616,7 @@ static void s_batch_report(spritebatch_sprite_t* sprites, int count, int texture
 	case BATCH_SPRITE_SHADER_TYPE_OUTLINE:
 	{
 		sprite_outline_vs_params_t vs_params;
-		vs_params.u_mvp = b->projection;
+		vs_params.u_mvp = mvp;
 		sprite_outline_fs_params_t fs_params;
 		fs_params.u_texture_size = v2(b->atlas_width, b->atlas_height);
 		fs_params.u_tint = b->tints.last();
@@ -300,9 +628,78 @@ static void s_batch_report(spritebatch_sprite_t* sprites, int count, int texture
 		sg_apply_uniforms(SG_SHADERSTAGE_FS, 0, SG_RANGE(fs_params));
 	}	break;
 	}
+}
+
+static void s_draw_sprites(batch_t* b, spritebatch_sprite_t* sprites, int count, int texture_w, int texture_h)
+{
+	// Build vertex buffer of all quads for each sprite.
+	int vert_count = count * 4;
+	b->sprite_verts.ensure_count(vert_count);
+	quad_vertex_t* verts = b->sprite_verts.data();
+
+	m3x2 m = make_identity();
+	if (b->m3x2s.count()) {
+		m = b->m3x2s.last();
+	}
+
+	batch_make_sprite_verts(sprites, count, m, verts);
+
+	// Map the vertex buffer with sprite vertex data.
+	error_t err = triple_buffer_append(&b->sprite_buffer, vert_count, verts);
+	CUTE_ASSERT(!err.is_error());
+	b->stats.buffer_bytes_uploaded += vert_count * (int)sizeof(quad_vertex_t);
+
+	// Setup resource bindings. Every quad shares the same static index buffer.
+	sg_bindings bind = b->sprite_buffer.bind();
+	bind.index_buffer = b->quad_indices;
+	bind.index_buffer_offset = 0;
+	bind.fs_images[0].id = (uint32_t)sprites->texture_id;
+	sg_apply_bindings(bind);
+
+	// Apply uniforms.
+	// TODO - Move MVP to the spritebatch_flush function as an optimization.
+	s_apply_sprite_uniforms(b, b->projection, texture_w, texture_h);
 
 	// Kick off a draw call.
-	sg_draw(0, vert_count, 1);
+	sg_draw(0, count * 6, 1);
+	b->stats.draw_calls++;
+}
+
+static void s_capture_sprites(batch_static_t* s, spritebatch_sprite_t* sprites, int count, int texture_w, int texture_h)
+{
+	// Vertices stay in world space, the transform is applied when drawing.
+	while (count) {
+		int quad_count = min(count, CUTE_BATCH_MAX_QUADS_PER_DRAW);
+		batch_static_range_t range;
+		range.texture_id = sprites->texture_id;
+		range.first_quad = s->verts.count() / 4;
+		range.quad_count = quad_count;
+		range.texture_w = texture_w;
+		range.texture_h = texture_h;
+		s->ranges.add(range);
+		s->verts.ensure_count(s->verts.count() + quad_count * 4);
+		batch_make_sprite_verts(sprites, quad_count, make_identity(), s->verts.data() + range.first_quad * 4);
+		sprites += quad_count;
+		count -= quad_count;
+	}
+}
+
+static void s_batch_report(spritebatch_sprite_t* sprites, int count, int texture_w, int texture_h, void* udata)
+{
+	batch_t* b = (batch_t*)udata;
+
+	if (b->capturing) {
+		s_capture_sprites(b->capturing, sprites, count, texture_w, texture_h);
+		return;
+	}
+
+	// The index buffer only reaches so far, so split up any huge batches.
+	while (count > CUTE_BATCH_MAX_QUADS_PER_DRAW) {
+		s_draw_sprites(b, sprites, CUTE_BATCH_MAX_QUADS_PER_DRAW, texture_w, texture_h);
+		sprites += CUTE_BATCH_MAX_QUADS_PER_DRAW;
+		count -= CUTE_BATCH_MAX_QUADS_PER_DRAW;
+	}
+	s_draw_sprites(b, sprites, count, texture_w, texture_h);
 }
 
 static void s_get_pixels(SPRITEBATCH_U64 image_id, void* buffer, int bytes_to_fill, void* udata)
@@ -314,6 +711,7 @@ static void s_get_pixels(SPRITEBATCH_U64 image_id, void* buffer, int bytes_to_fi
 static SPRITEBATCH_U64 s_generate_texture_handle(void* pixels, int w, int h, void* udata)
 {
 	batch_t* b = (batch_t*)udata;
+	b->stats.texture_bytes_uploaded += w * h * (int)sizeof(pixel_t);
 	return texture_make((pixel_t*)pixels, w, h, b->wrap_mode, b->filter);
 }
 
@@ -321,6 +719,73 @@ static void s_destroy_texture_handle(SPRITEBATCH_U64 texture_id, void* udata)
 {
 	batch_t* b = (batch_t*)udata;
 	texture_destroy(texture_id);
+
+	// Images only ever move by going into a new texture and destroying the old one, so this is all static
+	// batches need to know to stay up to date.
+	for (int i = 0; i < b->statics.count(); ++i) {
+		batch_static_t* s = b->statics[i];
+		if (s->dirty) continue;
+		for (int j = 0; j < s->ranges.count(); ++j) {
+			if (s->ranges[j].texture_id == texture_id) {
+				s->dirty = true;
+				break;
+			}
+		}
+	}
+}
+
+static void s_run_atlas_job(void* udata)
+{
+	batch_atlas_job_t* job = (batch_atlas_job_t*)udata;
+	spritebatch_atlas_job_run(job->job);
+	atomic_set(&job->done, 1);
+}
+
+static void s_build_atlas(spritebatch_atlas_job_t* atlas_job, void* udata)
+{
+	batch_t* b = (batch_t*)udata;
+	batch_atlas_job_t* job = CUTE_NEW(batch_atlas_job_t, b->mem_ctx);
+	job->job = atlas_job;
+	b->atlas_jobs.add(job);
+
+	if (b->atlas_pool) {
+		threadpool_add_task(b->atlas_pool, s_run_atlas_job, job);
+		threadpool_kick(b->atlas_pool);
+	} else {
+		// No worker thread, build it right away but still swap it in on the next update.
+		s_run_atlas_job(job);
+	}
+}
+
+static void s_finish_atlas_jobs(batch_t* b, bool wait)
+{
+	if (wait && b->atlas_jobs.count() && b->atlas_pool) {
+		threadpool_kick_and_wait(b->atlas_pool);
+	}
+
+	int i = 0;
+	while (i < b->atlas_jobs.count()) {
+		batch_atlas_job_t* job = b->atlas_jobs[i];
+		if (!atomic_get(&job->done)) {
+			CUTE_ASSERT(!wait);
+			++i;
+			continue;
+		}
+		spritebatch_atlas_job_finish(&b->sb, job->job);
+		job->~batch_atlas_job_t();
+		CUTE_FREE(job, b->mem_ctx);
+		b->atlas_jobs.remove(i);
+	}
+}
+
+void batch_radix_sort_sprites(spritebatch_sprite_t* sprites, int count)
+{
+	array<spritebatch_sprite_t> sorted;
+	array<uint8_t> sort_buffer;
+	sorted.ensure_count(count);
+	sort_buffer.ensure_count((int)SPRITEBATCH_INTERNAL_SORT_BYTES_PER_SPRITE * count);
+	spritebatch_internal_radix_sort(sprites, sorted.data(), sort_buffer.data(), count);
+	CUTE_MEMCPY(sprites, sorted.data(), sizeof(spritebatch_sprite_t) * count);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -343,10 +808,12 @@ static void s_sync_pip(batch_t* b)
 		params.layout.attrs[2].offset = CUTE_OFFSET_OF(quad_vertex_t, alpha);
 		params.layout.attrs[2].format = SG_VERTEXFORMAT_FLOAT;
 		params.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
+		params.index_type = SG_INDEXTYPE_UINT16;
 		params.shader = b->active_shd;
 		params.stencil = b->stencil_states.last();
 		params.colors[0].blend = b->blend_states.last();
 		b->pip = sg_make_pipeline(params);
+
 		b->pip_dirty = false;
 	}
 }
@@ -357,9 +824,14 @@ batch_t* batch_make(get_pixels_fn* get_pixels, void* get_pixels_udata, void* mem
 	if (!b) return NULL;
 
 	b->projection = matrix_identity();
+	b->thread = thread_id();
 	b->get_pixels = get_pixels;
 	b->get_pixels_udata = get_pixels_udata;
 	b->mem_ctx = mem_ctx;
+	for (int i = 0; i < core_count() + 1; ++i) {
+		b->push_buffers.add(CUTE_NEW(batch_push_buffer_t, b->mem_ctx));
+	}
+	thread_claims_init(&b->push_buffer_claims, b->push_buffers.count());
 
 	sg_pipeline_desc params = { 0 };
 	params.layout.buffers[0].stride = sizeof(vertex_t);
@@ -372,7 +844,8 @@ batch_t* batch_make(get_pixels_fn* get_pixels, void* get_pixels_udata, void* mem
 	params.layout.attrs[1].offset = CUTE_OFFSET_OF(vertex_t, c);
 	params.layout.attrs[1].format = SG_VERTEXFORMAT_FLOAT4;
 	params.primitive_type = SG_PRIMITIVETYPE_TRIANGLES;
-	params.shader = sg_make_shader(geom_shd_shader_desc(sg_query_backend()));
+	params.index_type = SG_INDEXTYPE_UINT16;
+	params.shader = sg_make_shader(geom_shd_shader_desc(app_shader_backend()));
 	params.colors[0].blend.enabled = true;
 	params.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
 	params.colors[0].blend.dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
@@ -382,7 +855,7 @@ batch_t* batch_make(get_pixels_fn* get_pixels, void* get_pixels_udata, void* mem
 	params.colors[0].blend.op_alpha = SG_BLENDOP_ADD;
 
 	b->geom_pip = sg_make_pipeline(params);
-	b->geom_buffer = triple_buffer_make(sizeof(vertex_t) * 1024 * 10, sizeof(vertex_t));
+	b->geom_buffer = triple_buffer_make(sizeof(vertex_t) * 1024 * 10, sizeof(vertex_t), 1024 * 15, sizeof(uint16_t));
 
 	batch_push_stencil_defaults(b);
 	batch_push_blend_defaults(b);
@@ -390,6 +863,16 @@ batch_t* batch_make(get_pixels_fn* get_pixels, void* get_pixels_udata, void* mem
 	b->outline_shd = s_load_shader(b, BATCH_SPRITE_SHADER_TYPE_OUTLINE);
 	b->sprite_buffer = triple_buffer_make(sizeof(quad_vertex_t) * 1024 * 10, sizeof(quad_vertex_t));
 
+	// Sprites are always quads, so one static index buffer can be shared by all of them.
+	array<uint16_t> indices;
+	indices.ensure_count(CUTE_BATCH_MAX_QUADS_PER_DRAW * 6);
+	batch_make_quad_indices(indices.data(), CUTE_BATCH_MAX_QUADS_PER_DRAW);
+	sg_buffer_desc index_params = { 0 };
+	index_params.type = SG_BUFFERTYPE_INDEXBUFFER;
+	index_params.usage = SG_USAGE_IMMUTABLE;
+	index_params.data = { indices.data(), (size_t)indices.count() * sizeof(uint16_t) };
+	b->quad_indices = sg_make_buffer(index_params);
+
 	spritebatch_config_t config;
 	spritebatch_set_default_config(&config);
 	config.atlas_use_border_pixels = 1;
@@ -402,8 +885,14 @@ batch_t* batch_make(get_pixels_fn* get_pixels, void* get_pixels_udata, void* mem
 	config.lonely_buffer_count_till_flush = 0;
 
 	if (spritebatch_init(&b->sb, &config, b)) {
+		thread_claims_destroy(&b->push_buffer_claims);
+		for (int i = 0; i < b->push_buffers.count(); ++i) {
+			b->push_buffers[i]->~batch_push_buffer_t();
+			CUTE_FREE(b->push_buffers[i], b->mem_ctx);
+		}
+		b->~batch_t();
 		CUTE_FREE(b, app->mem_ctx);
-		if (!b) return NULL;
+		return NULL;
 	}
 
 	b->atlas_width = (float)config.atlas_width_in_pixels;
@@ -415,12 +904,50 @@ batch_t* batch_make(get_pixels_fn* get_pixels, void* get_pixels_udata, void* mem
 
 void batch_destroy(batch_t* b)
 {
+	while (b->statics.count()) {
+		batch_static_destroy(b->statics.last());
+	}
+	s_finish_atlas_jobs(b, true);
+	if (b->atlas_pool) threadpool_destroy(b->atlas_pool);
 	spritebatch_term(&b->sb);
+	thread_claims_destroy(&b->push_buffer_claims);
+	for (int i = 0; i < b->push_buffers.count(); ++i) {
+		b->push_buffers[i]->~batch_push_buffer_t();
+		CUTE_FREE(b->push_buffers[i], b->mem_ctx);
+	}
+	batch_arc_table_t** arc_tables = b->arc_tables.items();
+	for (int i = 0; i < b->arc_tables.count(); ++i) {
+		arc_tables[i]->~batch_arc_table_t();
+		CUTE_FREE(arc_tables[i], b->mem_ctx);
+	}
+	batch_set_polyline_cache(b, false);
 	b->~batch_t();
 	CUTE_FREE(b, b->mem_ctx);
 }
 
-void batch_push(batch_t* b, batch_sprite_t q)
+static int s_lock_push_buffer(batch_t* b)
+{
+	// Threads claim a buffer the first time they push a sprite, and keep it from then on.
+	return thread_claims_lock(&b->push_buffer_claims);
+}
+
+static void s_unlock_push_buffer(batch_t* b, int index)
+{
+	thread_claims_unlock(&b->push_buffer_claims, index);
+}
+
+static void s_merge_push_buffers(batch_t* b)
+{
+	// The sort in `spritebatch_flush` is stable, so sprites keep the order they were pushed in within
+	// each thread. Across threads only `sort_bits` decides.
+	for (int i = 0; i < b->push_buffers.count(); ++i) {
+		batch_push_buffer_t* buffer = b->push_buffers[i];
+		spritebatch_push_many(&b->sb, buffer->sprites.data(), buffer->sprites.count());
+		buffer->sprites.clear();
+	}
+}
+
+static spritebatch_sprite_t s_make_sprite(batch_sprite_t q)
 {
 	spritebatch_sprite_t s;
 	s.image_id = q.id;
@@ -432,9 +959,117 @@ void batch_push(batch_t* b, batch_sprite_t q)
 	s.sy = q.scale_y;
 	s.s = q.transform.r.s;
 	s.c = q.transform.r.c;
-	s.sort_bits = (uint64_t)q.sort_bits << 32;
+	s.sort_bits = q.sort_bits;
 	s.udata.alpha = q.alpha;
-	spritebatch_push(&b->sb, s);
+	return s;
+}
+
+void batch_push(batch_t* b, batch_sprite_t q)
+{
+	spritebatch_sprite_t s = s_make_sprite(q);
+	if (thread_id() == b->thread) {
+		spritebatch_push(&b->sb, s);
+	} else {
+		int index = s_lock_push_buffer(b);
+		b->push_buffers[index]->sprites.add(s);
+		s_unlock_push_buffer(b, index);
+	}
+}
+
+static void s_transform_geom(batch_t* b)
+{
+	// Geometry is transformed by the `m3x2` that was current when it was pushed. Rather than one vertex at a time,
+	// all vertices pushed under the same `m3x2` are transformed together, right before it changes or is flushed.
+	int count = b->geom_verts.count() - b->geom_verts_transformed;
+	if (!count) return;
+	m3x2 m = make_identity();
+	if (b->m3x2s.count()) {
+		m = b->m3x2s.last();
+	}
+	batch_transform_points(&b->geom_verts[b->geom_verts_transformed].p, count, (int)sizeof(vertex_t), m);
+	b->geom_verts_transformed = b->geom_verts.count();
+}
+
+static void s_cull_sprites(batch_t* b)
+{
+	// Sprites are drawn with the `m3x2` on top of the stack during the flush, so cull with that same one.
+	m3x2 m = make_identity();
+	if (b->m3x2s.count()) {
+		m = b->m3x2s.last();
+	}
+
+	// Only the 2D part of the projection matters, as the batch draws everything at z = 0.
+	m3x2 projection;
+	projection.m.x = v2(b->projection.data[0], b->projection.data[1]);
+	projection.m.y = v2(b->projection.data[4], b->projection.data[5]);
+	projection.p = v2(b->projection.data[12], b->projection.data[13]);
+
+	spritebatch_t* sb = &b->sb;
+	sb->input_count = batch_cull_sprites(sb->input_buffer, sb->input_count, mul(projection, m));
+}
+
+static spritebatch_sprite_t* s_begin_push_many(batch_t* b, int count, int* index)
+{
+	// Sprites are converted straight into the thread's push buffer, or into a scratch buffer handed over to
+	// `spritebatch_push_many`. Either way room for all of them is made just once.
+	array<spritebatch_sprite_t>* sprites;
+	if (thread_id() == b->thread) {
+		*index = -1;
+		sprites = &b->push_many_buffer;
+		sprites->clear();
+	} else {
+		*index = s_lock_push_buffer(b);
+		sprites = &b->push_buffers[*index]->sprites;
+	}
+	int first = sprites->count();
+	sprites->ensure_count(first + count);
+	return sprites->data() + first;
+}
+
+static void s_end_push_many(batch_t* b, int count, int index)
+{
+	if (index == -1) {
+		spritebatch_push_many(&b->sb, b->push_many_buffer.data(), count);
+	} else {
+		s_unlock_push_buffer(b, index);
+	}
+}
+
+void batch_push_many(batch_t* b, const batch_sprite_t* sprites, int count)
+{
+	if (count <= 0) return;
+	int index;
+	spritebatch_sprite_t* out = s_begin_push_many(b, count, &index);
+	for (int i = 0; i < count; ++i) {
+		out[i] = s_make_sprite(sprites[i]);
+	}
+	s_end_push_many(b, count, index);
+}
+
+void batch_push_many(batch_t* b, batch_sprite_t sprite, const v2* positions, const v2* scales, const sincos_t* rotations, int count)
+{
+	if (count <= 0) return;
+	int index;
+	spritebatch_sprite_t* out = s_begin_push_many(b, count, &index);
+	spritebatch_sprite_t s = s_make_sprite(sprite);
+	for (int i = 0; i < count; ++i) {
+		out[i] = s;
+		out[i].x = positions[i].x;
+		out[i].y = positions[i].y;
+	}
+	if (scales) {
+		for (int i = 0; i < count; ++i) {
+			out[i].sx = scales[i].x;
+			out[i].sy = scales[i].y;
+		}
+	}
+	if (rotations) {
+		for (int i = 0; i < count; ++i) {
+			out[i].s = rotations[i].s;
+			out[i].c = rotations[i].c;
+		}
+	}
+	s_end_push_many(b, count, index);
 }
 
 error_t batch_flush(batch_t* b)
@@ -448,41 +1083,187 @@ error_t batch_flush(batch_t* b)
 		sg_apply_scissor_rect(scissor.x, scissor.y, scissor.w, scissor.h, false);
 	}
 
+	b->stats.draw_calls = 0;
+	s_merge_push_buffers(b);
+	if (b->use_culling) {
+		s_cull_sprites(b);
+	}
 	spritebatch_flush(&b->sb);
 
 	b->sprite_buffer.advance();
 
 	// Draw geometry.
 	if (b->geom_verts.count()) {
-		// Transform verts.
-		m3x2 m = make_identity();
-		if (b->m3x2s.count()) {
-			m = b->m3x2s.last();
-		}
-		for (int i = 0; i < b->geom_verts.count(); ++i) {
-			b->geom_verts[i].p = mul(m, b->geom_verts[i].p);
-		}
+		s_transform_geom(b);
 
 		// Issue draw call.
 		sg_apply_pipeline(b->geom_pip);
 		geom_vs_params_t params;
 		params.u_mvp = b->projection;
 		sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, SG_RANGE(params));
-		error_t err = triple_buffer_append(&b->geom_buffer, b->geom_verts.count(), b->geom_verts.data());
+		error_t err = triple_buffer_append(&b->geom_buffer, b->geom_verts.count(), b->geom_verts.data(), b->geom_indices.count(), b->geom_indices.data());
 		CUTE_ASSERT(!err.is_error());
+		b->stats.buffer_bytes_uploaded += b->geom_verts.count() * (int)sizeof(vertex_t) + b->geom_indices.count() * (int)sizeof(uint16_t);
 		sg_apply_bindings(b->geom_buffer.bind());
-		sg_draw(0, b->geom_verts.count(), 1);
+		sg_draw(0, b->geom_indices.count(), 1);
+		b->stats.draw_calls++;
 		b->geom_verts.clear();
+		b->geom_indices.clear();
+		b->geom_verts_transformed = 0;
 		b->geom_buffer.advance();
 	}
 
 	return error_success();
 }
 
+static void s_free_polyline_cache_entry(batch_polyline_cache_entry_t* entry, void* mem_ctx)
+{
+	entry->~batch_polyline_cache_entry_t();
+	CUTE_FREE(entry, mem_ctx);
+}
+
 void batch_update(batch_t* b)
 {
+	b->stats.texture_bytes_uploaded = 0;
+	b->stats.buffer_bytes_uploaded = 0;
+	s_finish_atlas_jobs(b, false);
 	spritebatch_tick(&b->sb);
 	spritebatch_defrag(&b->sb);
+
+	// Drop cached polylines that were not drawn since the last update.
+	frame_cache_evict_unused(&b->polyline_cache, &b->polyline_cache_updates, s_free_polyline_cache_entry, b->mem_ctx);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+batch_static_t* batch_static_make(batch_t* b, const batch_sprite_t* sprites, int count)
+{
+	batch_static_t* s = CUTE_NEW(batch_static_t, b->mem_ctx);
+	if (!s) return NULL;
+	s->batch = b;
+	batch_static_set_sprites(s, sprites, count);
+	b->statics.add(s);
+	return s;
+}
+
+void batch_static_destroy(batch_static_t* s)
+{
+	batch_t* b = s->batch;
+	for (int i = 0; i < b->statics.count(); ++i) {
+		if (b->statics[i] == s) {
+			b->statics.unordered_remove(i);
+			break;
+		}
+	}
+	if (s->buffer.id != SG_INVALID_ID) sg_destroy_buffer(s->buffer);
+	s->~batch_static_t();
+	CUTE_FREE(s, b->mem_ctx);
+}
+
+void batch_static_set_sprites(batch_static_t* s, const batch_sprite_t* sprites, int count)
+{
+	s->sprites.clear();
+	s->sprites.ensure_count(count);
+	for (int i = 0; i < count; ++i) {
+		s->sprites[i] = s_make_sprite(sprites[i]);
+	}
+	s->dirty = true;
+}
+
+void batch_static_mark_dirty(batch_static_t* s)
+{
+	s->dirty = true;
+}
+
+static void s_static_rebuild(batch_static_t* s)
+{
+	batch_t* b = s->batch;
+	s->dirty = false;
+	s->verts.clear();
+	s->ranges.clear();
+
+	// Run the sprites through the spritebatch to sort them and look up their atlases, recording the
+	// batches instead of drawing them. Anything pushed so far this frame is set aside meanwhile, so
+	// only the static sprites are flushed.
+	int input_count = b->sb.input_count;
+	b->input_stash.ensure_count(input_count);
+	CUTE_MEMCPY(b->input_stash.data(), b->sb.input_buffer, sizeof(spritebatch_internal_sprite_t) * input_count);
+	b->sb.input_count = 0;
+	for (int i = 0; i < s->sprites.count(); ++i) {
+		spritebatch_push(&b->sb, s->sprites[i]);
+	}
+	b->capturing = s;
+	spritebatch_flush(&b->sb);
+	b->capturing = NULL;
+	CUTE_MEMCPY(b->sb.input_buffer, b->input_stash.data(), sizeof(spritebatch_internal_sprite_t) * input_count);
+	b->sb.input_count = input_count;
+
+	if (s->buffer.id != SG_INVALID_ID) sg_destroy_buffer(s->buffer);
+	s->buffer = { 0 };
+	if (s->verts.count()) {
+		sg_buffer_desc params = { 0 };
+		params.usage = SG_USAGE_IMMUTABLE;
+		params.data = { s->verts.data(), (size_t)s->verts.count() * sizeof(quad_vertex_t) };
+		s->buffer = sg_make_buffer(params);
+		b->stats.buffer_bytes_uploaded += (int)params.data.size;
+	}
+}
+
+static matrix_t s_mul(matrix_t projection, m3x2 m)
+{
+	// Expand `m` to a column-major 4x4 matrix, then multiply.
+	matrix_t t = matrix_identity();
+	t.data[0] = m.m.x.x;
+	t.data[1] = m.m.x.y;
+	t.data[4] = m.m.y.x;
+	t.data[5] = m.m.y.y;
+	t.data[12] = m.p.x;
+	t.data[13] = m.p.y;
+
+	matrix_t result;
+	for (int col = 0; col < 4; ++col) {
+		for (int row = 0; row < 4; ++row) {
+			float sum = 0;
+			for (int k = 0; k < 4; ++k) {
+				sum += projection.data[k * 4 + row] * t.data[col * 4 + k];
+			}
+			result.data[col * 4 + row] = sum;
+		}
+	}
+	return result;
+}
+
+void batch_static_draw(batch_static_t* s)
+{
+	batch_t* b = s->batch;
+	if (s->dirty) s_static_rebuild(s);
+	if (!s->ranges.count()) return;
+
+	s_sync_pip(b);
+	sg_apply_pipeline(b->pip);
+
+	if (b->scissors.count()) {
+		scissor_t scissor = b->scissors.last();
+		sg_apply_scissor_rect(scissor.x, scissor.y, scissor.w, scissor.h, false);
+	}
+
+	m3x2 m = make_identity();
+	if (b->m3x2s.count()) {
+		m = b->m3x2s.last();
+	}
+	matrix_t mvp = s_mul(b->projection, m);
+
+	for (int i = 0; i < s->ranges.count(); ++i) {
+		const batch_static_range_t* range = s->ranges + i;
+		sg_bindings bind = { 0 };
+		bind.vertex_buffers[0] = s->buffer;
+		bind.vertex_buffer_offsets[0] = range->first_quad * 4 * (int)sizeof(quad_vertex_t);
+		bind.index_buffer = b->quad_indices;
+		bind.fs_images[0].id = (uint32_t)range->texture_id;
+		sg_apply_bindings(bind);
+		s_apply_sprite_uniforms(b, mvp, range->texture_w, range->texture_h);
+		sg_draw(0, range->quad_count * 6, 1);
+	}
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -512,6 +1293,43 @@ void batch_outlines(batch_t* b, bool use_outlines)
 	}
 }
 
+void batch_set_culling(batch_t* b, bool use_culling)
+{
+	b->use_culling = use_culling;
+}
+
+void batch_set_async_atlases(batch_t* b, bool use_async_atlases)
+{
+	if (use_async_atlases && !b->atlas_pool) {
+		// Atlases rarely build back to back, one worker is enough to keep them out of `batch_update`.
+		b->atlas_pool = threadpool_create(1, b->mem_ctx);
+	}
+	b->sb.build_atlas_callback = use_async_atlases ? s_build_atlas : NULL;
+}
+
+void batch_set_atlas_packing(batch_t* b, batch_atlas_packing_t packing)
+{
+	switch (packing) {
+	case BATCH_ATLAS_PACKING_BEST_FIT: b->sb.atlas_packing = SPRITEBATCH_ATLAS_PACKING_BEST_FIT; break;
+	case BATCH_ATLAS_PACKING_SKYLINE: b->sb.atlas_packing = SPRITEBATCH_ATLAS_PACKING_SKYLINE; break;
+	case BATCH_ATLAS_PACKING_MAXRECTS: b->sb.atlas_packing = SPRITEBATCH_ATLAS_PACKING_MAXRECTS; break;
+	}
+}
+
+batch_stats_t batch_get_stats(batch_t* b)
+{
+	spritebatch_atlas_stats_t atlas_stats;
+	spritebatch_get_atlas_stats(&b->sb, &atlas_stats);
+
+	batch_stats_t stats = b->stats;
+	stats.atlas_count = atlas_stats.atlas_count;
+	stats.atlas_fill_ratio = atlas_stats.fill_ratio;
+	stats.lonely_texture_count = atlas_stats.lonely_texture_count;
+	stats.atlases_built = atlas_stats.atlases_built;
+	stats.atlases_removed = atlas_stats.atlases_flushed;
+	return stats;
+}
+
 void batch_outlines_use_corners(batch_t* b, bool use_corners)
 {
 	b->outline_use_corners = use_corners ? 1.0f : 0;
@@ -524,11 +1342,13 @@ void batch_outlines_color(batch_t* b, color_t c)
 
 void batch_push_m3x2(batch_t* b, m3x2 m)
 {
+	s_transform_geom(b);
 	b->m3x2s.add(m);
 }
 
 void batch_pop_m3x2(batch_t* b)
 {
+	s_transform_geom(b);
 	if (b->m3x2s.count() > 1) {
 		b->m3x2s.pop();
 	}
@@ -644,23 +1464,47 @@ void batch_quad(batch_t* b, aabb_t bb, color_t c)
 		b->geom_verts.add(v); \
 	} while (0)
 
+#define PUSH_INDEX(i) \
+	do { \
+		CUTE_ASSERT((i) <= UINT16_MAX); \
+		b->geom_indices.add((uint16_t)(i)); \
+	} while (0)
+
 #define PUSH_TRI(p0, p1, p2, c0, c1, c2) \
 	do { \
+		int base = b->geom_verts.count(); \
 		PUSH_VERT(p0, c0); \
 		PUSH_VERT(p1, c1); \
 		PUSH_VERT(p2, c2); \
+		PUSH_INDEX(base + 0); \
+		PUSH_INDEX(base + 1); \
+		PUSH_INDEX(base + 2); \
+	} while (0)
+
+// Quads share two of their vertices between both triangles.
+#define PUSH_QUAD(p0, p1, p2, p3, c0, c1, c2, c3) \
+	do { \
+		int base = b->geom_verts.count(); \
+		PUSH_VERT(p0, c0); \
+		PUSH_VERT(p1, c1); \
+		PUSH_VERT(p2, c2); \
+		PUSH_VERT(p3, c3); \
+		PUSH_INDEX(base + 0); \
+		PUSH_INDEX(base + 1); \
+		PUSH_INDEX(base + 2); \
+		PUSH_INDEX(base + 2); \
+		PUSH_INDEX(base + 3); \
+		PUSH_INDEX(base + 0); \
 	} while (0)
 
 void batch_quad(batch_t* b, v2 p0, v2 p1, v2 p2, v2 p3, color_t c)
 {
-	PUSH_TRI(p0, p1, p2, c, c, c);
-	PUSH_TRI(p2, p3, p0, c, c, c);
+	PUSH_QUAD(p0, p1, p2, p3, c, c, c, c);
 }
 
 void batch_quad(batch_t* b, v2 p0, v2 p1, v2 p2, v2 p3, color_t c0, color_t c1, color_t c2, color_t c3)
 {
-	PUSH_TRI(p0, p1, p2, c0, c1, c2);
-	PUSH_TRI(p2, p3, p0, c2, c3, c0);
+	PUSH_QUAD(p0, p1, p2, p3, c0, c1, c2, c3);
 }
 
 void batch_quad_line(batch_t* b, aabb_t bb, float thickness, color_t c)
@@ -689,13 +1533,48 @@ void batch_quad_line(batch_t* b, v2 p0, v2 p1, v2 p2, v2 p3, float thickness, co
 	batch_quad(b, p3, p0, q0, q3, c0, c1, c2, c3);
 }
 
+#define CUTE_BATCH_MAX_ARC_TABLES 256
+
+static const v2* s_arc_table(batch_t* b, float range, int iters)
+{
+	// Circles and arcs are drawn over and over with the same few ranges and iteration counts, so their
+	// points are only computed once and scaled, rotated and translated into place afterwards.
+	iters = max(iters, 0);
+	union { float f; uint32_t u; } range_bits = { range };
+	uint64_t key = ((uint64_t)range_bits.u << 32) | (uint64_t)(uint32_t)iters;
+	batch_arc_table_t** table = b->arc_tables.find(key);
+	if (table) return (*table)->points.data();
+
+	// Arcs with constantly changing ranges would fill the cache up, so past a limit just recompute.
+	array<v2>* points = &b->arc_scratch;
+	if (b->arc_tables.count() < CUTE_BATCH_MAX_ARC_TABLES) {
+		batch_arc_table_t* new_table = CUTE_NEW(batch_arc_table_t, b->mem_ctx);
+		b->arc_tables.insert(key, new_table);
+		points = &new_table->points;
+	}
+	points->ensure_count(iters + 1);
+	(*points)[0] = v2(1, 0);
+	for (int i = 1; i <= iters; ++i) {
+		(*points)[i] = from_angle((i / (float)iters) * range);
+	}
+	return points->data();
+}
+
+static CUTE_INLINE sincos_t s_sincos(v2 unit)
+{
+	sincos_t r;
+	r.s = unit.y;
+	r.c = unit.x;
+	return r;
+}
+
 void batch_circle(batch_t* b, v2 p, float r, int iters, color_t c)
 {
+	const v2* table = s_arc_table(b, 2.0f * CUTE_PI, iters);
 	v2 prev = v2(r, 0);
 
 	for (int i = 1; i <= iters; ++i) {
-		float a = (i / (float)iters) * (2.0f * CUTE_PI);
-		v2 next = from_angle(a) * r;
+		v2 next = table[i] * r;
 		batch_tri(b, p + prev, p + next, p, c);
 		prev = next;
 	}
@@ -703,13 +1582,13 @@ void batch_circle(batch_t* b, v2 p, float r, int iters, color_t c)
 
 void batch_circle_line(batch_t* batch, v2 p, float r, int iters, float thickness, color_t color)
 {
+	const v2* table = s_arc_table(batch, 2.0f * CUTE_PI, iters);
 	float half_thickness = thickness * 0.5f;
 	v2 p0 = v2(p.x + r - half_thickness, p.y);
 	v2 p1 = v2(p.x + r + half_thickness, p.y);
 
 	for (int i = 1; i <= iters; i++) {
-		float a = (i / (float)iters) * (2.0f * CUTE_PI);
-		v2 n = from_angle(a);
+		v2 n = table[i];
 		v2 p2 = p + n * (r + half_thickness);
 		v2 p3 = p + n * (r - half_thickness);
 		batch_quad(batch, p0, p1, p2, p3, color);
@@ -727,11 +1606,10 @@ void batch_circle_arc(batch_t* batch, v2 p, v2 center_of_arc, float range, int i
 	v2 t = mulT(m, d);
 	v2 p0 = p + t * r;
 	d = norm(p0 - p);
-	float inc = range / iters;
+	const v2* table = s_arc_table(batch, range, iters);
 
 	for (int i = 1; i <= iters; i++) {
-		m = sincos(i * inc);
-		t = mul(m, d);
+		t = mul(s_sincos(table[i]), d);
 		v2 p1 = p + t * r;
 		batch_tri(batch, p, p1, p0, color);
 		p0 = p1;
@@ -749,11 +1627,10 @@ void batch_circle_arc_line(batch_t* batch, v2 p, v2 center_of_arc, float range,
 	v2 p0 = p + t * (r + half_thickness);
 	v2 p1 = p + t * (r - half_thickness);
 	d = norm(p0 - p);
-	float inc = range / iters;
+	const v2* table = s_arc_table(batch, range, iters);
 
 	for (int i = 1; i <= iters; i++) {
-		m = sincos(i * inc);
-		t = mul(m, d);
+		t = mul(s_sincos(table[i]), d);
 		v2 p2 = p + t * (r + half_thickness);
 		v2 p3 = p + t * (r - half_thickness);
 		batch_quad(batch, p0, p1, p2, p3, color);
@@ -1118,11 +1995,85 @@ static void s_polyline(batch_t* batch, v2* points, int count, float thickness, c
 	}
 }
 
+static batch_polyline_cache_entry_t* s_find_polyline(batch_t* batch, uint64_t key, v2* points, int count, float thickness, color_t color, bool loop, bool antialias, int bevel_count, float alias_scale)
+{
+	batch_polyline_cache_entry_t** entry_ptr = batch->polyline_cache.find(key);
+	if (!entry_ptr) return NULL;
+
+	// Make sure this isn't just a hash collision.
+	batch_polyline_cache_entry_t* entry = *entry_ptr;
+	if (entry->points.count() != count) return NULL;
+	if (CUTE_MEMCMP(entry->points.data(), points, sizeof(v2) * count)) return NULL;
+	if (entry->thickness != thickness || entry->alias_scale != alias_scale) return NULL;
+	if (CUTE_MEMCMP(&entry->color, &color, sizeof(color))) return NULL;
+	if (entry->loop != loop || entry->antialias != antialias || entry->bevel_count != bevel_count) return NULL;
+	return entry;
+}
+
+static void s_cache_polyline(batch_t* batch, uint64_t key, v2* points, int count, float thickness, color_t color, bool loop, bool antialias, int bevel_count, float alias_scale, int first_vert, int first_index)
+{
+	batch_polyline_cache_entry_t** entry_ptr = batch->polyline_cache.find(key);
+	batch_polyline_cache_entry_t* entry;
+	if (entry_ptr) {
+		entry = *entry_ptr;
+	} else {
+		entry = CUTE_NEW(batch_polyline_cache_entry_t, batch->mem_ctx);
+		batch->polyline_cache.insert(key, entry);
+	}
+
+	entry->points.ensure_count(count);
+	CUTE_MEMCPY(entry->points.data(), points, sizeof(v2) * count);
+	entry->thickness = thickness;
+	entry->color = color;
+	entry->loop = loop;
+	entry->antialias = antialias;
+	entry->bevel_count = bevel_count;
+	entry->alias_scale = alias_scale;
+	entry->last_used = batch->polyline_cache_updates;
+
+	int vert_count = batch->geom_verts.count() - first_vert;
+	int index_count = batch->geom_indices.count() - first_index;
+	entry->verts.ensure_count(vert_count);
+	entry->indices.ensure_count(index_count);
+	CUTE_MEMCPY(entry->verts.data(), batch->geom_verts.data() + first_vert, sizeof(vertex_t) * vert_count);
+	for (int i = 0; i < index_count; ++i) {
+		entry->indices[i] = (uint16_t)(batch->geom_indices[first_index + i] - first_vert);
+	}
+}
+
 void batch_polyline(batch_t* batch, v2* points, int count, float thickness, color_t color, bool loop, bool antialias, int bevel_count)
 {
 	CUTE_ASSERT(count >= 3);
 	float scale = len(batch->m3x2s.last().m.x); // Assume x/y uniform scaling.
 	float alias_scale = 1.0f / scale;
+
+	uint64_t key = 0;
+	int first_vert = batch->geom_verts.count();
+	int first_index = batch->geom_indices.count();
+	if (batch->use_polyline_cache) {
+		key = fnv1a(CUTE_FNV1A_OFFSET_BASIS, points, sizeof(v2) * count);
+		key = fnv1a(key, &thickness, sizeof(thickness));
+		key = fnv1a(key, &color, sizeof(color));
+		key = fnv1a(key, &alias_scale, sizeof(alias_scale));
+		uint8_t flags[] = { (uint8_t)loop, (uint8_t)antialias };
+		key = fnv1a(key, flags, sizeof(flags));
+		key = fnv1a(key, &bevel_count, sizeof(bevel_count));
+
+		batch_polyline_cache_entry_t* entry = s_find_polyline(batch, key, points, count, thickness, color, loop, antialias, bevel_count, alias_scale);
+		if (entry) {
+			entry->last_used = batch->polyline_cache_updates;
+			batch->geom_verts.ensure_count(first_vert + entry->verts.count());
+			CUTE_MEMCPY(batch->geom_verts.data() + first_vert, entry->verts.data(), sizeof(vertex_t) * entry->verts.count());
+			for (int i = 0; i < entry->indices.count(); ++i) {
+				int index = first_vert + entry->indices[i];
+				CUTE_ASSERT(index <= UINT16_MAX);
+				batch->geom_indices.add((uint16_t)index);
+			}
+			return;
+		}
+	}
+
+	float original_thickness = thickness;
 	bool thick_line = thickness > alias_scale;
 	thickness = max(thickness, 1.0f);
 	if (antialias) {
@@ -1136,6 +2087,22 @@ void batch_polyline(batch_t* batch, v2* points, int count, float thickness, colo
 	} else {
 		s_polyline(batch, points, count, thickness, color, color, loop, false, 0, bevel_count);
 	}
+
+	if (batch->use_polyline_cache) {
+		s_cache_polyline(batch, key, points, count, original_thickness, color, loop, antialias, bevel_count, alias_scale, first_vert, first_index);
+	}
+}
+
+void batch_set_polyline_cache(batch_t* b, bool use_polyline_cache)
+{
+	b->use_polyline_cache = use_polyline_cache;
+	if (!use_polyline_cache) {
+		batch_polyline_cache_entry_t** entries = b->polyline_cache.items();
+		for (int i = 0; i < b->polyline_cache.count(); ++i) {
+			s_free_polyline_cache_entry(entries[i], b->mem_ctx);
+		}
+		b->polyline_cache.clear();
+	}
 }
 
 temporary_image_t batch_fetch(batch_t* b, batch_sprite_t sprite)
@@ -24,15 +24,39 @@
 #include <cute_kv.h>
 #include <cute_defer.h>
 #include <cute_string.h>
+#include <cute_concurrency.h>
+#include <cute_timer.h>
 
 #include <internal/cute_app_internal.h>
+#include <internal/cute_ecs_internal.h>
 #include <internal/cute_object_table_internal.h>
 
+#include <imgui/imgui.h>
+
 #define INJECT(s) strpool_inject(app->strpool, s, (int)CUTE_STRLEN(s))
 
 namespace cute
 {
 
+// The collection a system is being run over, fetched by `s_collection` without a lookup. Systems may be
+// running on worker threads (see `ecs_set_parallel_systems`), so this is kept per thread.
+static thread_local uint32_t s_current_collection_type_being_iterated = ~0;
+static thread_local entity_collection_t* s_current_collection_being_updated = NULL;
+
+static void s_register_name(strpool_id name)
+{
+	const char* string = strpool_cstr(app->strpool, name);
+	if (!app->ecs_names.find(string)) app->ecs_names.insert(string, name);
+}
+
+static strpool_id s_find_name(const char* name)
+{
+	// Looks up a registered name without injecting it into the strpool. The strpool isn't thread-safe,
+	// and this is called from systems running on worker threads.
+	strpool_id* id = app->ecs_names.find(name);
+	return id ? *id : strpool_id { 0 };
+}
+
 static error_t s_load_from_schema(uint32_t schema_type, entity_t entity, component_config_t* config, void* component, void* udata)
 {
 	// Look for parent.
@@ -61,6 +85,151 @@ static error_t s_load_from_schema(uint32_t schema_type, entity_t entity, compone
 	return err;
 }
 
+static error_t s_bake_prototype(uint32_t type, entity_collection_t* collection, entity_t entity)
+{
+	if (collection->prototype_gen == app->ecs_gen) return error_success();
+
+	const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
+	collection->prototype_offsets.clear();
+	int size = 0;
+	for (int i = 0; i < component_type_tuple.count(); ++i) {
+		component_config_t* config = app->component_configs.find(component_type_tuple[i]);
+		if (config && config->copy_defaults) {
+			collection->prototype_offsets.add(size);
+			size += (int)((config->size_of_component + 15) & ~(size_t)15);
+		} else {
+			collection->prototype_offsets.add(-1);
+		}
+	}
+
+	collection->prototype.clear();
+	collection->prototype.ensure_count(size);
+	for (int i = 0; i < component_type_tuple.count(); ++i) {
+		int offset = collection->prototype_offsets[i];
+		if (offset < 0) continue;
+		component_config_t* config = app->component_configs.find(component_type_tuple[i]);
+		error_t err = s_load_from_schema(type, entity, config, collection->prototype.data() + offset, config->serializer_udata);
+		if (err.is_error()) return err;
+	}
+
+	collection->prototype_gen = app->ecs_gen;
+	return error_success();
+}
+
+static CUTE_INLINE error_t s_load_defaults(uint32_t type, entity_collection_t* collection, int component_index, entity_t entity, component_config_t* config, void* component)
+{
+	// Expects `s_bake_prototype` to have been called.
+	int offset = collection->prototype_offsets[component_index];
+	if (offset >= 0) {
+		CUTE_MEMCPY(component, collection->prototype.data() + offset, config->size_of_component);
+		return error_success();
+	} else {
+		return s_load_from_schema(type, entity, config, component, config->serializer_udata);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------
+// Component storage.
+
+// Collections using chunked storage keep their components in fixed size chunks. Each chunk holds the
+// same number of entities, with one cache-line aligned array per component type (SoA).
+#define CUTE_ECS_CHUNK_SIZE (16 * 1024)
+#define CUTE_ECS_CHUNK_ALIGNMENT 64
+
+static CUTE_INLINE size_t s_align_up(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+entity_collection_t::~entity_collection_t()
+{
+	for (int i = 0; i < chunks.count(); ++i) CUTE_FREE(chunks[i], app->mem_ctx);
+}
+
+static void s_init_chunked_storage(entity_collection_t* collection)
+{
+	const array<typeless_array>& tables = collection->component_tables;
+
+	// Find how many entities fit into a chunk, rounding each component array up to a cache line.
+	size_t row_size = 0;
+	for (int i = 0; i < tables.count(); ++i) row_size += tables[i].m_element_size;
+	int entities_per_chunk = row_size ? (int)(CUTE_ECS_CHUNK_SIZE / row_size) : CUTE_ECS_CHUNK_SIZE;
+	if (entities_per_chunk < 1) entities_per_chunk = 1;
+
+	while (1) {
+		size_t offset = 0;
+		collection->chunk_component_offsets.clear();
+		for (int i = 0; i < tables.count(); ++i) {
+			collection->chunk_component_offsets.add(offset);
+			offset += s_align_up(tables[i].m_element_size * entities_per_chunk, CUTE_ECS_CHUNK_ALIGNMENT);
+		}
+		collection->chunk_size = offset > CUTE_ECS_CHUNK_SIZE ? offset : CUTE_ECS_CHUNK_SIZE;
+		if (offset <= CUTE_ECS_CHUNK_SIZE || entities_per_chunk == 1) break;
+		--entities_per_chunk;
+	}
+
+	collection->chunked = true;
+	collection->entities_per_chunk = entities_per_chunk;
+}
+
+static CUTE_INLINE void* s_chunk_data(const entity_collection_t* collection, int chunk_index)
+{
+	return (void*)s_align_up((uintptr_t)collection->chunks[chunk_index], CUTE_ECS_CHUNK_ALIGNMENT);
+}
+
+static CUTE_INLINE void* s_get_component(entity_collection_t* collection, int component_index, int entity_index)
+{
+	if (collection->chunked) {
+		CUTE_ASSERT(entity_index >= 0 && entity_index < collection->row_count);
+		int chunk_index = entity_index / collection->entities_per_chunk;
+		int slot = entity_index - chunk_index * collection->entities_per_chunk;
+		size_t element_size = collection->component_tables[component_index].m_element_size;
+		uintptr_t component_array = (uintptr_t)s_chunk_data(collection, chunk_index) + collection->chunk_component_offsets[component_index];
+		return (void*)(component_array + element_size * slot);
+	} else {
+		return collection->component_tables[component_index][entity_index];
+	}
+}
+
+static int s_add_row(entity_collection_t* collection)
+{
+	if (collection->chunked) {
+		int index = collection->row_count++;
+		if (index == collection->chunks.count() * collection->entities_per_chunk) {
+			void* chunk = CUTE_ALLOC(collection->chunk_size + CUTE_ECS_CHUNK_ALIGNMENT, app->mem_ctx);
+			CUTE_ASSERT(chunk);
+			collection->chunks.add(chunk);
+		}
+		return index;
+	} else {
+		array<typeless_array>& tables = collection->component_tables;
+		for (int i = 0; i < tables.count(); ++i) tables[i].add();
+		return tables.count() ? tables[0].count() - 1 : 0;
+	}
+}
+
+static void s_remove_row(entity_collection_t* collection, int index)
+{
+	if (collection->chunked) {
+		int last = collection->row_count - 1;
+		if (index != last) {
+			for (int i = 0; i < collection->component_tables.count(); ++i) {
+				CUTE_MEMCPY(s_get_component(collection, i, index), s_get_component(collection, i, last), collection->component_tables[i].m_element_size);
+			}
+		}
+		collection->row_count--;
+
+		// Keep one empty chunk around to avoid thrashing allocations right at a chunk boundary.
+		int chunks_needed = (collection->row_count + collection->entities_per_chunk - 1) / collection->entities_per_chunk;
+		while (collection->chunks.count() > chunks_needed + 1) {
+			CUTE_FREE(collection->chunks.pop(), app->mem_ctx);
+		}
+	} else {
+		array<typeless_array>& tables = collection->component_tables;
+		for (int i = 0; i < tables.count(); ++i) tables[i].unordered_remove(index);
+	}
+}
+
 //--------------------------------------------------------------------------------------------------
 
 void ecs_system_begin()
@@ -71,6 +240,7 @@ void ecs_system_begin()
 void ecs_system_end()
 {
 	app->systems.add(app->system_internal_builder);
+	app->system_matches_dirty = true;
 }
 
 void ecs_system_set_name(const char* name)
@@ -83,9 +253,10 @@ void ecs_system_set_update(void* update_fn)
 	app->system_internal_builder.update_fn = update_fn;
 }
 
-void ecs_system_require_component(const char* component_type)
+void ecs_system_require_component(const char* component_type, component_access_t access)
 {
 	app->system_internal_builder.component_type_tuple.add(INJECT(component_type));
+	app->system_internal_builder.component_access.add(access);
 }
 
 void ecs_system_set_optional_pre_update(void (*pre_update_fn)(float dt, void* udata))
@@ -103,15 +274,36 @@ void ecs_system_set_optional_update_udata(void* udata)
 	app->system_internal_builder.udata = udata;
 }
 
-entity_t entity_make(const char* entity_type, error_t* err_out)
+void ecs_system_set_optional_parallel_chunk_size(int entity_count)
 {
-	uint32_t type = ~0;
-	app->entity_type_string_to_id.find(INJECT(entity_type), &type);
-	if (type == ~0) {
-		if (err_out) *err_out = error_failure("`type` is not a valid entity type.");
-		return INVALID_ENTITY;
+	app->system_internal_builder.parallel_chunk_size = entity_count;
+}
+
+static void s_pop_rows(entity_collection_t* collection, int first)
+{
+	// Removes freshly appended entities without calling any cleanup functions.
+	while (collection->entity_handles.count() > first) {
+		int index = collection->entity_handles.count() - 1;
+		collection->entity_handle_table.free_handle(collection->entity_handles.pop());
+		s_remove_row(collection, index);
 	}
+}
 
+static void s_cleanup_component(uint32_t type, entity_collection_t* collection, int component_index, int first, int count)
+{
+	// Unloads components of freshly appended entities that failed to load, before `s_pop_rows`.
+	component_config_t* config = app->component_configs.find(collection->component_type_tuple[component_index]);
+	if (!config || !config->cleanup_fn) return;
+	for (int i = first; i < first + count; ++i) {
+		entity_t entity;
+		entity.type = type;
+		entity.handle = collection->entity_handles[i];
+		config->cleanup_fn(entity, s_get_component(collection, component_index, i), config->cleanup_udata);
+	}
+}
+
+static entity_t s_entity_make(uint32_t type, error_t* err_out)
+{
 	entity_t entity;
 	entity.type = type;
 	entity.handle = CUTE_INVALID_HANDLE;
@@ -123,6 +315,14 @@ entity_t entity_make(const char* entity_type, error_t* err_out)
 	handle_t h = collection->entity_handle_table.alloc_handle(index);
 	collection->entity_handles.add(h);
 	entity.handle = h;
+	s_add_row(collection);
+
+	error_t err = s_bake_prototype(type, collection, entity);
+	if (err.is_error()) {
+		s_pop_rows(collection, index);
+		if (err_out) *err_out = err;
+		return INVALID_ENTITY;
+	}
 
 	const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
 	for (int i = 0; i < component_type_tuple.count(); ++i)
@@ -130,15 +330,17 @@ entity_t entity_make(const char* entity_type, error_t* err_out)
 		strpool_id component_type = component_type_tuple[i];
 		component_config_t* config = app->component_configs.find(component_type);
 
-		if (!config) {
-			if (err_out) *err_out = error_failure("Unable to find component config.");
-			return INVALID_ENTITY;
+		if (config) {
+			void* component = s_get_component(collection, i, index);
+			err = s_load_defaults(type, collection, i, entity, config, component);
+		} else {
+			err = error_failure("Unable to find component config.");
 		}
 
-		void* component = collection->component_tables[i].add();
-		error_t err = s_load_from_schema(type, entity, config, component, config->serializer_udata);
 		if (err.is_error()) {
-			// TODO - Unload the components that were added with `.add()` a couple lines above here.
+			for (int j = 0; j < i; ++j) s_cleanup_component(type, collection, j, index, 1);
+			s_pop_rows(collection, index);
+			if (err_out) *err_out = err;
 			return INVALID_ENTITY;
 		}
 	}
@@ -147,12 +349,99 @@ entity_t entity_make(const char* entity_type, error_t* err_out)
 	return entity;
 }
 
+entity_t entity_make(const char* entity_type, error_t* err_out)
+{
+	uint32_t type = ~0;
+	app->entity_type_string_to_id.find(s_find_name(entity_type), &type);
+	if (type == (uint32_t)~0) {
+		if (err_out) *err_out = error_failure("`type` is not a valid entity type.");
+		return INVALID_ENTITY;
+	}
+
+	return s_entity_make(type, err_out);
+}
+
+static error_t s_make_many_failed(entity_t* entities_out, int count, error_t err)
+{
+	// Don't hand back entities that were already freed again.
+	for (int i = 0; i < count; ++i) entities_out[i] = INVALID_ENTITY;
+	return err;
+}
+
+error_t entity_make_many(const char* entity_type, int count, entity_t* entities_out)
+{
+	if (count <= 0) return error_success();
+	uint32_t type = ~0;
+	app->entity_type_string_to_id.find(s_find_name(entity_type), &type);
+	if (type == (uint32_t)~0) return s_make_many_failed(entities_out, count, error_failure("`type` is not a valid entity type."));
+
+	entity_collection_t* collection = app->entity_collections.find(type);
+	CUTE_ASSERT(collection);
+
+	const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
+	int component_count = component_type_tuple.count();
+	array<component_config_t*> configs;
+	for (int i = 0; i < component_count; ++i) {
+		component_config_t* config = app->component_configs.find(component_type_tuple[i]);
+		if (!config) return s_make_many_failed(entities_out, count, error_failure("Unable to find component config."));
+		configs.add(config);
+	}
+
+	// Grow all storage once up-front instead of once per entity.
+	int first = collection->entity_handles.count();
+	collection->entity_handles.ensure_capacity(first + count);
+	if (!collection->chunked) {
+		for (int i = 0; i < component_count; ++i) {
+			collection->component_tables[i].ensure_capacity(first + count);
+		}
+	}
+
+	for (int i = 0; i < count; ++i) {
+		entity_t entity;
+		entity.type = type;
+		entity.handle = collection->entity_handle_table.alloc_handle(first + i);
+		collection->entity_handles.add(entity.handle);
+		s_add_row(collection);
+		entities_out[i] = entity;
+	}
+
+	error_t err = s_bake_prototype(type, collection, entities_out[0]);
+	if (err.is_error()) {
+		s_pop_rows(collection, first);
+		return s_make_many_failed(entities_out, count, err);
+	}
+
+	for (int i = 0; i < component_count; ++i) {
+		component_config_t* config = configs[i];
+		int offset = collection->prototype_offsets[i];
+		if (offset >= 0) {
+			const void* prototype = collection->prototype.data() + offset;
+			for (int j = 0; j < count; ++j) {
+				CUTE_MEMCPY(s_get_component(collection, i, first + j), prototype, config->size_of_component);
+			}
+		} else {
+			for (int j = 0; j < count; ++j) {
+				void* component = s_get_component(collection, i, first + j);
+				err = s_load_from_schema(type, entities_out[j], config, component, config->serializer_udata);
+				if (err.is_error()) {
+					for (int k = 0; k < i; ++k) s_cleanup_component(type, collection, k, first, count);
+					s_cleanup_component(type, collection, i, first, j);
+					s_pop_rows(collection, first);
+					return s_make_many_failed(entities_out, count, err);
+				}
+			}
+		}
+	}
+
+	return error_success();
+}
+
 static entity_collection_t* s_collection(entity_t entity)
 {
 	entity_collection_t* collection = NULL;
-	if (entity.type == app->current_collection_type_being_iterated) {
+	if (entity.type == s_current_collection_type_being_iterated) {
 		// Fast path -- check the current entity collection for this entity type first.
-		collection = app->current_collection_being_updated;
+		collection = s_current_collection_being_updated;
 		CUTE_ASSERT(collection);
 	} else {
 		// Slightly slower path -- lookup collection first.
@@ -162,25 +451,111 @@ static entity_collection_t* s_collection(entity_t entity)
 	return collection;
 }
 
+static int s_lock_command_buffer()
+{
+	// Systems may be running on worker threads (see `ecs_set_parallel_systems`), so each thread
+	// records into its own buffer. Threads claim a buffer the first time they record a command.
+	return thread_claims_lock(&app->command_buffer_claims);
+}
+
+static void s_unlock_command_buffer(int index)
+{
+	thread_claims_unlock(&app->command_buffer_claims, index);
+}
+
+static void s_record_command(ecs_command_type_t type, entity_t entity, int component_id = -1, const void* data = NULL, size_t size = 0)
+{
+	int index = s_lock_command_buffer();
+	ecs_command_buffer_t* buffer = app->command_buffers + index;
+	ecs_command_t command;
+	command.type = type;
+	command.entity = entity;
+	command.component_id = component_id;
+	command.data_offset = buffer->data.count();
+	command.data_size = (int)size;
+	if (size) {
+		buffer->data.ensure_count(command.data_offset + (int)size);
+		CUTE_MEMCPY(buffer->data.data() + command.data_offset, data, size);
+	}
+	buffer->commands.add(command);
+	s_unlock_command_buffer(index);
+}
+
+entity_t entity_delayed_make(const char* entity_type)
+{
+	uint32_t type = ~0;
+	app->entity_type_string_to_id.find(s_find_name(entity_type), &type);
+	if (type == (uint32_t)~0) return INVALID_ENTITY;
+
+	int index = s_lock_command_buffer();
+	ecs_command_buffer_t* buffer = app->command_buffers + index;
+	entity_t entity;
+	entity.type = type;
+	entity.handle = CUTE_ECS_PLACEHOLDER_BIT | ((uint64_t)index << 32) | (uint64_t)buffer->commands.count();
+	ecs_command_t command;
+	command.type = ECS_COMMAND_TYPE_MAKE;
+	command.entity = entity;
+	command.component_id = -1;
+	command.data_offset = 0;
+	command.data_size = 0;
+	buffer->commands.add(command);
+	s_unlock_command_buffer(index);
+
+	return entity;
+}
+
+void entity_delayed_set_component(entity_t entity, component_id_t component_id, const void* component, size_t size)
+{
+	CUTE_ASSERT(component_id.id >= 0 && component_id.id < app->component_configs.count());
+	CUTE_ASSERT(size <= app->component_configs.items()[component_id.id].size_of_component);
+	s_record_command(ECS_COMMAND_TYPE_SET_COMPONENT, entity, component_id.id, component, size);
+}
+
+void entity_delayed_set_component(entity_t entity, const char* component_type, const void* component, size_t size)
+{
+	entity_delayed_set_component(entity, ecs_component_id(component_type), component, size);
+}
+
 void entity_delayed_destroy(entity_t entity)
 {
-	app->delayed_destroy_entities.add(entity);
+	s_record_command(ECS_COMMAND_TYPE_DESTROY, entity);
 }
 
-void entity_destroy(entity_t entity)
+static entity_t s_resolve_placeholder(entity_t entity)
 {
-	entity_collection_t* collection = app->entity_collections.find(entity.type);
-	CUTE_ASSERT(collection);
+	if (!(entity.handle & CUTE_ECS_PLACEHOLDER_BIT)) return entity;
+	uint32_t buffer_index = (uint32_t)((entity.handle & ~CUTE_ECS_PLACEHOLDER_BIT) >> 32);
+	uint32_t command_index = (uint32_t)(entity.handle & 0xFFFFFFFF);
+	if (buffer_index >= (uint32_t)app->command_buffers.count()) return INVALID_ENTITY;
+	ecs_command_buffer_t* buffer = app->command_buffers + buffer_index;
+	if (command_index >= (uint32_t)buffer->commands.count()) return INVALID_ENTITY;
+	const ecs_command_t& command = buffer->commands[command_index];
+	if (command.type != ECS_COMMAND_TYPE_MAKE) return INVALID_ENTITY;
+	return command.entity;
+}
 
+static void s_clear_command_buffers()
+{
+	for (int i = 0; i < app->command_buffers.count(); ++i) {
+		ecs_command_buffer_t* buffer = app->command_buffers + i;
+		buffer->commands.clear();
+		buffer->data.clear();
+		buffer->played_count = 0;
+	}
+}
+
+static void s_entity_destroy(entity_collection_t* collection, entity_t entity, component_config_t** configs)
+{
 	if (collection->entity_handle_table.is_valid(entity.handle)) {
 		int index = collection->entity_handle_table.get_index(entity.handle);
 
 		// Call cleanup function on each component.
 		for (int i = 0; i < collection->component_tables.count(); ++i) {
 			component_config_t config;
-			app->component_configs.find(collection->component_type_tuple[i], &config);
+			if (configs) config = *configs[i];
+			else app->component_configs.find(collection->component_type_tuple[i], &config);
 			if (config.cleanup_fn) {
-				config.cleanup_fn(entity, collection->component_tables[i][index], config.cleanup_udata);
+				config.cleanup_fn(entity, s_get_component(collection, i, index), config.cleanup_udata);
 			}
 		}
 
@@ -192,9 +567,7 @@ void entity_destroy(entity_t entity)
 		collection->entity_handle_table.free_handle(entity.handle);
 
 		// Free each component.
-		for (int i = 0; i < collection->component_tables.count(); ++i) {
-			collection->component_tables[i].unordered_remove(index);
-		}
+		s_remove_row(collection, index);
 
 		// Update handle of the swapped entity.
 		if (index < collection->entity_handles.size()) {
@@ -204,6 +577,37 @@ void entity_destroy(entity_t entity)
 	}
 }
 
+void entity_destroy(entity_t entity)
+{
+	entity_collection_t* collection = app->entity_collections.find(entity.type);
+	CUTE_ASSERT(collection);
+	s_entity_destroy(collection, entity, NULL);
+}
+
+void entity_destroy_many(const entity_t* entities, int count)
+{
+	// Look up the collection and component configs once per run of same-typed entities.
+	uint32_t type = ~0;
+	entity_collection_t* collection = NULL;
+	array<component_config_t*> configs;
+
+	for (int i = 0; i < count; ++i) {
+		entity_t entity = entities[i];
+		if (entity.type != type) {
+			type = entity.type;
+			collection = app->entity_collections.find(type);
+			CUTE_ASSERT(collection);
+			configs.clear();
+			for (int j = 0; j < collection->component_type_tuple.count(); ++j) {
+				component_config_t* config = app->component_configs.find(collection->component_type_tuple[j]);
+				CUTE_ASSERT(config);
+				configs.add(config);
+			}
+		}
+		s_entity_destroy(collection, entity, configs.data());
+	}
+}
+
 bool entity_is_valid(entity_t entity)
 {
 	entity_collection_t* collection = s_collection(entity);
@@ -216,164 +620,722 @@ void* entity_get_component(entity_t entity, const char* component_type)
 	entity_collection_t* collection = s_collection(entity);
 	if (!collection) return NULL;
 
-	strpool_id type = INJECT(component_type);
-	const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
-	for (int i = 0; i < component_type_tuple.count(); ++i)
-	{
-		if (component_type_tuple[i].val == type.val) {
-			int index = collection->entity_handle_table.get_index(entity.handle);
-			return collection->component_tables[i][index];
+	strpool_id type = s_find_name(component_type);
+	const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
+	for (int i = 0; i < component_type_tuple.count(); ++i)
+	{
+		if (component_type_tuple[i].val == type.val) {
+			int index = collection->entity_handle_table.get_index(entity.handle);
+			return s_get_component(collection, i, index);
+		}
+	}
+
+	return NULL;
+}
+
+bool entity_has_component(entity_t entity, const char* component_type)
+{
+	return entity_get_component(entity, component_type) ? true : false;
+}
+
+void* entity_get_component(entity_t entity, component_id_t component_id)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (!collection) return NULL;
+
+	if ((unsigned)component_id.id >= (unsigned)collection->component_columns.count()) return NULL;
+	int column = collection->component_columns[component_id.id];
+	if (column < 0) return NULL;
+
+	int index = collection->entity_handle_table.get_index(entity.handle);
+	return s_get_component(collection, column, index);
+}
+
+bool entity_has_component(entity_t entity, component_id_t component_id)
+{
+	entity_collection_t* collection = s_collection(entity);
+	if (!collection) return false;
+	if ((unsigned)component_id.id >= (unsigned)collection->component_columns.count()) return false;
+	return collection->component_columns[component_id.id] >= 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+static void s_0(float dt, void* fn_uncasted, void* udata)
+{
+	auto fn = (void (*)(float, void*))fn_uncasted;
+	fn(dt, udata);
+}
+
+static void s_1(float dt, void* fn_uncasted, void* udata, void* c0, int count)
+{
+	auto fn = (void (*)(float, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, count);
+}
+
+static void s_2(float dt, void* fn_uncasted, void* udata, void* c0, void* c1, int count)
+{
+	auto fn = (void (*)(float, void*, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, c1, count);
+}
+
+static void s_3(float dt, void* fn_uncasted, void* udata, void* c0, void* c1, void* c2, int count)
+{
+	auto fn = (void (*)(float, void*, void*, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, c1, c2, count);
+}
+
+static void s_4(float dt, void* fn_uncasted, void* udata, void* c0, void* c1, void* c2, void* c3, int count)
+{
+	auto fn = (void (*)(float, void*, void*, void*, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, c1, c2, c3, count);
+}
+
+static void s_5(float dt, void* fn_uncasted, void* udata, void* c0, void* c1, void* c2, void* c3, void* c4, int count)
+{
+	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, c1, c2, c3, c4, count);
+}
+
+static void s_6(float dt, void* fn_uncasted, void* udata, void* c0, void* c1, void* c2, void* c3, void* c4, void* c5, int count)
+{
+	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, c1, c2, c3, c4, c5, count);
+}
+
+static void s_7(float dt, void* fn_uncasted, void* udata, void* c0, void* c1, void* c2, void* c3, void* c4, void* c5, void* c6, int count)
+{
+	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, c1, c2, c3, c4, c5, c6, count);
+}
+
+static void s_8(float dt, void* fn_uncasted, void* udata, void* c0, void* c1, void* c2, void* c3, void* c4, void* c5, void* c6, void* c7, int count)
+{
+	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
+	fn(dt, udata, c0, c1, c2, c3, c4, c5, c6, c7, count);
+}
+
+static inline int s_match(int* matches, const array<strpool_id>& a, const array<strpool_id>& b)
+{
+	int match_count = 0;
+	for (int i = 0; i < a.count(); ++i)
+	{
+		for (int j = 0; j < b.count(); ++j)
+		{
+			if (a[i].val == b[j].val) {
+				matches[match_count++] = j;
+				break;
+			}
+		}
+	}
+	return match_count;
+}
+
+static void s_run_system(float dt, system_internal_t* system, entity_collection_t* collection, const int* matches, int begin, int count)
+{
+	void* update_fn = system->update_fn;
+	void* udata = system->udata;
+	array<typeless_array>& tables = collection->component_tables;
+
+	// Offset each component array to the first entity of this range.
+	void* c[8];
+	int match_count = system->component_type_tuple.count();
+	for (int i = 0; i < match_count; ++i) {
+		if (collection->chunked) {
+			c[i] = s_get_component(collection, matches[i], begin);
+		} else {
+			typeless_array& table = tables[matches[i]];
+			CUTE_ASSERT(table.count() == collection->entity_handles.count());
+			c[i] = (void*)((uintptr_t)table.data() + table.m_element_size * begin);
+		}
+	}
+
+	switch (match_count)
+	{
+	case 0: s_0(dt, update_fn, udata); break;
+	case 1: s_1(dt, update_fn, udata, c[0], count); break;
+	case 2: s_2(dt, update_fn, udata, c[0], c[1], count); break;
+	case 3: s_3(dt, update_fn, udata, c[0], c[1], c[2], count); break;
+	case 4: s_4(dt, update_fn, udata, c[0], c[1], c[2], c[3], count); break;
+	case 5: s_5(dt, update_fn, udata, c[0], c[1], c[2], c[3], c[4], count); break;
+	case 6: s_6(dt, update_fn, udata, c[0], c[1], c[2], c[3], c[4], c[5], count); break;
+	case 7: s_7(dt, update_fn, udata, c[0], c[1], c[2], c[3], c[4], c[5], c[6], count); break;
+	case 8: s_8(dt, update_fn, udata, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], count); break;
+	default: CUTE_ASSERT(0);
+	}
+}
+
+static CUTE_INLINE int s_span_length(const entity_collection_t* collection, int begin, int end)
+{
+	// Returns how many entities starting at `begin` are stored contiguously, up to `end`.
+	if (!collection->chunked) return end - begin;
+	int chunk_end = (begin / collection->entities_per_chunk + 1) * collection->entities_per_chunk;
+	return min(chunk_end, end) - begin;
+}
+
+static void s_run_system_range(float dt, system_internal_t* system, entity_collection_t* collection, const int* matches, int begin, int count)
+{
+	if (!collection->chunked || !system->component_type_tuple.count()) {
+		s_run_system(dt, system, collection, matches, begin, count);
+		return;
+	}
+
+	// Chunked storage is only contiguous within each chunk, so the system is run once per chunk.
+	int end = begin + count;
+	while (begin < end) {
+		int span = s_span_length(collection, begin, end);
+		s_run_system(dt, system, collection, matches, begin, span);
+		begin += span;
+	}
+}
+
+static void s_run_systems_serial(float dt)
+{
+	int system_count = app->systems.count();
+	for (int i = 0; i < system_count; ++i)
+	{
+		system_internal_t* system = app->systems + i;
+		auto pre_update_fn = system->pre_update_fn;
+		auto post_update_fn = system->post_update_fn;
+		void* udata = system->udata;
+
+		ecs_system_profile_t* profile = app->system_profile_row ? app->system_profile_row + i : NULL;
+		timer_t timer;
+		if (profile) timer = timer_init();
+
+		if (pre_update_fn) pre_update_fn(dt, udata);
+		if (profile) profile->pre_update_seconds = timer_dt(&timer);
+
+		if (system->update_fn) {
+			for (int j = 0; j < system->match_count; ++j)
+			{
+				const system_match_t* match = app->system_matches + system->first_match + j;
+				entity_collection_t* collection = app->entity_collections.items() + match->collection_index;
+				CUTE_ASSERT(collection->component_tables.count() == collection->component_type_tuple.count());
+				s_current_collection_type_being_iterated = app->entity_collections.keys()[match->collection_index];
+				s_current_collection_being_updated = collection;
+				CUTE_DEFER(s_current_collection_type_being_iterated = ~0);
+				CUTE_DEFER(s_current_collection_being_updated = NULL);
+
+				s_run_system_range(dt, system, collection, match->matches, 0, collection->entity_handles.count());
+				if (profile) profile->entity_count += collection->entity_handles.count();
+			}
+		}
+		if (profile) profile->update_seconds = timer_dt(&timer);
+
+		if (post_update_fn) post_update_fn(dt, udata);
+		if (profile) profile->post_update_seconds = timer_dt(&timer);
+	}
+}
+
+static bool s_systems_conflict(const system_internal_t* a, const system_internal_t* b)
+{
+	// Systems without any components can do anything at all, so treat them as a barrier.
+	if (!a->component_type_tuple.count() || !b->component_type_tuple.count()) return true;
+
+	// So can pre and post updates. Keeping these systems apart calls them in the same order as when
+	// running serially, right before and after the system's own update.
+	if (a->pre_update_fn || a->post_update_fn || b->pre_update_fn || b->post_update_fn) return true;
+
+	for (int i = 0; i < a->component_type_tuple.count(); ++i)
+	{
+		for (int j = 0; j < b->component_type_tuple.count(); ++j)
+		{
+			if (a->component_type_tuple[i].val != b->component_type_tuple[j].val) continue;
+			bool a_writes = a->component_access[i] == COMPONENT_ACCESS_READ_WRITE;
+			bool b_writes = b->component_access[j] == COMPONENT_ACCESS_READ_WRITE;
+			if (a_writes | b_writes) return true;
+		}
+	}
+
+	return false;
+}
+
+static void s_calc_system_levels()
+{
+	// Each system is placed one level after the latest earlier system it conflicts with. Systems
+	// within the same level touch disjoint data, so can run at the same time.
+	int system_count = app->systems.count();
+	app->system_levels.clear();
+	for (int i = 0; i < system_count; ++i)
+	{
+		int level = 0;
+		for (int j = 0; j < i; ++j)
+		{
+			if (app->system_levels[j] + 1 > level && s_systems_conflict(app->systems + j, app->systems + i)) {
+				level = app->system_levels[j] + 1;
+			}
+		}
+		app->system_levels.add(level);
+	}
+}
+
+static void s_update_system_matches()
+{
+	if (!app->system_matches_dirty) return;
+	app->system_matches_dirty = false;
+
+	// Match each system against each entity collection once, and keep the resulting component table
+	// indices around until a new entity type or system is registered.
+	app->system_matches.clear();
+	int collection_count = app->entity_collections.count();
+	for (int i = 0; i < app->systems.count(); ++i)
+	{
+		system_internal_t* system = app->systems + i;
+		system->first_match = app->system_matches.count();
+		system->match_count = 0;
+
+		for (int j = 0; j < collection_count; ++j)
+		{
+			entity_collection_t* collection = app->entity_collections.items() + j;
+			system_match_t match;
+			match.collection_index = j;
+			int match_count = s_match(match.matches, system->component_type_tuple, collection->component_type_tuple);
+			if (match_count == system->component_type_tuple.count()) {
+				app->system_matches.add(match);
+				system->match_count++;
+			}
+		}
+	}
+
+	s_calc_system_levels();
+}
+
+static void s_system_job(void* param)
+{
+	system_job_t* job = (system_job_t*)param;
+	timer_t timer;
+	if (app->system_profile_row) timer = timer_init();
+	s_current_collection_type_being_iterated = job->collection_type;
+	s_current_collection_being_updated = job->collection;
+	s_run_system_range(job->dt, job->system, job->collection, job->matches, job->begin, job->count);
+	s_current_collection_type_being_iterated = ~0;
+	s_current_collection_being_updated = NULL;
+	if (app->system_profile_row) job->seconds = timer_dt(&timer);
+}
+
+static void s_run_systems_parallel(float dt)
+{
+	int system_count = app->systems.count();
+	int max_level = 0;
+	for (int i = 0; i < system_count; ++i) {
+		max_level = max(max_level, app->system_levels[i]);
+	}
+
+	ecs_system_profile_t* profiles = app->system_profile_row;
+	timer_t timer;
+	if (profiles) timer = timer_init();
+
+	for (int level = 0; level <= max_level && system_count; ++level)
+	{
+		for (int i = 0; i < system_count; ++i) {
+			if (app->system_levels[i] != level) continue;
+			system_internal_t* system = app->systems + i;
+			if (profiles) timer_dt(&timer);
+			if (system->pre_update_fn) system->pre_update_fn(dt, system->udata);
+			if (profiles) profiles[i].pre_update_seconds = timer_dt(&timer);
+		}
+
+		// Collect all jobs for this level first, as `system_jobs` must not grow once tasks are in flight.
+		app->system_jobs.clear();
+		for (int i = 0; i < system_count; ++i)
+		{
+			if (app->system_levels[i] != level) continue;
+			system_internal_t* system = app->systems + i;
+			if (!system->update_fn) continue;
+
+			if (!system->component_type_tuple.count()) {
+				// Barrier systems are alone in their level, just run them here. Like when running serially
+				// they are called once per entity collection, as each collection matches.
+				if (profiles) timer_dt(&timer);
+				for (int j = 0; j < system->match_count; ++j)
+				{
+					const system_match_t* match = app->system_matches + system->first_match + j;
+					s_current_collection_type_being_iterated = app->entity_collections.keys()[match->collection_index];
+					s_current_collection_being_updated = app->entity_collections.items() + match->collection_index;
+					s_0(dt, system->update_fn, system->udata);
+				}
+				s_current_collection_type_being_iterated = ~0;
+				s_current_collection_being_updated = NULL;
+				if (profiles) profiles[i].update_seconds = timer_dt(&timer);
+				continue;
+			}
+
+			for (int j = 0; j < system->match_count; ++j)
+			{
+				const system_match_t* match = app->system_matches + system->first_match + j;
+				entity_collection_t* collection = app->entity_collections.items() + match->collection_index;
+
+				int entity_count = collection->entity_handles.count();
+				int chunk_size = system->parallel_chunk_size > 0 ? system->parallel_chunk_size : entity_count;
+				for (int begin = 0; begin < entity_count; begin += chunk_size)
+				{
+					system_job_t job;
+					job.dt = dt;
+					job.system = system;
+					job.collection_type = app->entity_collections.keys()[match->collection_index];
+					job.collection = collection;
+					job.matches = match->matches;
+					job.begin = begin;
+					job.count = min(chunk_size, entity_count - begin);
+					job.seconds = 0;
+					app->system_jobs.add(job);
+				}
+			}
+		}
+
+		int job_count = app->system_jobs.count();
+		if (job_count) {
+			for (int i = 0; i < job_count; ++i) {
+				threadpool_add_task(app->threadpool, s_system_job, app->system_jobs + i);
+			}
+			threadpool_kick_and_wait(app->threadpool);
+
+			if (profiles) {
+				for (int i = 0; i < job_count; ++i) {
+					const system_job_t* job = app->system_jobs + i;
+					ecs_system_profile_t* profile = profiles + (job->system - app->systems.data());
+					profile->update_seconds += job->seconds;
+					profile->entity_count += job->count;
+				}
+			}
+		}
+
+		for (int i = 0; i < system_count; ++i) {
+			if (app->system_levels[i] != level) continue;
+			system_internal_t* system = app->systems + i;
+			if (profiles) timer_dt(&timer);
+			if (system->post_update_fn) system->post_update_fn(dt, system->udata);
+			if (profiles) profiles[i].post_update_seconds = timer_dt(&timer);
+		}
+	}
+}
+
+static ecs_system_profile_t* s_begin_system_profile()
+{
+	int system_count = app->systems.count();
+	if (app->system_profiles.count() != CUTE_ECS_PROFILE_FRAME_COUNT * system_count) {
+		// Systems were registered since the last frame, start over.
+		app->system_profiles.clear();
+		app->system_profiles.ensure_count(CUTE_ECS_PROFILE_FRAME_COUNT * system_count);
+		app->system_profile_frame_count = 0;
+	}
+
+	int frame = app->system_profile_frame_count++ % CUTE_ECS_PROFILE_FRAME_COUNT;
+	ecs_system_profile_t* row = app->system_profiles.data() + frame * system_count;
+	CUTE_MEMSET(row, 0, sizeof(ecs_system_profile_t) * system_count);
+	return row;
+}
+
+void ecs_run_systems(float dt)
+{
+	s_update_system_matches();
+
+	if (app->systems_profiled) {
+		app->system_profile_row = s_begin_system_profile();
+	}
+
+	if (app->systems_run_in_parallel && app->threadpool) {
+		s_run_systems_parallel(dt);
+	} else {
+		s_run_systems_serial(dt);
+	}
+
+	app->system_profile_row = NULL;
+
+	ecs_flush_delayed_commands();
+}
+
+void ecs_flush_delayed_commands()
+{
+	// Commands may record more commands while being played back, e.g. a cleanup function that
+	// destroys another entity. Keep going until no buffer has anything new left to play.
+	bool played = true;
+	while (played) {
+		played = false;
+		int buffer_count = app->command_buffers.count();
+		array<int> end_counts;
+		end_counts.ensure_count(buffer_count);
+		for (int i = 0; i < buffer_count; ++i) {
+			end_counts[i] = app->command_buffers[i].commands.count();
+		}
+
+		// Makes go first so every other command can refer to placeholders from any buffer.
+		for (int i = 0; i < buffer_count; ++i) {
+			ecs_command_buffer_t* buffer = app->command_buffers + i;
+			for (int j = buffer->played_count; j < end_counts[i]; ++j) {
+				ecs_command_t* command = buffer->commands + j;
+				if (command->type != ECS_COMMAND_TYPE_MAKE) continue;
+				error_t err;
+				command->entity = s_entity_make(command->entity.type, &err);
+				if (err.is_error()) {
+					CUTE_DEBUG_PRINTF("Unable to make delayed entity: %s\n", err.details);
+				}
+			}
+		}
+
+		for (int i = 0; i < buffer_count; ++i) {
+			ecs_command_buffer_t* buffer = app->command_buffers + i;
+			for (int j = buffer->played_count; j < end_counts[i]; ++j) {
+				ecs_command_t command = buffer->commands[j];
+				if (command.type != ECS_COMMAND_TYPE_SET_COMPONENT) continue;
+				entity_t entity = s_resolve_placeholder(command.entity);
+				if (!entity_is_valid(entity)) continue;
+				void* component = entity_get_component(entity, component_id_t { command.component_id });
+				if (!component) continue;
+				CUTE_MEMCPY(component, buffer->data.data() + command.data_offset, command.data_size);
+			}
+		}
+
+		for (int i = 0; i < buffer_count; ++i) {
+			ecs_command_buffer_t* buffer = app->command_buffers + i;
+			for (int j = buffer->played_count; j < end_counts[i]; ++j) {
+				ecs_command_t command = buffer->commands[j];
+				if (command.type != ECS_COMMAND_TYPE_DESTROY) continue;
+				entity_t entity = s_resolve_placeholder(command.entity);
+				if (!app->entity_collections.find(entity.type)) continue;
+				entity_destroy(entity);
+			}
+		}
+
+		for (int i = 0; i < buffer_count; ++i) {
+			ecs_command_buffer_t* buffer = app->command_buffers + i;
+			if (buffer->played_count != end_counts[i]) played = true;
+			buffer->played_count = end_counts[i];
 		}
 	}
 
-	return NULL;
+	s_clear_command_buffers();
 }
 
-bool entity_has_component(entity_t entity, const char* component_type)
+void ecs_set_parallel_systems(bool true_to_run_in_parallel)
 {
-	return entity_get_component(entity, component_type) ? true : false;
+	app->systems_run_in_parallel = true_to_run_in_parallel;
 }
 
-//--------------------------------------------------------------------------------------------------
-
-static void s_0(float dt, void* fn_uncasted, void* udata)
+void ecs_set_system_profiling(bool true_to_enable)
 {
-	auto fn = (void (*)(float, void*))fn_uncasted;
-	fn(dt, udata);
+	if (true_to_enable && !app->systems_profiled) {
+		app->system_profiles.clear();
+		app->system_profile_frame_count = 0;
+	}
+	app->systems_profiled = true_to_enable;
 }
 
-static void s_1(float dt, void* fn_uncasted, void* udata, typeless_array& c0)
+int ecs_get_system_profile_frame_count()
 {
-	auto fn = (void (*)(float, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), count);
+	return min(app->system_profile_frame_count, CUTE_ECS_PROFILE_FRAME_COUNT);
 }
 
-static void s_2(float dt, void* fn_uncasted, void* udata, typeless_array& c0, typeless_array& c1)
+array<ecs_system_profile_t> ecs_get_system_profile(int frames_ago)
 {
-	CUTE_ASSERT(c0.count() == c1.count());
-	auto fn = (void (*)(float, void*, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), c1.data(), count);
-}
+	array<ecs_system_profile_t> result;
+	if (frames_ago < 0 || frames_ago >= ecs_get_system_profile_frame_count()) return result;
 
-static void s_3(float dt, void* fn_uncasted, void* udata, typeless_array& c0, typeless_array& c1, typeless_array& c2)
-{
-	CUTE_ASSERT(c0.count() == c1.count() && c0.count() == c2.count());
-	auto fn = (void (*)(float, void*, void*, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), c1.data(), c2.data(), count);
-}
+	int system_count = app->systems.count();
+	if (app->system_profiles.count() != CUTE_ECS_PROFILE_FRAME_COUNT * system_count) return result;
+
+	int frame = (app->system_profile_frame_count - 1 - frames_ago) % CUTE_ECS_PROFILE_FRAME_COUNT;
+	const ecs_system_profile_t* row = app->system_profiles.data() + frame * system_count;
+	for (int i = 0; i < system_count; ++i) {
+		ecs_system_profile_t profile = row[i];
+		strpool_id name = app->systems[i].name;
+		profile.name = name.val != 0 ? strpool_cstr(app->strpool, name) : "System name was not set.";
+		result.add(profile);
+	}
 
-static void s_4(float dt, void* fn_uncasted, void* udata, typeless_array& c0, typeless_array& c1, typeless_array& c2, typeless_array& c3)
-{
-	CUTE_ASSERT(c0.count() == c1.count() && c0.count() == c2.count() && c0.count() == c3.count());
-	auto fn = (void (*)(float, void*, void*, void*, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), c1.data(), c2.data(), c3.data(), count);
+	return result;
 }
 
-static void s_5(float dt, void* fn_uncasted, void* udata, typeless_array& c0, typeless_array& c1, typeless_array& c2, typeless_array& c3, typeless_array& c4)
+void ecs_imgui_system_profiler(bool* open)
 {
-	CUTE_ASSERT(c0.count() == c1.count() && c0.count() == c2.count() && c0.count() == c3.count() && c0.count() == c4.count());
-	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), c1.data(), c2.data(), c3.data(), c4.data(), count);
+	if (!app->using_imgui) return;
+
+	if (ImGui::Begin("ECS Systems", open)) {
+		int frame_count = ecs_get_system_profile_frame_count();
+		if (!app->systems_profiled) {
+			ImGui::Text("Profiling is off, see `ecs_set_system_profiling`.");
+		} else if (!frame_count) {
+			ImGui::Text("No frames recorded yet.");
+		} else {
+			// Average over all recorded frames to keep the numbers readable.
+			array<ecs_system_profile_t> average = ecs_get_system_profile(0);
+			for (int i = 1; i < frame_count; ++i) {
+				array<ecs_system_profile_t> profile = ecs_get_system_profile(i);
+				for (int j = 0; j < average.count(); ++j) {
+					average[j].pre_update_seconds += profile[j].pre_update_seconds;
+					average[j].update_seconds += profile[j].update_seconds;
+					average[j].post_update_seconds += profile[j].post_update_seconds;
+					average[j].entity_count += profile[j].entity_count;
+				}
+			}
+
+			ImGui::Text("Averaged over %d frames.", frame_count);
+			if (ImGui::BeginTable("systems", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+				ImGui::TableSetupColumn("System");
+				ImGui::TableSetupColumn("Pre (ms)");
+				ImGui::TableSetupColumn("Update (ms)");
+				ImGui::TableSetupColumn("Post (ms)");
+				ImGui::TableSetupColumn("Entities");
+				ImGui::TableHeadersRow();
+				float inv_count = 1.0f / (float)frame_count;
+				for (int i = 0; i < average.count(); ++i) {
+					const ecs_system_profile_t& profile = average[i];
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::TextUnformatted(profile.name);
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", profile.pre_update_seconds * inv_count * 1000.0f);
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", profile.update_seconds * inv_count * 1000.0f);
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", profile.post_update_seconds * inv_count * 1000.0f);
+					ImGui::TableNextColumn(); ImGui::Text("%d", (int)((float)profile.entity_count * inv_count));
+				}
+				ImGui::EndTable();
+			}
+		}
+	}
+	ImGui::End();
 }
 
-static void s_6(float dt, void* fn_uncasted, void* udata, typeless_array& c0, typeless_array& c1, typeless_array& c2, typeless_array& c3, typeless_array& c4, typeless_array& c5)
+//--------------------------------------------------------------------------------------------------
+// Queries.
+
+static query_internal_t* s_query(ecs_query_t query)
 {
-	CUTE_ASSERT(c0.count() == c1.count() && c0.count() == c2.count() && c0.count() == c3.count() && c0.count() == c4.count() && c0.count() == c5.count());
-	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), c1.data(), c2.data(), c3.data(), c4.data(), c5.data(), count);
+	if (query.id < 0 || query.id >= app->queries.count()) return NULL;
+	query_internal_t* q = app->queries[query.id];
+	if (q->gen == app->ecs_gen) return q;
+
+	// Match against all entity types, just like the system matches are built.
+	q->matches.clear();
+	int collection_count = app->entity_collections.count();
+	for (int i = 0; i < collection_count; ++i)
+	{
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		system_match_t match;
+		match.collection_index = i;
+		int match_count = s_match(match.matches, q->component_type_tuple, collection->component_type_tuple);
+		if (match_count == q->component_type_tuple.count()) {
+			q->matches.add(match);
+		}
+	}
+	q->gen = app->ecs_gen;
+
+	return q;
 }
 
-static void s_7(float dt, void* fn_uncasted, void* udata, typeless_array& c0, typeless_array& c1, typeless_array& c2, typeless_array& c3, typeless_array& c4, typeless_array& c5, typeless_array& c6)
+static ecs_span_t s_span(const system_match_t* match, int component_count, int begin, int count)
 {
-	CUTE_ASSERT(c0.count() == c1.count() && c0.count() == c2.count() && c0.count() == c3.count() && c0.count() == c4.count() && c0.count() == c5.count() && c0.count() == c6.count());
-	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), c1.data(), c2.data(), c3.data(), c4.data(), c5.data(), c6.data(), count);
+	entity_collection_t* collection = app->entity_collections.items() + match->collection_index;
+	ecs_span_t span;
+	span.entity_count = count;
+	for (int i = 0; i < component_count; ++i) {
+		span.components[i] = s_get_component(collection, match->matches[i], begin);
+	}
+	span.entity_type = app->entity_collections.keys()[match->collection_index];
+	span.entity_handles = collection->entity_handles.data() + begin;
+	return span;
 }
 
-static void s_8(float dt, void* fn_uncasted, void* udata, typeless_array& c0, typeless_array& c1, typeless_array& c2, typeless_array& c3, typeless_array& c4, typeless_array& c5, typeless_array& c6, typeless_array& c7)
+ecs_query_t ecs_query(const array<const char*>& component_types)
 {
-	CUTE_ASSERT(c0.count() == c1.count() && c0.count() == c2.count() && c0.count() == c3.count() && c0.count() == c4.count() && c0.count() == c5.count() && c0.count() == c6.count() && c0.count() == c7.count());
-	auto fn = (void (*)(float, void*, void*, void*, void*, void*, void*, void*, void*, void*, int))fn_uncasted;
-	int count = c0.count();
-	fn(dt, udata, c0.data(), c1.data(), c2.data(), c3.data(), c4.data(), c5.data(), c6.data(), c7.data(), count);
+	ecs_query_t query = { -1 };
+	if (component_types.count() > 8) {
+		CUTE_DEBUG_PRINTF("Queries can have at most 8 component types.");
+		return query;
+	}
+
+	array<strpool_id> component_type_tuple;
+	for (int i = 0; i < component_types.count(); ++i) {
+		component_type_tuple.add(INJECT(component_types[i]));
+	}
+
+	// Reuse an existing query with the same component types.
+	for (int i = 0; i < app->queries.count(); ++i)
+	{
+		const array<strpool_id>& tuple = app->queries[i]->component_type_tuple;
+		if (tuple.count() != component_type_tuple.count()) continue;
+		bool same = true;
+		for (int j = 0; j < tuple.count() && same; ++j) {
+			same = tuple[j].val == component_type_tuple[j].val;
+		}
+		if (same) {
+			query.id = i;
+			return query;
+		}
+	}
+
+	query.id = app->queries.count();
+	query_internal_t* q = CUTE_NEW(query_internal_t, app->mem_ctx);
+	q->component_type_tuple.steal_from(&component_type_tuple);
+	app->queries.add(q);
+	return query;
 }
 
-static inline void s_match(array<int>* matches, const array<strpool_id>& a, const array<strpool_id>& b)
+void ecs_query_for_each(ecs_query_t query, ecs_query_fn* fn, void* udata)
 {
-	for (int i = 0; i < a.count(); ++i)
+	query_internal_t* q = s_query(query);
+	if (!q) return;
+
+	int component_count = q->component_type_tuple.count();
+	for (int i = 0; i < q->matches.count(); ++i)
 	{
-		for (int j = 0; j < b.count(); ++j)
+		const system_match_t* match = q->matches + i;
+		entity_collection_t* collection = app->entity_collections.items() + match->collection_index;
+		int entity_count = collection->entity_handles.count();
+		for (int begin = 0; begin < entity_count;)
 		{
-			if (a[i].val == b[j].val) {
-				matches->add(j);
-				break;
-			}
+			int count = s_span_length(collection, begin, entity_count);
+			fn(s_span(match, component_count, begin, count), udata);
+			begin += count;
 		}
 	}
 }
 
-void ecs_run_systems(float dt)
+static void s_query_job(void* param)
 {
-	int system_count = app->systems.count();
-	for (int i = 0; i < system_count; ++i)
-	{
-		system_internal_t* system = app->systems + i;
-		void* update_fn = system->update_fn;
-		auto pre_update_fn = system->pre_update_fn;
-		auto post_update_fn = system->post_update_fn;
-		void* udata = system->udata;
+	query_job_t* job = (query_job_t*)param;
+	job->fn(job->span, job->udata);
+}
 
-		if (pre_update_fn) pre_update_fn(dt, udata);
+void ecs_query_parallel_for_each(ecs_query_t query, ecs_query_fn* fn, void* udata, int entities_per_job)
+{
+	if (!app->threadpool) {
+		ecs_query_for_each(query, fn, udata);
+		return;
+	}
 
-		if (update_fn) {
-			for (int j = 0; j < app->entity_collections.count(); ++j)
-			{
-				entity_collection_t* collection = app->entity_collections.items() + j;
-				CUTE_ASSERT(collection->component_tables.count() == collection->component_type_tuple.count());
-				int component_count = collection->component_tables.count();
-				app->current_collection_type_being_iterated = app->entity_collections.keys()[j];
-				app->current_collection_being_updated = collection;
-				CUTE_DEFER(app->current_collection_type_being_iterated = ~0);
-				CUTE_DEFER(app->current_collection_being_updated = NULL);
-
-				array<int> matches;
-				s_match(&matches, system->component_type_tuple, collection->component_type_tuple);
-
-				array<typeless_array>& tables = collection->component_tables;
-
-				if (matches.count() == system->component_type_tuple.count()) {
-					switch (matches.count())
-					{
-					case 0: s_0(dt, update_fn, udata); break;
-					case 1: s_1(dt, update_fn, udata, tables[matches[0]]); break;
-					case 2: s_2(dt, update_fn, udata, tables[matches[0]], tables[matches[1]]); break;
-					case 3: s_3(dt, update_fn, udata, tables[matches[0]], tables[matches[1]], tables[matches[2]]); break;
-					case 4: s_4(dt, update_fn, udata, tables[matches[0]], tables[matches[1]], tables[matches[2]], tables[matches[3]]); break;
-					case 5: s_5(dt, update_fn, udata, tables[matches[0]], tables[matches[1]], tables[matches[2]], tables[matches[3]], tables[matches[4]]); break;
-					case 6: s_6(dt, update_fn, udata, tables[matches[0]], tables[matches[1]], tables[matches[2]], tables[matches[3]], tables[matches[4]], tables[matches[5]]); break;
-					case 7: s_7(dt, update_fn, udata, tables[matches[0]], tables[matches[1]], tables[matches[2]], tables[matches[3]], tables[matches[4]], tables[matches[5]], tables[matches[6]]); break;
-					case 8: s_8(dt, update_fn, udata, tables[matches[0]], tables[matches[1]], tables[matches[2]], tables[matches[3]], tables[matches[4]], tables[matches[5]], tables[matches[6]], tables[matches[7]]); break;
-					default: CUTE_ASSERT(0);
-					}
-				}
-			}
-		}
+	query_internal_t* q = s_query(query);
+	if (!q) return;
 
-		if (post_update_fn) post_update_fn(dt, udata);
+	int component_count = q->component_type_tuple.count();
+
+	// Collect all jobs first, as `query_jobs` must not grow once tasks are in flight.
+	app->query_jobs.clear();
+	for (int i = 0; i < q->matches.count(); ++i)
+	{
+		const system_match_t* match = q->matches + i;
+		entity_collection_t* collection = app->entity_collections.items() + match->collection_index;
+		int entity_count = collection->entity_handles.count();
+		for (int begin = 0; begin < entity_count;)
+		{
+			int count = s_span_length(collection, begin, entity_count);
+			if (entities_per_job > 0) count = min(count, entities_per_job);
+
+			query_job_t job;
+			job.fn = fn;
+			job.udata = udata;
+			job.span = s_span(match, component_count, begin, count);
+			app->query_jobs.add(job);
+			begin += count;
+		}
 	}
 
-	for (int i = 0; i < app->delayed_destroy_entities.count(); ++i) {
-		entity_t e = app->delayed_destroy_entities[i];
-		entity_destroy(e);
+	int job_count = app->query_jobs.count();
+	if (job_count) {
+		for (int i = 0; i < job_count; ++i) {
+			threadpool_add_task(app->threadpool, s_query_job, app->query_jobs + i);
+		}
+		threadpool_kick_and_wait(app->threadpool);
 	}
-	app->delayed_destroy_entities.clear();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -385,7 +1347,11 @@ void ecs_component_begin()
 
 void ecs_component_end()
 {
-	app->component_configs.insert(INJECT(app->component_config_builder.name), app->component_config_builder);
+	app->component_config_builder.id = app->component_configs.count();
+	strpool_id name = INJECT(app->component_config_builder.name);
+	s_register_name(name);
+	app->component_configs.insert(name, app->component_config_builder);
+	app->ecs_gen++;
 }
 
 void ecs_component_set_name(const char* name)
@@ -410,6 +1376,24 @@ void ecs_component_set_optional_cleanup(component_cleanup_fn* cleanup_fn, void*
 	app->component_config_builder.cleanup_udata = udata;
 }
 
+void ecs_component_set_optional_copy_defaults(bool true_to_copy_defaults)
+{
+	app->component_config_builder.copy_defaults = true_to_copy_defaults;
+}
+
+void ecs_component_set_optional_snapshot_serialize(bool true_to_use_serializer)
+{
+	app->component_config_builder.snapshot_serialize = true_to_use_serializer;
+}
+
+component_id_t ecs_component_id(const char* component_type)
+{
+	component_config_t* config = app->component_configs.find(s_find_name(component_type));
+	if (!config) return INVALID_COMPONENT_ID;
+	component_id_t id = { config->id };
+	return id;
+}
+
 static strpool_id s_kv_string(kv_t* kv, const char* key)
 {
 	error_t err = kv_key(kv, key);
@@ -431,7 +1415,41 @@ static strpool_id s_kv_string(kv_t* kv, const char* key)
 	return strpool_inject(app->strpool, string_raw, (int)string_sz);
 }
 
-static void s_register_entity_type(const char* schema)
+static void s_build_component_columns(entity_collection_t* collection)
+{
+	array<int>& columns = collection->component_columns;
+	columns.ensure_count(app->component_configs.count());
+	for (int i = 0; i < columns.count(); ++i) columns[i] = -1;
+	for (int i = 0; i < collection->component_type_tuple.count(); ++i) {
+		component_config_t* config = app->component_configs.find(collection->component_type_tuple[i]);
+		columns[config->id] = i;
+	}
+}
+
+static void s_retire_entity_type(uint32_t old_type, uint32_t new_type)
+{
+	// Entity types inheriting from the old type now inherit from the new one.
+	uint32_t* parents = app->entity_schema_inheritence.items();
+	for (int i = 0; i < app->entity_schema_inheritence.count(); ++i) {
+		if (parents[i] == old_type) parents[i] = new_type;
+	}
+
+	// The old schema was only used to make new entities, which now go to the new type.
+	kv_t* schema = NULL;
+	if (!app->entity_parsed_schemas.find(old_type, &schema).is_error()) {
+		kv_destroy(schema);
+		app->entity_parsed_schemas.remove(old_type);
+	}
+	if (app->entity_schema_inheritence.find(old_type)) app->entity_schema_inheritence.remove(old_type);
+
+	// Entities already made keep the old collection, unless there aren't any.
+	entity_collection_t* collection = app->entity_collections.find(old_type);
+	if (collection && !collection->entity_handles.count()) {
+		app->entity_collections.remove(old_type);
+	}
+}
+
+static entity_collection_t* s_register_entity_type(const char* schema)
 {
 	// Parse the schema.
 	kv_t* kv = kv_make();
@@ -441,11 +1459,11 @@ static void s_register_entity_type(const char* schema)
 	error_t err = kv_parse(kv, schema, CUTE_STRLEN(schema));
 	if (err.is_error()) {
 		CUTE_DEBUG_PRINTF("Unable to parse the schema when registering entity type.");
-		return;
+		return NULL;
 	}
 
 	strpool_id entity_type_string = s_kv_string(kv, "entity_type");
-	if (!strpool_isvalid(app->strpool, entity_type_string)) return;
+	if (!strpool_isvalid(app->strpool, entity_type_string)) return NULL;
 	
 	strpool_id inherits_from_string = s_kv_string(kv, "inherits_from");
 	uint32_t inherits_from = ~0;
@@ -469,10 +1487,20 @@ static void s_register_entity_type(const char* schema)
 	kv_reset_read_state(kv);
 
 	// Register component types.
+	// Registering a type name again makes new entities use the new schema, while entities already made
+	// keep the old one.
 	uint32_t entity_type = app->entity_type_gen++;
+	uint32_t old_entity_type = ~0;
+	if (!app->entity_type_string_to_id.find(entity_type_string, &old_entity_type).is_error()) {
+		CUTE_ASSERT(inherits_from != old_entity_type);
+		app->entity_type_string_to_id.remove(entity_type_string);
+		s_retire_entity_type(old_entity_type, entity_type);
+	}
 	app->entity_type_string_to_id.insert(entity_type_string, entity_type);
+	s_register_name(entity_type_string);
 	app->entity_type_id_to_string.add(entity_type_string);
 	entity_collection_t* collection = app->entity_collections.insert(entity_type);
+	app->system_matches_dirty = true;
 	for (int i = 0; i < component_type_tuple.count(); ++i)
 	{
 		collection->component_type_tuple.add(component_type_tuple[i]);
@@ -480,6 +1508,7 @@ static void s_register_entity_type(const char* schema)
 		component_config_t* config = app->component_configs.find(component_type_tuple[i]);
 		table.m_element_size = config->size_of_component;
 	}
+	s_build_component_columns(collection);
 
 	// Store the parsed schema.
 	app->entity_parsed_schemas.insert(entity_type, kv);
@@ -488,9 +1517,11 @@ static void s_register_entity_type(const char* schema)
 	}
 
 	cleanup_kv = false;
+
+	return collection;
 }
 
-static void s_register_entity_type(array<const char*> component_type_tuple, const char* entity_type_string)
+static entity_collection_t* s_register_entity_type(array<const char*> component_type_tuple, const char* entity_type_string)
 {
 	// Search for all component types present in the schema.
 	int component_config_count = app->component_configs.count();
@@ -516,9 +1547,16 @@ static void s_register_entity_type(array<const char*> component_type_tuple, cons
 	// Register component types.
 	strpool_id entity_type_string_id = INJECT(entity_type_string);
 	uint32_t entity_type = app->entity_type_gen++;
+	uint32_t old_entity_type = ~0;
+	if (!app->entity_type_string_to_id.find(entity_type_string_id, &old_entity_type).is_error()) {
+		app->entity_type_string_to_id.remove(entity_type_string_id);
+		s_retire_entity_type(old_entity_type, entity_type);
+	}
 	app->entity_type_string_to_id.insert(entity_type_string_id, entity_type);
+	s_register_name(entity_type_string_id);
 	app->entity_type_id_to_string.add(entity_type_string_id);
 	entity_collection_t* collection = app->entity_collections.insert(entity_type);
+	app->system_matches_dirty = true;
 	for (int i = 0; i < component_type_ids.count(); ++i)
 	{
 		collection->component_type_tuple.add(component_type_ids[i]);
@@ -526,6 +1564,9 @@ static void s_register_entity_type(array<const char*> component_type_tuple, cons
 		component_config_t* config = app->component_configs.find(component_type_ids[i]);
 		table.m_element_size = config->size_of_component;
 	}
+	s_build_component_columns(collection);
+
+	return collection;
 }
 
 
@@ -536,11 +1577,19 @@ void ecs_entity_begin()
 
 void ecs_entity_end()
 {
+	entity_collection_t* collection;
 	if (app->entity_config_builder.schema.is_valid()) {
-		s_register_entity_type(app->entity_config_builder.schema.c_str());
+		collection = s_register_entity_type(app->entity_config_builder.schema.c_str());
 	} else {
-		s_register_entity_type(app->entity_config_builder.component_types, app->entity_config_builder.entity_type);
+		collection = s_register_entity_type(app->entity_config_builder.component_types, app->entity_config_builder.entity_type);
 	}
+
+	if (collection && app->entity_config_builder.chunked_storage) {
+		s_init_chunked_storage(collection);
+	}
+
+	// Schemas may inherit from each other, so rebake all default components.
+	app->ecs_gen++;
 }
 
 void ecs_entity_set_name(const char* entity_type)
@@ -558,6 +1607,11 @@ void ecs_entity_set_optional_schema(const char* schema)
 	app->entity_config_builder.schema = schema;
 }
 
+void ecs_entity_set_optional_chunked_storage(bool true_to_use_chunks)
+{
+	app->entity_config_builder.chunked_storage = true_to_use_chunks;
+}
+
 const char* entity_get_type_string(entity_t entity)
 {
 	return strpool_cstr(app->strpool, app->entity_type_id_to_string[entity.type]);
@@ -648,6 +1702,12 @@ error_t ecs_load_entities(kv_t* kv, array<entity_t>* entities_out)
 
 		entity_collection_t* collection = app->entity_collections.find(entity_type);
 		CUTE_ASSERT(collection);
+		int index = s_add_row(collection);
+
+		err = s_bake_prototype(entity_type, collection, entity);
+		if (err.is_error()) {
+			return error_failure("Unable to parse component from schema.");
+		}
 
 		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
 		for (int i = 0; i < component_type_tuple.count(); ++i)
@@ -660,8 +1720,8 @@ error_t ecs_load_entities(kv_t* kv, array<entity_t>* entities_out)
 			}
 
 			// First load values from the schema.
-			void* component = collection->component_tables[i].add();
-			err = s_load_from_schema(entity.type, entity, config, component, config->serializer_udata);
+			void* component = s_get_component(collection, i, index);
+			err = s_load_defaults(entity.type, collection, i, entity, config, component);
 			if (err.is_error()) {
 				return error_failure("Unable to parse component from schema.");
 			}
@@ -696,8 +1756,11 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 	}
 
 	dictionary<entity_t, int> id_table;
-	for (int i = 0; i < entities.count(); ++i)
-		id_table.insert(entities[i], i);
+	for (int i = 0; i < entities.count(); ++i) {
+		entity_t key;
+		entity_to_key(entities[i], &key);
+		id_table.insert(key, i);
+	}
 
 	app->save_id_table = &id_table;
 	CUTE_DEFER(app->save_id_table = NULL);
@@ -728,13 +1791,11 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 		kv_val_string(kv, &entity_type_string, &entity_type_string_len);
 
 		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
-		const array<typeless_array>& component_tables = collection->component_tables;
 		for (int j = 0; j < component_type_tuple.count(); ++j)
 		{
 			strpool_id component_type = component_type_tuple[j];
-			const typeless_array& component_table = component_tables[j];
 			component_config_t* config = app->component_configs.find(component_type);
-			const void* component = component_table[index];
+			const void* component = s_get_component(collection, j, index);
 
 			error_t err = kv_object_begin(kv, config->name);
 			if (!err.is_error()) {
@@ -757,8 +1818,11 @@ error_t ecs_save_entities(const array<entity_t>& entities, kv_t* kv)
 error_t ecs_save_entities(const array<entity_t>& entities)
 {
 	dictionary<entity_t, int> id_table;
-	for (int i = 0; i < entities.count(); ++i)
-		id_table.insert(entities[i], i);
+	for (int i = 0; i < entities.count(); ++i) {
+		entity_t key;
+		entity_to_key(entities[i], &key);
+		id_table.insert(key, i);
+	}
 
 	app->save_id_table = &id_table;
 	CUTE_DEFER(app->save_id_table = NULL);
@@ -781,13 +1845,11 @@ error_t ecs_save_entities(const array<entity_t>& entities)
 		const char* entity_type_string = strpool_cstr(app->strpool, app->entity_type_id_to_string[entity.type]);
 
 		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
-		const array<typeless_array>& component_tables = collection->component_tables;
 		for (int j = 0; j < component_type_tuple.count(); ++j)
 		{
 			strpool_id component_type = component_type_tuple[j];
-			const typeless_array& component_table = component_tables[j];
 			component_config_t* config = app->component_configs.find(component_type);
-			const void* component = component_table[index];
+			const void* component = s_get_component(collection, j, index);
 
 			error_t err = config->serializer_fn(NULL, false, entity, (void*)component, config->serializer_udata);
 			if (err.is_error()) {
@@ -799,6 +1861,424 @@ error_t ecs_save_entities(const array<entity_t>& entities)
 	return error_success();
 }
 
+//--------------------------------------------------------------------------------------------------
+// Binary snapshots.
+
+#define CUTE_ECS_SNAPSHOT_MAGIC 0x53534643 // "CFSS"
+#define CUTE_ECS_SNAPSHOT_VERSION 1
+
+struct snapshot_reader_t
+{
+	const uint8_t* at;
+	const uint8_t* end;
+	bool ok;
+};
+
+static void* s_write(array<uint8_t>* buffer, const void* data, size_t size)
+{
+	int at = buffer->count();
+	buffer->ensure_count(at + (int)size);
+	void* dst = buffer->data() + at;
+	if (data) CUTE_MEMCPY(dst, data, size);
+	return dst;
+}
+
+static CUTE_INLINE void s_write_u32(array<uint8_t>* buffer, uint32_t val)
+{
+	s_write(buffer, &val, sizeof(val));
+}
+
+static void s_write_string(array<uint8_t>* buffer, const char* string)
+{
+	uint32_t len = (uint32_t)CUTE_STRLEN(string);
+	s_write_u32(buffer, len);
+	s_write(buffer, string, len);
+}
+
+static const void* s_read(snapshot_reader_t* reader, size_t size)
+{
+	if (!reader->ok || (size_t)(reader->end - reader->at) < size) {
+		reader->ok = false;
+		return NULL;
+	}
+	const void* data = reader->at;
+	reader->at += size;
+	return data;
+}
+
+static CUTE_INLINE uint32_t s_read_u32(snapshot_reader_t* reader)
+{
+	uint32_t val = 0;
+	const void* data = s_read(reader, sizeof(val));
+	if (data) CUTE_MEMCPY(&val, data, sizeof(val));
+	return val;
+}
+
+static bool s_read_string_matches(snapshot_reader_t* reader, const char* string)
+{
+	uint32_t len = s_read_u32(reader);
+	const void* data = s_read(reader, len);
+	return data && len == (uint32_t)CUTE_STRLEN(string) && !CUTE_MEMCMP(data, string, len);
+}
+
+static void s_set_row_count(entity_collection_t* collection, int count)
+{
+	if (collection->chunked) {
+		int chunks_needed = (count + collection->entities_per_chunk - 1) / collection->entities_per_chunk;
+		while (collection->chunks.count() < chunks_needed) {
+			void* chunk = CUTE_ALLOC(collection->chunk_size + CUTE_ECS_CHUNK_ALIGNMENT, app->mem_ctx);
+			CUTE_ASSERT(chunk);
+			collection->chunks.add(chunk);
+		}
+		while (collection->chunks.count() > chunks_needed + 1) {
+			CUTE_FREE(collection->chunks.pop(), app->mem_ctx);
+		}
+		collection->row_count = count;
+	} else {
+		array<typeless_array>& tables = collection->component_tables;
+		for (int i = 0; i < tables.count(); ++i) {
+			tables[i].ensure_capacity(count);
+			tables[i].m_count = count;
+		}
+	}
+}
+
+static void s_snapshot_entities(array<entity_t>* entities)
+{
+	// All entities in the same order as they are stored in the snapshot, so `kv_val_entity` can map
+	// entities to and from indices within serialized components.
+	int collection_count = app->entity_collections.count();
+	for (int i = 0; i < collection_count; ++i) {
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		uint32_t type = app->entity_collections.keys()[i];
+		for (int j = 0; j < collection->entity_handles.count(); ++j) {
+			entity_t entity = { type, collection->entity_handles[j] };
+			entities->add(entity);
+		}
+	}
+}
+
+static error_t s_check_snapshot_components()
+{
+	// Loading a snapshot calls the cleanup functions of all current components. Raw bytes copied back in
+	// afterwards would point at whatever memory those cleanup functions just freed.
+	for (int i = 0; i < app->entity_collections.count(); ++i) {
+		const entity_collection_t* collection = app->entity_collections.items() + i;
+		for (int j = 0; j < collection->component_type_tuple.count(); ++j) {
+			const component_config_t* config = app->component_configs.find(collection->component_type_tuple[j]);
+			if (config->cleanup_fn && !config->snapshot_serialize) {
+				return error_failure("Components with a cleanup function must be saved with their serializer in snapshots.");
+			}
+		}
+	}
+	return error_success();
+}
+
+error_t ecs_save_snapshot(array<uint8_t>* snapshot_out)
+{
+	error_t err = s_check_snapshot_components();
+	if (err.is_error()) return err;
+
+	snapshot_out->clear();
+	s_write_u32(snapshot_out, CUTE_ECS_SNAPSHOT_MAGIC);
+	s_write_u32(snapshot_out, CUTE_ECS_SNAPSHOT_VERSION);
+	int collection_count = app->entity_collections.count();
+	s_write_u32(snapshot_out, (uint32_t)collection_count);
+
+	// Only bother mapping entities to indices if some component needs its serializer.
+	dictionary<entity_t, int> id_table;
+	for (int i = 0; i < app->component_configs.count(); ++i) {
+		if (app->component_configs.items()[i].snapshot_serialize) {
+			array<entity_t> entities;
+			s_snapshot_entities(&entities);
+			for (int j = 0; j < entities.count(); ++j) {
+				entity_t key;
+				entity_to_key(entities[j], &key);
+				id_table.insert(key, j);
+			}
+			break;
+		}
+	}
+	app->save_id_table = &id_table;
+	CUTE_DEFER(app->save_id_table = NULL);
+
+	for (int i = 0; i < collection_count; ++i)
+	{
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		uint32_t type = app->entity_collections.keys()[i];
+		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
+		int entity_count = collection->entity_handles.count();
+
+		s_write_string(snapshot_out, strpool_cstr(app->strpool, app->entity_type_id_to_string[type]));
+		s_write_u32(snapshot_out, (uint32_t)component_type_tuple.count());
+		s_write_u32(snapshot_out, (uint32_t)entity_count);
+		for (int j = 0; j < component_type_tuple.count(); ++j) {
+			component_config_t* config = app->component_configs.find(component_type_tuple[j]);
+			s_write_string(snapshot_out, config->name);
+			s_write_u32(snapshot_out, (uint32_t)config->size_of_component);
+			s_write_u32(snapshot_out, config->snapshot_serialize ? 1 : 0);
+		}
+
+		// Handles are stored as-is, so entities stay valid across saving and loading.
+		handle_allocator_t* handle_allocator = collection->entity_handle_table.m_alloc;
+		size_t handle_state_size = handle_allocator_state_size(handle_allocator);
+		s_write_u32(snapshot_out, (uint32_t)handle_state_size);
+		handle_allocator_get_state(handle_allocator, s_write(snapshot_out, NULL, handle_state_size));
+		s_write(snapshot_out, collection->entity_handles.data(), sizeof(handle_t) * entity_count);
+
+		for (int j = 0; j < component_type_tuple.count(); ++j)
+		{
+			component_config_t* config = app->component_configs.find(component_type_tuple[j]);
+			if (config->snapshot_serialize) {
+				kv_t* kv = kv_make();
+				CUTE_DEFER(kv_destroy(kv));
+				kv_write_mode(kv);
+				int count = entity_count;
+				kv_array_begin(kv, &count, "components");
+				for (int k = 0; k < entity_count; ++k) {
+					entity_t entity = { type, collection->entity_handles[k] };
+					kv_object_begin(kv);
+					error_t err = config->serializer_fn(kv, false, entity, s_get_component(collection, j, k), config->serializer_udata);
+					if (err.is_error()) return error_failure("Unable to save component.");
+					kv_object_end(kv);
+				}
+				kv_array_end(kv);
+				if (kv_error_state(kv).is_error()) return error_failure("Unable to save component.");
+				s_write_u32(snapshot_out, (uint32_t)kv_size_written(kv));
+				s_write(snapshot_out, kv_get_buffer(kv), kv_size_written(kv));
+			} else {
+				// Raw component bytes, one contiguous block per chunk.
+				size_t size = config->size_of_component;
+				for (int begin = 0; begin < entity_count;) {
+					int count = s_span_length(collection, begin, entity_count);
+					s_write(snapshot_out, s_get_component(collection, j, begin), size * count);
+					begin += count;
+				}
+			}
+		}
+	}
+
+	return error_success();
+}
+
+struct snapshot_collection_t
+{
+	int entity_count;
+	const void* handle_state;
+	size_t handle_state_size;
+	const void* handles;
+	int first_block; // Index into the blocks, one per component type.
+};
+
+struct snapshot_block_t
+{
+	const void* data;
+	size_t size;
+	void* components; // Components loaded with their serializer, ahead of replacing any entities.
+	int loaded_count;
+};
+
+static void s_free_snapshot_blocks(array<snapshot_block_t>* blocks, array<snapshot_collection_t>* collections, bool cleanup)
+{
+	// Cleanup functions are only called for components that never made it into the world.
+	for (int i = 0; i < collections->count(); ++i)
+	{
+		const snapshot_collection_t* snapshot_collection = collections->data() + i;
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		uint32_t type = app->entity_collections.keys()[i];
+		for (int j = 0; j < collection->component_type_tuple.count(); ++j) {
+			snapshot_block_t* block = blocks->data() + snapshot_collection->first_block + j;
+			if (!block->components) continue;
+			component_config_t* config = app->component_configs.find(collection->component_type_tuple[j]);
+			if (cleanup && config->cleanup_fn) {
+				for (int k = 0; k < block->loaded_count; ++k) {
+					handle_t handle;
+					CUTE_MEMCPY(&handle, (const handle_t*)snapshot_collection->handles + k, sizeof(handle));
+					entity_t entity = { type, handle };
+					config->cleanup_fn(entity, (uint8_t*)block->components + config->size_of_component * k, config->cleanup_udata);
+				}
+			}
+			CUTE_FREE(block->components, app->mem_ctx);
+			block->components = NULL;
+		}
+	}
+}
+
+static error_t s_load_snapshot_components(array<snapshot_block_t>* blocks, array<snapshot_collection_t>* collections)
+{
+	// Entities in the same order as `s_snapshot_entities`, but taken from the snapshot, as the
+	// current entities are still in place.
+	array<entity_t> load_id_table;
+	for (int i = 0; i < collections->count(); ++i) {
+		const snapshot_collection_t* snapshot_collection = collections->data() + i;
+		uint32_t type = app->entity_collections.keys()[i];
+		for (int k = 0; k < snapshot_collection->entity_count; ++k) {
+			entity_t entity = { type, 0 };
+			CUTE_MEMCPY(&entity.handle, (const handle_t*)snapshot_collection->handles + k, sizeof(handle_t));
+			load_id_table.add(entity);
+		}
+	}
+	app->load_id_table = &load_id_table;
+	CUTE_DEFER(app->load_id_table = NULL);
+
+	for (int i = 0; i < collections->count(); ++i)
+	{
+		const snapshot_collection_t* snapshot_collection = collections->data() + i;
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		uint32_t type = app->entity_collections.keys()[i];
+		int entity_count = snapshot_collection->entity_count;
+		for (int j = 0; j < collection->component_type_tuple.count(); ++j)
+		{
+			component_config_t* config = app->component_configs.find(collection->component_type_tuple[j]);
+			if (!config->snapshot_serialize || !entity_count) continue;
+			snapshot_block_t* block = blocks->data() + snapshot_collection->first_block + j;
+
+			kv_t* kv = kv_make();
+			CUTE_DEFER(kv_destroy(kv));
+			error_t err = kv_parse(kv, block->data, block->size);
+			if (err.is_error()) return error_failure("Unable to parse component from snapshot.");
+
+			entity_t first = { type, 0 };
+			CUTE_MEMCPY(&first.handle, snapshot_collection->handles, sizeof(handle_t));
+			err = s_bake_prototype(type, collection, first);
+			if (err.is_error()) return error_failure("Unable to parse component from schema.");
+
+			int count;
+			kv_array_begin(kv, &count, "components");
+			if (count != entity_count) return error_failure("Snapshot has a mismatched component count.");
+			block->components = CUTE_ALLOC(config->size_of_component * entity_count, app->mem_ctx);
+			for (int k = 0; k < entity_count; ++k) {
+				entity_t entity = { type, 0 };
+				CUTE_MEMCPY(&entity.handle, (const handle_t*)snapshot_collection->handles + k, sizeof(handle_t));
+				void* component = (uint8_t*)block->components + config->size_of_component * k;
+				err = s_load_defaults(type, collection, j, entity, config, component);
+				if (err.is_error()) return error_failure("Unable to parse component from schema.");
+				block->loaded_count++;
+				kv_object_begin(kv);
+				err = config->serializer_fn(kv, true, entity, component, config->serializer_udata);
+				if (err.is_error()) return error_failure("Unable to parse component.");
+				kv_object_end(kv);
+			}
+			kv_array_end(kv);
+			if (kv_error_state(kv).is_error()) return error_failure("Unable to parse component.");
+		}
+	}
+
+	return error_success();
+}
+
+error_t ecs_load_snapshot(const void* snapshot, size_t size)
+{
+	// Check every size and count of the whole snapshot against the registered entity and component types
+	// before touching anything, so a bad snapshot leaves all entities as they were.
+	error_t err = s_check_snapshot_components();
+	if (err.is_error()) return err;
+
+	snapshot_reader_t reader = { (const uint8_t*)snapshot, (const uint8_t*)snapshot + size, true };
+	if (s_read_u32(&reader) != CUTE_ECS_SNAPSHOT_MAGIC) return error_failure("Not an ECS snapshot.");
+	if (s_read_u32(&reader) != CUTE_ECS_SNAPSHOT_VERSION) return error_failure("Unsupported ECS snapshot version.");
+	int collection_count = app->entity_collections.count();
+	if (s_read_u32(&reader) != (uint32_t)collection_count) return error_failure("Snapshot was saved with different entity types.");
+
+	array<snapshot_collection_t> collections;
+	array<snapshot_block_t> blocks;
+	for (int i = 0; i < collection_count && reader.ok; ++i)
+	{
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		uint32_t type = app->entity_collections.keys()[i];
+		const array<strpool_id>& component_type_tuple = collection->component_type_tuple;
+
+		bool match = s_read_string_matches(&reader, strpool_cstr(app->strpool, app->entity_type_id_to_string[type]));
+		match = match && s_read_u32(&reader) == (uint32_t)component_type_tuple.count();
+		uint32_t entity_count = s_read_u32(&reader);
+		for (int j = 0; j < component_type_tuple.count() && match; ++j) {
+			component_config_t* config = app->component_configs.find(component_type_tuple[j]);
+			match = s_read_string_matches(&reader, config->name);
+			match = match && s_read_u32(&reader) == (uint32_t)config->size_of_component;
+			match = match && s_read_u32(&reader) == (config->snapshot_serialize ? 1u : 0u);
+		}
+		if (!match) return error_failure("Snapshot was saved with different entity or component types.");
+		if (entity_count > (uint32_t)INT32_MAX) return error_failure("Snapshot is truncated or corrupted.");
+
+		snapshot_collection_t snapshot_collection;
+		snapshot_collection.entity_count = (int)entity_count;
+		snapshot_collection.handle_state_size = s_read_u32(&reader);
+		snapshot_collection.handle_state = s_read(&reader, snapshot_collection.handle_state_size);
+		snapshot_collection.handles = s_read(&reader, sizeof(handle_t) * entity_count);
+		snapshot_collection.first_block = blocks.count();
+		if (!reader.ok) break;
+		if (!handle_allocator_is_state_valid(snapshot_collection.handle_state, snapshot_collection.handle_state_size, (const handle_t*)snapshot_collection.handles, (int)entity_count)) {
+			return error_failure("Snapshot has corrupted entity handles.");
+		}
+		collections.add(snapshot_collection);
+
+		for (int j = 0; j < component_type_tuple.count(); ++j) {
+			component_config_t* config = app->component_configs.find(component_type_tuple[j]);
+			snapshot_block_t block;
+			block.size = config->snapshot_serialize ? s_read_u32(&reader) : config->size_of_component * entity_count;
+			block.data = s_read(&reader, block.size);
+			block.components = NULL;
+			block.loaded_count = 0;
+			blocks.add(block);
+		}
+	}
+	if (!reader.ok || reader.at != reader.end) return error_failure("Snapshot is truncated or corrupted.");
+
+	// Components opting into their serializer are loaded into scratch memory up-front, since loading
+	// them may fail.
+	err = s_load_snapshot_components(&blocks, &collections);
+	if (err.is_error()) {
+		s_free_snapshot_blocks(&blocks, &collections, true);
+		return err;
+	}
+
+	// Nothing can fail from here on. Throw away all current entities, then move in the snapshot.
+	for (int i = 0; i < collection_count; ++i)
+	{
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		uint32_t type = app->entity_collections.keys()[i];
+		for (int j = 0; j < collection->component_type_tuple.count(); ++j) {
+			component_config_t* config = app->component_configs.find(collection->component_type_tuple[j]);
+			if (!config->cleanup_fn) continue;
+			for (int k = 0; k < collection->entity_handles.count(); ++k) {
+				entity_t entity = { type, collection->entity_handles[k] };
+				config->cleanup_fn(entity, s_get_component(collection, j, k), config->cleanup_udata);
+			}
+		}
+	}
+	s_clear_command_buffers();
+
+	for (int i = 0; i < collection_count; ++i)
+	{
+		const snapshot_collection_t* snapshot_collection = collections + i;
+		entity_collection_t* collection = app->entity_collections.items() + i;
+		int entity_count = snapshot_collection->entity_count;
+
+		int ok = handle_allocator_set_state(collection->entity_handle_table.m_alloc, snapshot_collection->handle_state, snapshot_collection->handle_state_size);
+		CUTE_ASSERT(ok);
+		(void)ok;
+		collection->entity_handles.clear();
+		collection->entity_handles.ensure_count(entity_count);
+		CUTE_MEMCPY(collection->entity_handles.data(), snapshot_collection->handles, sizeof(handle_t) * entity_count);
+		s_set_row_count(collection, entity_count);
+
+		for (int j = 0; j < collection->component_type_tuple.count(); ++j)
+		{
+			const snapshot_block_t* block = blocks + snapshot_collection->first_block + j;
+			size_t component_size = collection->component_tables[j].m_element_size;
+			const uint8_t* src = (const uint8_t*)(block->components ? block->components : block->data);
+			for (int begin = 0; begin < entity_count;) {
+				int count = s_span_length(collection, begin, entity_count);
+				CUTE_MEMCPY(s_get_component(collection, j, begin), src + component_size * begin, component_size * count);
+				begin += count;
+			}
+		}
+	}
+
+	s_free_snapshot_blocks(&blocks, &collections, false);
+	return error_success();
+}
+
 array<const char*> ecs_get_entity_list()
 {
 	array<const char*> names;
@@ -845,7 +2325,7 @@ array<const char*> ecs_get_component_list_for_entity_type(const char* entity_typ
 	array<const char*> result;
 
 	uint32_t type = ~0;
-	app->entity_type_string_to_id.find(INJECT(entity_type), &type);
+	app->entity_type_string_to_id.find(s_find_name(entity_type), &type);
 	if (type == ~0) {
 		return result;
 	}
@@ -30,9 +30,18 @@
 #include <cute_file_system.h>
 #include <cute_image.h>
 #include <cute_gfx.h>
+#include <cute_concurrency.h>
+#include <cute_c_runtime.h>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#define STBTT_STATIC
+#define STBTT_malloc(size, ctx) CUTE_ALLOC(size, ctx)
+#define STBTT_free(ptr, ctx) CUTE_FREE(ptr, ctx)
+#include <imgui/imstb_truetype.h>
 
 #include <internal/cute_app_internal.h>
 #include <internal/cute_font_internal.h>
+#include <internal/cute_frame_cache_internal.h>
 
 #include <shaders/font_shader.h>
 
@@ -93,8 +102,436 @@ font_t* font_load_bmfont(const char* font_path, const char* font_image_path)
 	return font;
 }
 
+// -------------------------------------------------------------------------------------------------
+// SDF fonts.
+
+// Glyphs are rasterized at this height, and stretch to any other size from there.
+#define CUTE_FONT_SDF_HEIGHT 32.0f
+#define CUTE_FONT_SDF_PADDING 4
+#define CUTE_FONT_SDF_ONEDGE 128
+#define CUTE_FONT_SDF_ATLAS_W 1024
+#define CUTE_FONT_SDF_ATLAS_MIN_H 128
+#define CUTE_FONT_SDF_ATLAS_MAX_H 8192
+
+struct font_sdf_glyph_t
+{
+	int code;
+	int glyph;      // Glyph index within the ttf.
+	int x, y, w, h; // Rect in the atlas, in pixels.
+};
+
+struct font_sdf_job_t
+{
+	font_sdf_t* sdf = NULL;
+	array<font_sdf_glyph_t> glyphs;
+	array<uint8_t> pixels; // Distance fields of `glyphs`, back to back.
+	atomic_int_t done = atomic_zero();
+};
+
+struct font_sdf_t
+{
+	cute_font_t* font = NULL;
+	void* ttf_data = NULL;
+	stbtt_fontinfo info;
+	float scale = 0;
+	int ascent = 0;
+	int glyph_capacity = 0;
+
+	// Single channel atlas, only grows taller so glyphs never move once placed.
+	array<uint8_t> atlas;
+	int atlas_h = 0;
+	int pen_x = 0;
+	int pen_y = 0;
+	int row_h = 0;
+
+	array<font_sdf_glyph_t> pending; // Placed in the atlas, waiting for a job.
+	array<font_sdf_glyph_t> baked;   // Rasterized into `atlas`.
+	array<font_sdf_job_t*> jobs;
+
+	// The atlas image is dynamic, and only remade when the atlas grows taller.
+	int image_h = 0;
+	bool image_dirty = true;
+	uint64_t image_upload_frame = ~0ULL;
+};
+
+static font_sdf_t* s_find_sdf(const font_t* font)
+{
+	font_sdf_t** sdf = app->font_sdfs.find((uint64_t)(uintptr_t)font);
+	return sdf ? *sdf : NULL;
+}
+
+static bool s_find_code(cute_font_t* font, int code, int* index)
+{
+	int lo = 0;
+	int hi = font->glyph_count;
+	while (lo < hi) {
+		int guess = (lo + hi) / 2;
+		if (font->codes[guess] < code) lo = guess + 1;
+		else hi = guess;
+	}
+	*index = lo;
+	return lo < font->glyph_count && font->codes[lo] == code;
+}
+
+static bool s_sdf_place(font_sdf_t* sdf, int w, int h, int* x, int* y)
+{
+	// Simple shelf packing, with a one pixel gap so linear filtering never bleeds between glyphs.
+	if (w + 1 > CUTE_FONT_SDF_ATLAS_W) return false;
+	if (sdf->pen_x + w + 1 > CUTE_FONT_SDF_ATLAS_W) {
+		sdf->pen_x = 0;
+		sdf->pen_y += sdf->row_h + 1;
+		sdf->row_h = 0;
+	}
+
+	int atlas_h = sdf->atlas_h;
+	while (sdf->pen_y + h + 1 > atlas_h) {
+		atlas_h *= 2;
+		if (atlas_h > CUTE_FONT_SDF_ATLAS_MAX_H) return false;
+	}
+	if (atlas_h != sdf->atlas_h) {
+		int old_count = sdf->atlas.count();
+		sdf->atlas.ensure_count(CUTE_FONT_SDF_ATLAS_W * atlas_h);
+		CUTE_MEMSET(sdf->atlas.data() + old_count, 0, sdf->atlas.count() - old_count);
+		sdf->atlas_h = atlas_h;
+	}
+
+	*x = sdf->pen_x;
+	*y = sdf->pen_y;
+	sdf->pen_x += w + 1;
+	sdf->row_h = max(sdf->row_h, h);
+	return true;
+}
+
+static void s_sdf_add_glyph(font_sdf_t* sdf, int code)
+{
+	cute_font_t* font = sdf->font;
+	int index;
+	if (s_find_code(font, code, &index)) return;
+
+	if (font->glyph_count == sdf->glyph_capacity) {
+		int capacity = max(sdf->glyph_capacity * 2, 256);
+		cute_font_glyph_t* glyphs = (cute_font_glyph_t*)CUTE_ALLOC(sizeof(cute_font_glyph_t) * capacity, font->mem_ctx);
+		int* codes = (int*)CUTE_ALLOC(sizeof(int) * capacity, font->mem_ctx);
+		if (font->glyph_count) {
+			CUTE_MEMCPY(glyphs, font->glyphs, sizeof(cute_font_glyph_t) * font->glyph_count);
+			CUTE_MEMCPY(codes, font->codes, sizeof(int) * font->glyph_count);
+		}
+		CUTE_FREE(font->glyphs, font->mem_ctx);
+		CUTE_FREE(font->codes, font->mem_ctx);
+		font->glyphs = glyphs;
+		font->codes = codes;
+		sdf->glyph_capacity = capacity;
+	}
+
+	// Keep the codes sorted, `cute_font_get_glyph_index` does a binary search.
+	int move_count = font->glyph_count - index;
+	CUTE_MEMMOVE(font->glyphs + index + 1, font->glyphs + index, sizeof(cute_font_glyph_t) * move_count);
+	CUTE_MEMMOVE(font->codes + index + 1, font->codes + index, sizeof(int) * move_count);
+	font->glyph_count++;
+	font->codes[index] = code;
+
+	// Metrics are cheap and known right away, so layout never waits on a glyph. The glyph stays
+	// zero-sized (invisible) until its distance field is baked into the atlas.
+	int glyph = stbtt_FindGlyphIndex(&sdf->info, code);
+	int advance, left_side_bearing;
+	stbtt_GetGlyphHMetrics(&sdf->info, glyph, &advance, &left_side_bearing);
+	int ix0, iy0, ix1, iy1;
+	stbtt_GetGlyphBitmapBox(&sdf->info, glyph, sdf->scale, sdf->scale, &ix0, &iy0, &ix1, &iy1);
+
+	cute_font_glyph_t* g = font->glyphs + index;
+	CUTE_MEMSET(g, 0, sizeof(*g));
+	g->xadvance = (int)(advance * sdf->scale + 0.5f);
+	g->xoffset = ix0 - CUTE_FONT_SDF_PADDING;
+	g->yoffset = sdf->ascent + iy0 - CUTE_FONT_SDF_PADDING;
+	if (ix0 == ix1 || iy0 == iy1) return; // Whitespace.
+
+	font_sdf_glyph_t sdf_glyph;
+	sdf_glyph.code = code;
+	sdf_glyph.glyph = glyph;
+	sdf_glyph.w = ix1 - ix0 + CUTE_FONT_SDF_PADDING * 2;
+	sdf_glyph.h = iy1 - iy0 + CUTE_FONT_SDF_PADDING * 2;
+	if (!s_sdf_place(sdf, sdf_glyph.w, sdf_glyph.h, &sdf_glyph.x, &sdf_glyph.y)) {
+		// Out of atlas space, the glyph still takes up room in the text but is never drawn.
+		return;
+	}
+	sdf->pending.add(sdf_glyph);
+}
+
+static void s_sdf_add_text(font_sdf_t* sdf, const char* text)
+{
+	while (*text) {
+		int cp;
+		text = cute_font_decode_utf8(text, &cp);
+		if (cp == '\n' || cp == '\r') continue;
+		s_sdf_add_glyph(sdf, cp);
+	}
+}
+
+static void s_sdf_run_job(void* udata)
+{
+	font_sdf_job_t* job = (font_sdf_job_t*)udata;
+	font_sdf_t* sdf = job->sdf;
+	uint8_t* pixels = job->pixels.data();
+	float pixel_dist_scale = (float)CUTE_FONT_SDF_ONEDGE / (float)CUTE_FONT_SDF_PADDING;
+
+	for (int i = 0; i < job->glyphs.count(); ++i) {
+		font_sdf_glyph_t g = job->glyphs[i];
+		int w, h, xoff, yoff;
+		unsigned char* sdf_pixels = stbtt_GetGlyphSDF(&sdf->info, sdf->scale, g.glyph, CUTE_FONT_SDF_PADDING, CUTE_FONT_SDF_ONEDGE, pixel_dist_scale, &w, &h, &xoff, &yoff);
+		if (sdf_pixels) {
+			CUTE_ASSERT(w == g.w && h == g.h);
+			CUTE_MEMCPY(pixels, sdf_pixels, g.w * g.h);
+			stbtt_FreeSDF(sdf_pixels, sdf->info.userdata);
+		} else {
+			CUTE_MEMSET(pixels, 0, g.w * g.h);
+		}
+		pixels += g.w * g.h;
+	}
+
+	atomic_set(&job->done, 1);
+}
+
+static void s_sdf_kick(font_sdf_t* sdf)
+{
+	if (!sdf->pending.count()) return;
+
+	font_sdf_job_t* job = CUTE_NEW(font_sdf_job_t, app->mem_ctx);
+	job->sdf = sdf;
+	int pixel_count = 0;
+	for (int i = 0; i < sdf->pending.count(); ++i) {
+		job->glyphs.add(sdf->pending[i]);
+		pixel_count += sdf->pending[i].w * sdf->pending[i].h;
+	}
+	job->pixels.ensure_count(pixel_count);
+	sdf->pending.clear();
+	sdf->jobs.add(job);
+
+	if (app->threadpool) {
+		threadpool_add_task(app->threadpool, s_sdf_run_job, job);
+		threadpool_kick(app->threadpool);
+	} else {
+		s_sdf_run_job(job);
+	}
+}
+
+static void s_free_layout(font_layout_t* layout, void* udata = NULL)
+{
+	layout->~font_layout_t();
+	CUTE_FREE(layout, app->mem_ctx);
+}
+
+static void s_drop_layouts(const font_t* font)
+{
+	for (int i = app->font_layouts.count() - 1; i >= 0; --i) {
+		font_layout_t* layout = app->font_layouts.items()[i];
+		if (layout->font == font) {
+			uint64_t key = app->font_layouts.keys()[i];
+			s_free_layout(layout);
+			app->font_layouts.remove(key);
+		}
+	}
+}
+
+static void s_sdf_make_image(font_sdf_t* sdf)
+{
+	cute_font_t* font = sdf->font;
+	if (font->atlas_id) texture_destroy(font->atlas_id);
+
+	sg_image_desc desc = { 0 };
+	desc.width = CUTE_FONT_SDF_ATLAS_W;
+	desc.height = sdf->atlas_h;
+	desc.usage = SG_USAGE_DYNAMIC;
+	desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+	desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+	desc.min_filter = SG_FILTER_LINEAR;
+	desc.mag_filter = SG_FILTER_LINEAR;
+	desc.num_mipmaps = 0;
+	desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+	font->atlas_id = sg_make_image(desc).id;
+	sdf->image_h = sdf->atlas_h;
+}
+
+static void s_sdf_upload(font_sdf_t* sdf)
+{
+	// Dynamic images can only be updated once per frame (`font_layout_updates` advances once per frame, in
+	// `font_update`). Glyphs baked after that go out with the next frame, unless the image is remade anyway.
+	if (!sdf->image_dirty) return;
+	bool remake = sdf->image_h != sdf->atlas_h;
+	if (!remake && sdf->image_upload_frame == app->font_layout_updates) return;
+	if (remake) s_sdf_make_image(sdf);
+
+	// SDF fonts are drawn with the regular font shader until font_shader.h is regenerated with `sdf_fs`
+	// from font.glsl. So the distances are turned into coverage here, ramping over one texel around the
+	// edge, which looks right near `CUTE_FONT_SDF_HEIGHT` and softens as the text is scaled far from it.
+	int pixel_count = CUTE_FONT_SDF_ATLAS_W * sdf->atlas_h;
+	float distance_per_texel = (float)CUTE_FONT_SDF_ONEDGE / (float)CUTE_FONT_SDF_PADDING;
+	array<pixel_t> rgba;
+	rgba.ensure_count(pixel_count);
+	for (int i = 0; i < pixel_count; ++i) {
+		float coverage = clamp01(((float)sdf->atlas[i] - (float)CUTE_FONT_SDF_ONEDGE) / distance_per_texel + 0.5f);
+		rgba[i].colors.r = 255;
+		rgba[i].colors.g = 255;
+		rgba[i].colors.b = 255;
+		rgba[i].colors.a = (uint8_t)(coverage * 255.0f + 0.5f);
+	}
+	sg_image_data data = { 0 };
+	data.subimage[0][0].ptr = rgba.data();
+	data.subimage[0][0].size = pixel_count * sizeof(pixel_t);
+	sg_image image;
+	image.id = (uint32_t)sdf->font->atlas_id;
+	sg_update_image(image, &data);
+	sdf->image_dirty = false;
+	sdf->image_upload_frame = app->font_layout_updates;
+}
+
+static void s_sdf_update_uvs(font_sdf_t* sdf)
+{
+	cute_font_t* font = sdf->font;
+	font->atlas_w = CUTE_FONT_SDF_ATLAS_W;
+	font->atlas_h = sdf->atlas_h;
+
+	// The atlas may have grown taller since last time, so all UVs are recomputed.
+	float w0 = 1.0f / (float)font->atlas_w;
+	float h0 = 1.0f / (float)font->atlas_h;
+	for (int i = 0; i < sdf->baked.count(); ++i) {
+		font_sdf_glyph_t sdf_glyph = sdf->baked[i];
+		int index;
+		bool found = s_find_code(font, sdf_glyph.code, &index);
+		CUTE_ASSERT(found);
+		cute_font_glyph_t* g = font->glyphs + index;
+		g->w = (float)sdf_glyph.w;
+		g->h = (float)sdf_glyph.h;
+		g->minx = (float)sdf_glyph.x * w0;
+		g->miny = (float)sdf_glyph.y * h0;
+		g->maxx = (float)(sdf_glyph.x + sdf_glyph.w) * w0;
+		g->maxy = (float)(sdf_glyph.y + sdf_glyph.h) * h0;
+	}
+
+	// Cached layouts of this font still point at the old UVs, or at invisible glyphs.
+	s_drop_layouts((const font_t*)font);
+}
+
+static void s_sdf_finish_jobs(font_sdf_t* sdf, bool wait)
+{
+	if (wait && sdf->jobs.count() && app->threadpool) {
+		threadpool_kick_and_wait(app->threadpool);
+	}
+
+	bool any_finished = false;
+	int i = 0;
+	while (i < sdf->jobs.count()) {
+		font_sdf_job_t* job = sdf->jobs[i];
+		if (!atomic_get(&job->done)) {
+			CUTE_ASSERT(!wait);
+			++i;
+			continue;
+		}
+
+		const uint8_t* pixels = job->pixels.data();
+		for (int j = 0; j < job->glyphs.count(); ++j) {
+			font_sdf_glyph_t g = job->glyphs[j];
+			for (int y = 0; y < g.h; ++y) {
+				CUTE_MEMCPY(sdf->atlas.data() + (g.y + y) * CUTE_FONT_SDF_ATLAS_W + g.x, pixels + y * g.w, g.w);
+			}
+			pixels += g.w * g.h;
+			sdf->baked.add(g);
+		}
+
+		job->~font_sdf_job_t();
+		CUTE_FREE(job, app->mem_ctx);
+		sdf->jobs.remove(i);
+		any_finished = true;
+	}
+
+	if (any_finished) {
+		s_sdf_update_uvs(sdf);
+		sdf->image_dirty = true;
+		s_sdf_upload(sdf);
+	}
+}
+
+static font_t* s_load_sdf(void* ttf_data)
+{
+	font_sdf_t* sdf = CUTE_NEW(font_sdf_t, app->mem_ctx);
+	sdf->ttf_data = ttf_data;
+	const unsigned char* data = (const unsigned char*)ttf_data;
+	int offset = stbtt_GetFontOffsetForIndex(data, 0);
+	if (offset < 0 || !stbtt_InitFont(&sdf->info, data, offset)) {
+		CUTE_FREE(ttf_data, app->mem_ctx);
+		sdf->~font_sdf_t();
+		CUTE_FREE(sdf, app->mem_ctx);
+		return NULL;
+	}
+	sdf->info.userdata = app->mem_ctx;
+	sdf->scale = stbtt_ScaleForPixelHeight(&sdf->info, CUTE_FONT_SDF_HEIGHT);
+	int ascent, descent, line_gap;
+	stbtt_GetFontVMetrics(&sdf->info, &ascent, &descent, &line_gap);
+	sdf->ascent = (int)(ascent * sdf->scale + 0.5f);
+	sdf->atlas_h = CUTE_FONT_SDF_ATLAS_MIN_H;
+	sdf->atlas.ensure_count(CUTE_FONT_SDF_ATLAS_W * sdf->atlas_h);
+	CUTE_MEMSET(sdf->atlas.data(), 0, sdf->atlas.count());
+
+	cute_font_t* font = (cute_font_t*)CUTE_ALLOC(sizeof(cute_font_t), app->mem_ctx);
+	CUTE_MEMSET(font, 0, sizeof(*font));
+	font->mem_ctx = app->mem_ctx;
+	font->font_height = sdf->ascent;
+	font->line_height = (int)((ascent - descent + line_gap) * sdf->scale + 0.5f);
+	sdf->font = font;
+	app->font_sdfs.insert((uint64_t)(uintptr_t)font, sdf);
+
+	// Printable ascii is almost always needed, so get it going right away.
+	for (int c = 32; c < 127; ++c) {
+		s_sdf_add_glyph(sdf, c);
+	}
+	s_sdf_kick(sdf);
+	s_sdf_update_uvs(sdf);
+	s_sdf_upload(sdf);
+
+	return (font_t*)font;
+}
+
+font_t* font_load_sdf(const char* ttf_path)
+{
+	void* ttf_data;
+	size_t ttf_size;
+	error_t err = file_system_read_entire_file_to_memory(ttf_path, &ttf_data, &ttf_size, app->mem_ctx);
+	if (err.is_error()) return NULL;
+	return s_load_sdf(ttf_data);
+}
+
+font_t* font_load_sdf_mem(const void* ttf_data, int size)
+{
+	void* data = CUTE_ALLOC(size, app->mem_ctx);
+	CUTE_MEMCPY(data, ttf_data, size);
+	return s_load_sdf(data);
+}
+
+bool font_is_sdf(const font_t* font)
+{
+	return s_find_sdf(font) ? true : false;
+}
+
+void font_sdf_preload(const font_t* font, const char* text)
+{
+	font_sdf_t* sdf = s_find_sdf(font);
+	if (!sdf) return;
+	s_sdf_add_text(sdf, text);
+	s_sdf_kick(sdf);
+	s_sdf_finish_jobs(sdf, true);
+}
+
 void font_free(font_t* font)
 {
+	s_drop_layouts(font);
+	font_sdf_t* sdf = s_find_sdf(font);
+	if (sdf) {
+		s_sdf_finish_jobs(sdf, true);
+		texture_destroy(sdf->font->atlas_id);
+		app->font_sdfs.remove((uint64_t)(uintptr_t)font);
+		CUTE_FREE(sdf->ttf_data, app->mem_ctx);
+		sdf->~font_sdf_t();
+		CUTE_FREE(sdf, app->mem_ctx);
+	}
 	cute_font_free((cute_font_t*)font);
 }
 
@@ -117,12 +554,10 @@ const font_t* font_get_default()
 	return (font_t*)app->courier_new;
 }
 
-void font_push_verts(const font_t* font, const char* text, float x, float y, float wrap_w, const aabb_t* clip_box)
+static void s_fill_verts(cute_font_t* font, const char* text, float x, float y, float wrap_w, const aabb_t* clip_box, array<font_vertex_t>* verts)
 {
 	int vert_count = 0;
-	cute_font_t* cute_font = (cute_font_t*)font;
-	array<font_vertex_t>& font_verts = app->font_verts;
-	font_verts.ensure_capacity(256);
+	verts->ensure_capacity(256);
 
 	while (1)
 	{
@@ -134,17 +569,100 @@ void font_push_verts(const font_t* font, const char* text, float x, float y, flo
 			clip_rect.bottom = clip_box->min.y;
 		}
 		cute_font_rect_t* clip_rect_ptr = clip_box ? &clip_rect : NULL;
-		font_vertex_t* verts_ptr = font_verts.data() + font_verts.count();
-		int no_overflow = cute_font_fill_vertex_buffer(cute_font, text, x, y, wrap_w, 0, clip_rect_ptr, verts_ptr, font_verts.capacity() - font_verts.count(), &vert_count);
+		font_vertex_t* verts_ptr = verts->data() + verts->count();
+		int no_overflow = cute_font_fill_vertex_buffer(font, text, x, y, wrap_w, 0, clip_rect_ptr, verts_ptr, verts->capacity() - verts->count(), &vert_count);
 
 		if (no_overflow) {
 			break;
 		} else {
-			font_verts.ensure_capacity(font_verts.capacity() * 2);
+			verts->ensure_capacity(verts->capacity() * 2);
 		}
 	}
 
-	font_verts.set_count(font_verts.count() + vert_count);
+	verts->set_count(verts->count() + vert_count);
+}
+
+static font_layout_t* s_find_layout(uint64_t key, const font_t* font, const char* text, int text_len, float wrap_w, const aabb_t* clip_box)
+{
+	font_layout_t** layout_ptr = app->font_layouts.find(key);
+	if (!layout_ptr) return NULL;
+	font_layout_t* layout = *layout_ptr;
+
+	// The hash only narrows the search, the full key has to match too.
+	if (layout->font != font) return NULL;
+	if (layout->text.count() != text_len || CUTE_MEMCMP(layout->text.data(), text, text_len)) return NULL;
+	if (layout->wrap_w != wrap_w) return NULL;
+	if (layout->clipped != !!clip_box) return NULL;
+	if (clip_box && CUTE_MEMCMP(&layout->clip_box, clip_box, sizeof(aabb_t))) return NULL;
+	return layout;
+}
+
+void font_push_verts(const font_t* font, const char* text, float x, float y, float wrap_w, const aabb_t* clip_box)
+{
+	cute_font_t* cute_font = (cute_font_t*)font;
+	array<font_vertex_t>& font_verts = app->font_verts;
+
+	font_sdf_t* sdf = s_find_sdf(font);
+
+	if (!app->font_use_layout_cache) {
+		if (sdf) s_sdf_add_text(sdf, text);
+		s_fill_verts(cute_font, text, x, y, wrap_w, clip_box, &font_verts);
+		return;
+	}
+
+	// Layouts are stored relative to the origin, so the same text can be replayed anywhere on screen.
+	// The clip box is brought into the same space, as it moves along with the text.
+	aabb_t local_clip_box;
+	if (clip_box) {
+		local_clip_box = make_aabb(clip_box->min - v2(x, y), clip_box->max - v2(x, y));
+	}
+	const aabb_t* local_clip_box_ptr = clip_box ? &local_clip_box : NULL;
+
+	int text_len = (int)CUTE_STRLEN(text);
+	uint64_t key = fnv1a(CUTE_FNV1A_OFFSET_BASIS, &font, sizeof(font));
+	key = fnv1a(key, text, text_len);
+	key = fnv1a(key, &wrap_w, sizeof(wrap_w));
+	uint8_t clipped = clip_box ? 1 : 0;
+	key = fnv1a(key, &clipped, sizeof(clipped));
+	if (clip_box) key = fnv1a(key, &local_clip_box, sizeof(local_clip_box));
+
+	font_layout_t* layout = s_find_layout(key, font, text, text_len, wrap_w, local_clip_box_ptr);
+	if (layout) {
+		app->font_layout_hits++;
+	} else {
+		app->font_layout_misses++;
+		if (sdf) s_sdf_add_text(sdf, text);
+		font_layout_t** old_layout = app->font_layouts.find(key);
+		if (old_layout) {
+			// Hash collision, the newest layout wins.
+			layout = *old_layout;
+			layout->text.clear();
+			layout->verts.clear();
+		} else {
+			layout = CUTE_NEW(font_layout_t, app->mem_ctx);
+			app->font_layouts.insert(key, layout);
+		}
+		layout->font = font;
+		layout->text.ensure_count(text_len);
+		for (int i = 0; i < text_len; ++i) layout->text[i] = text[i];
+		layout->wrap_w = wrap_w;
+		layout->clipped = !!clip_box;
+		if (clip_box) layout->clip_box = local_clip_box;
+		s_fill_verts(cute_font, text, 0, 0, wrap_w, local_clip_box_ptr, &layout->verts);
+	}
+	layout->last_used = app->font_layout_updates;
+
+	int first_vert = font_verts.count();
+	int vert_count = layout->verts.count();
+	font_verts.ensure_count(first_vert + vert_count);
+	font_vertex_t* src = layout->verts.data();
+	font_vertex_t* dst = font_verts.data() + first_vert;
+	for (int i = 0; i < vert_count; ++i) {
+		font_vertex_t v = src[i];
+		v.x += x;
+		v.y += y;
+		dst[i] = v;
+	}
 }
 
 void font_draw(const font_t* font, matrix_t mvp, color_t color)
@@ -152,6 +670,9 @@ void font_draw(const font_t* font, matrix_t mvp, color_t color)
 	error_t err = triple_buffer_append(&app->font_buffer, app->font_verts.count(), app->font_verts.data());
 	CUTE_ASSERT(!err.is_error());
 
+	font_sdf_t* sdf = s_find_sdf(font);
+	if (sdf) s_sdf_upload(sdf);
+
 	sg_apply_pipeline(app->font_pip);
 	sg_bindings bind = app->font_buffer.bind();
 	bind.fs_images[0].id = (uint32_t)((cute_font_t*)font)->atlas_id;
@@ -195,6 +716,31 @@ void font_border_use_corners(bool use_corners)
 	app->font_fs_uniforms.u_use_corners = use_corners ? 1.0f : 0.0f;
 }
 
+void font_layout_cache(bool use_cache)
+{
+	if (!use_cache) {
+		for (int i = 0; i < app->font_layouts.count(); ++i) {
+			s_free_layout(app->font_layouts.items()[i]);
+		}
+		app->font_layouts.clear();
+	}
+	app->font_use_layout_cache = use_cache;
+}
+
+bool font_is_layout_cache_on()
+{
+	return app->font_use_layout_cache;
+}
+
+font_layout_cache_stats_t font_get_layout_cache_stats()
+{
+	font_layout_cache_stats_t stats;
+	stats.hits = app->font_layout_hits;
+	stats.misses = app->font_layout_misses;
+	stats.layout_count = app->font_layouts.count();
+	return stats;
+}
+
 int font_height(const font_t* font)
 {
 	return ((cute_font_t*)font)->font_height;
@@ -207,22 +753,41 @@ int font_line_height(const font_t* font)
 
 int font_text_width(const font_t* font, const char* text)
 {
+	font_sdf_t* sdf = s_find_sdf(font);
+	if (sdf) s_sdf_add_text(sdf, text);
 	return cute_font_text_width((cute_font_t*)font, text);
 }
 
 int font_text_height(const font_t* font, const char* text)
 {
+	font_sdf_t* sdf = s_find_sdf(font);
+	if (sdf) s_sdf_add_text(sdf, text);
 	return cute_font_text_height((cute_font_t*)font, text);
 }
 
 // -------------------------------------------------------------------------------------------------
 // Internal.
 
+void font_update()
+{
+	// Drop layouts nobody drew since the last update. This also starts the next frame for `s_sdf_upload`.
+	frame_cache_evict_unused(&app->font_layouts, &app->font_layout_updates, s_free_layout, NULL);
+
+	// Hand glyphs first seen this frame over to the threadpool, and swap in the ones that are done.
+	// Atlases left dirty last frame are uploaded now.
+	for (int i = 0; i < app->font_sdfs.count(); ++i) {
+		font_sdf_t* sdf = app->font_sdfs.items()[i];
+		s_sdf_kick(sdf);
+		s_sdf_finish_jobs(sdf, false);
+		s_sdf_upload(sdf);
+	}
+}
+
 void font_init()
 {
 	s_load_courier_new();
 
-	app->font_shader = sg_make_shader(font_shd_shader_desc(sg_query_backend()));
+	app->font_shader = sg_make_shader(font_shd_shader_desc(app_shader_backend()));
 
 	sg_pipeline_desc pip_params = { 0 };
 	pip_params.layout.buffers[0].stride = sizeof(font_vertex_t);
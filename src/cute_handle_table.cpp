@@ -77,6 +77,7 @@ handle_allocator_t* handle_allocator_make(int initial_capacity, void* user_alloc
 
 	if (initial_capacity) {
 		table->m_handles.ensure_capacity(initial_capacity);
+		table->m_handles.ensure_count(table->m_handles.capacity());
 		int last_index = table->m_handles.capacity() - 1;
 		s_add_elements_to_freelist(table, 0, last_index);
 	}
@@ -96,9 +97,10 @@ handle_t handle_allocator_alloc(handle_allocator_t* table, uint32_t index)
 {
 	int freelist_index = table->m_freelist;
 	if (freelist_index == UINT32_MAX) {
-		int first_index = table->m_handles.capacity();
+		int first_index = table->m_handles.count();
 		if (!first_index) first_index = 1;
 		table->m_handles.ensure_capacity(first_index * 2);
+		table->m_handles.ensure_count(table->m_handles.capacity()); // So growing the array again copies all handles over.
 		int last_index = table->m_handles.capacity() - 1;
 		s_add_elements_to_freelist(table, first_index, last_index);
 		freelist_index = table->m_freelist;
@@ -152,8 +154,92 @@ int handle_allocator_is_handle_valid(handle_allocator_t* table, handle_t handle)
 	handle_entry_t* m_handles = table->m_handles.data();
 	uint32_t table_index = s_table_index(handle);
 	uint64_t generation = handle & 0xFFFFFFFF;
-	if (m_handles && table_index < (uint32_t)table->m_handles.size()) return 0;
+	if (!m_handles || table_index >= (uint32_t)table->m_handles.size()) return 0;
 	return m_handles[table_index].data.generation == generation;
 }
 
+size_t handle_allocator_state_size(handle_allocator_t* table)
+{
+	return sizeof(uint32_t) * 2 + sizeof(handle_entry_t) * table->m_handles.count();
+}
+
+void handle_allocator_get_state(handle_allocator_t* table, void* buffer)
+{
+	uint32_t* header = (uint32_t*)buffer;
+	header[0] = table->m_freelist;
+	header[1] = (uint32_t)table->m_handles.count();
+	CUTE_MEMCPY(header + 2, table->m_handles.data(), sizeof(handle_entry_t) * table->m_handles.count());
+}
+
+static CUTE_INLINE handle_entry_t s_read_entry(const void* entries, uint32_t index)
+{
+	// The state buffer may not be aligned.
+	handle_entry_t entry;
+	CUTE_MEMCPY(&entry.val, (const uint8_t*)entries + sizeof(uint64_t) * index, sizeof(entry.val));
+	return entry;
+}
+
+int handle_allocator_is_state_valid(const void* buffer, size_t size, const handle_t* handles, int handle_count)
+{
+	if (!buffer || size < sizeof(uint32_t) * 2) return 0;
+	uint32_t header[2];
+	CUTE_MEMCPY(header, buffer, sizeof(header));
+	uint32_t freelist = header[0];
+	uint32_t count = header[1];
+	if ((size - sizeof(uint32_t) * 2) / sizeof(handle_entry_t) != count || (size - sizeof(uint32_t) * 2) % sizeof(handle_entry_t)) return 0;
+	const uint32_t* entries = (const uint32_t*)buffer + 2;
+
+	// The free list must stay in bounds and end.
+	uint32_t index = freelist;
+	uint32_t free_count = 0;
+	while (index != UINT32_MAX) {
+		if (index >= count || free_count++ >= count) return 0;
+		index = s_read_entry(entries, index).data.user_index;
+	}
+
+	for (int i = 0; i < handle_count; ++i) {
+		handle_t handle;
+		CUTE_MEMCPY(&handle, handles + i, sizeof(handle));
+		uint32_t table_index = s_table_index(handle);
+		if (table_index >= count) return 0;
+		handle_entry_t entry = s_read_entry(entries, table_index);
+		if (entry.data.generation != (handle & 0xFFFFFFFF) || entry.data.user_index != (uint32_t)i) return 0;
+	}
+
+	return 1;
+}
+
+int handle_allocator_set_state(handle_allocator_t* table, const void* buffer, size_t size)
+{
+	if (!handle_allocator_is_state_valid(buffer, size)) return 0;
+	uint32_t header[2];
+	CUTE_MEMCPY(header, buffer, sizeof(header));
+	uint32_t freelist = header[0];
+	int count = (int)header[1];
+	const uint32_t* entries = (const uint32_t*)buffer + 2;
+
+	array<handle_entry_t> handles(table->m_mem_ctx);
+	handles.ensure_count(count);
+	for (int i = 0; i < count; ++i) {
+		handles[i] = s_read_entry(entries, (uint32_t)i);
+	}
+
+	// Move the generation of each free handle past its current generation, invalidating any handles
+	// allocated since the state was copied out with `handle_allocator_get_state`.
+	uint32_t index = freelist;
+	while (index != UINT32_MAX) {
+		uint32_t generation = (uint32_t)handles[index].data.generation;
+		if (index < (uint32_t)table->m_handles.count()) {
+			uint32_t current_generation = (uint32_t)table->m_handles[index].data.generation;
+			if (current_generation > generation) generation = current_generation;
+		}
+		handles[index].data.generation = generation + 1;
+		index = handles[index].data.user_index;
+	}
+
+	table->m_handles.steal_from(&handles);
+	table->m_freelist = freelist;
+	return 1;
+}
+
 }
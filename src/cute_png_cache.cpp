@@ -35,18 +35,21 @@ static void s_get_pixels(uint64_t image_id, void* buffer, int bytes_to_fill, voi
 {
 	png_cache_t* cache = (png_cache_t*)udata;
 	void* pixels = NULL;
+	read_lock(&cache->pixels_lock);
 	if (cache->id_to_pixels.find(image_id, &pixels).is_error()) {
 		CUTE_DEBUG_PRINTF("png cache -- unable to find id %lld.", (long long int)image_id);
 		CUTE_MEMSET(buffer, 0, bytes_to_fill);
 	} else {
 		CUTE_MEMCPY(buffer, pixels, bytes_to_fill);
 	}
+	read_unlock(&cache->pixels_lock);
 }
 
 png_cache_t* png_cache_make(void* mem_ctx)
 {
 	png_cache_t* cache = CUTE_NEW(png_cache_t, app->mem_ctx);
 	cache->strpool = make_strpool(mem_ctx);
+	cache->pixels_lock = rw_lock_create();
 	cache->mem_ctx = mem_ctx;
 	return cache;
 }
@@ -73,6 +76,7 @@ void png_cache_destroy(png_cache_t* cache)
 	}
 
 	destroy_strpool(cache->strpool);
+	rw_lock_destroy(&cache->pixels_lock);
 	void* mem_ctx = cache->mem_ctx;
 	cache->~png_cache_t();
 	CUTE_FREE(cache, mem_ctx);
@@ -89,7 +93,9 @@ error_t png_cache_load(png_cache_t* cache, const char* png_path, png_t* png)
 	entry.pix = img.pix;
 	entry.w = img.w;
 	entry.h = img.h;
+	write_lock(&cache->pixels_lock);
 	cache->id_to_pixels.insert(entry.id, img.pix);
+	write_unlock(&cache->pixels_lock);
 	cache->pngs.insert(entry.id, entry);
 	if (png) *png = entry;
 	return error_success();
@@ -106,7 +112,9 @@ error_t png_cache_load_mem(png_cache_t* cache, const char* png_path, const void*
 	entry.pix = img.pix;
 	entry.w = img.w;
 	entry.h = img.h;
+	write_lock(&cache->pixels_lock);
 	cache->id_to_pixels.insert(entry.id, img.pix);
+	write_unlock(&cache->pixels_lock);
 	cache->pngs.insert(entry.id, entry);
 	if (png) *png = entry;
 	return error_success();
@@ -118,8 +126,10 @@ void png_cache_unload(png_cache_t* cache, png_t* png)
 	img.pix = png->pix;
 	img.w = png->w;
 	img.h = png->h;
-	image_free(&img);
+	write_lock(&cache->pixels_lock);
 	cache->id_to_pixels.remove(png->id);
+	write_unlock(&cache->pixels_lock);
+	image_free(&img);
 	cache->pngs.remove(png->id);
 	CUTE_MEMSET(png, 0, sizeof(*png));
 }
@@ -0,0 +1,512 @@
+/*
+	Cute Framework
+	Copyright (C) 2021 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute_render_graph.h>
+#include <cute_array.h>
+#include <cute_alloc.h>
+#include <cute_c_runtime.h>
+#include <cute_strpool.h>
+
+#include <internal/cute_app_internal.h>
+
+#define INJECT(s) strpool_inject(graph->names, s, (int)CUTE_STRLEN(s))
+
+namespace cute
+{
+
+struct render_graph_texture_info_t
+{
+	strpool_id name = { 0 };
+	int w = 0;
+	int h = 0;
+	sg_pixel_format format = SG_PIXELFORMAT_NONE;
+	bool imported = false;
+	bool offscreen = false; // Follows the app's offscreen buffer, which is remade on resize.
+	sg_image image = { SG_INVALID_ID };
+	int writer = -1;
+
+	// Lifetime in execution order, valid after a compile.
+	int first_use = -1;
+	int last_use = -1;
+};
+
+struct render_graph_pass_info_t
+{
+	strpool_id name = { 0 };
+	render_graph_pass_fn* fn = NULL;
+	void* udata = NULL;
+	sg_pass_action action;
+	array<int> reads;
+	array<int> writes;
+	bool culled = false;
+	sg_pass pass = { SG_INVALID_ID };
+};
+
+struct render_graph_image_t
+{
+	sg_image image = { SG_INVALID_ID };
+	int w = 0;
+	int h = 0;
+	sg_pixel_format format = SG_PIXELFORMAT_NONE;
+
+	// Execution index of the last pass using this image during the current compile, or -1 if unclaimed.
+	int busy_until = -1;
+};
+
+struct render_graph_t
+{
+	array<render_graph_texture_info_t> textures;
+	array<render_graph_pass_info_t*> passes;
+	array<int> order;
+	array<render_graph_image_t> images;
+	render_graph_texture_t output = -1;
+	bool dirty = true;
+	bool compiled = false;
+	strpool_t* names = NULL; // Texture and pass names, discarded by `render_graph_clear`.
+	void* mem_ctx = NULL;
+};
+
+static bool s_is_depth_format(sg_pixel_format format)
+{
+	return format == SG_PIXELFORMAT_DEPTH || format == SG_PIXELFORMAT_DEPTH_STENCIL;
+}
+
+static void s_destroy_passes(render_graph_t* graph)
+{
+	for (int i = 0; i < graph->passes.count(); ++i) {
+		render_graph_pass_info_t* pass = graph->passes[i];
+		if (pass->pass.id != SG_INVALID_ID) {
+			sg_destroy_pass(pass->pass);
+			pass->pass.id = SG_INVALID_ID;
+		}
+	}
+	graph->order.clear();
+	graph->compiled = false;
+}
+
+static void s_discard_names(render_graph_t* graph)
+{
+	// Textures and passes with the same name share an id, discarding twice is harmless.
+	for (int i = 0; i < graph->textures.count(); ++i) {
+		if (graph->textures[i].name.val) strpool_discard(graph->names, graph->textures[i].name);
+	}
+	for (int i = 0; i < graph->passes.count(); ++i) {
+		if (graph->passes[i]->name.val) strpool_discard(graph->names, graph->passes[i]->name);
+	}
+}
+
+static void s_free_passes(render_graph_t* graph)
+{
+	for (int i = 0; i < graph->passes.count(); ++i) {
+		graph->passes[i]->~render_graph_pass_info_t();
+		CUTE_FREE(graph->passes[i], graph->mem_ctx);
+	}
+	graph->passes.clear();
+}
+
+render_graph_t* render_graph_make(void* user_allocator_context)
+{
+	render_graph_t* graph = CUTE_NEW(render_graph_t, user_allocator_context);
+	graph->names = make_strpool(user_allocator_context);
+	graph->mem_ctx = user_allocator_context;
+	return graph;
+}
+
+void render_graph_destroy(render_graph_t* graph)
+{
+	if (app->render_graph == graph) app->render_graph = NULL;
+	s_destroy_passes(graph);
+	for (int i = 0; i < graph->images.count(); ++i) {
+		sg_destroy_image(graph->images[i].image);
+	}
+	s_free_passes(graph);
+	destroy_strpool(graph->names);
+	graph->~render_graph_t();
+	CUTE_FREE(graph, graph->mem_ctx);
+}
+
+void render_graph_clear(render_graph_t* graph)
+{
+	s_destroy_passes(graph);
+	s_discard_names(graph);
+	graph->textures.clear();
+	s_free_passes(graph);
+	graph->output = -1;
+	graph->dirty = true;
+}
+
+static render_graph_texture_t s_add_texture(render_graph_t* graph, const char* name, int w, int h, sg_pixel_format format, bool imported, sg_image image)
+{
+	render_graph_texture_info_t* texture = &graph->textures.add();
+	if (name) texture->name = INJECT(name);
+	texture->w = w;
+	texture->h = h;
+	texture->format = format;
+	texture->imported = imported;
+	texture->image = image;
+	graph->dirty = true;
+	return graph->textures.count() - 1;
+}
+
+render_graph_texture_t render_graph_import_texture(render_graph_t* graph, const char* name, sg_image image, int w, int h)
+{
+	return s_add_texture(graph, name, w, h, SG_PIXELFORMAT_NONE, true, image);
+}
+
+render_graph_texture_t render_graph_import_offscreen_buffer(render_graph_t* graph)
+{
+	CUTE_ASSERT(app->offscreen_enabled);
+	render_graph_texture_t texture = render_graph_import_texture(graph, "offscreen", app->offscreen_color_buffer, app->offscreen_w, app->offscreen_h);
+	graph->textures[texture].offscreen = true;
+	return texture;
+}
+
+static void s_sync_offscreen_textures(render_graph_t* graph)
+{
+	// The offscreen buffer is remade whenever it is resized, so look it up again rather than keeping the
+	// old image around. Passes writing it have to be remade too, so the graph recompiles.
+	for (int i = 0; i < graph->textures.count(); ++i) {
+		render_graph_texture_info_t* texture = graph->textures + i;
+		if (!texture->offscreen) continue;
+		if (texture->image.id == app->offscreen_color_buffer.id && texture->w == app->offscreen_w && texture->h == app->offscreen_h) continue;
+		texture->image = app->offscreen_color_buffer;
+		texture->w = app->offscreen_w;
+		texture->h = app->offscreen_h;
+		graph->dirty = true;
+	}
+}
+
+render_graph_texture_t render_graph_create_texture(render_graph_t* graph, const char* name, int w, int h, sg_pixel_format format)
+{
+	if (format == SG_PIXELFORMAT_NONE) format = app->gfx_ctx_params.color_format;
+	return s_add_texture(graph, name, w, h, format, false, { SG_INVALID_ID });
+}
+
+render_graph_pass_t render_graph_add_pass(render_graph_t* graph, const char* name, render_graph_pass_fn* fn, void* udata, const sg_pass_action* action)
+{
+	render_graph_pass_info_t* pass = CUTE_NEW(render_graph_pass_info_t, graph->mem_ctx);
+	graph->passes.add(pass);
+	if (name) pass->name = INJECT(name);
+	pass->fn = fn;
+	pass->udata = udata;
+	if (action) {
+		pass->action = *action;
+	} else {
+		CUTE_MEMSET(&pass->action, 0, sizeof(pass->action));
+		for (int i = 0; i < SG_MAX_COLOR_ATTACHMENTS; ++i) {
+			pass->action.colors[i] = { SG_ACTION_CLEAR, { 0.0f, 0.0f, 0.0f, 0.0f } };
+		}
+		pass->action.depth = { SG_ACTION_CLEAR, 1.0f };
+		pass->action.stencil = { SG_ACTION_CLEAR, 0 };
+	}
+	graph->dirty = true;
+	return graph->passes.count() - 1;
+}
+
+void render_graph_pass_reads(render_graph_t* graph, render_graph_pass_t pass, render_graph_texture_t texture)
+{
+	CUTE_ASSERT(pass >= 0 && pass < graph->passes.count());
+	CUTE_ASSERT(texture >= 0 && texture < graph->textures.count());
+	graph->passes[pass]->reads.add(texture);
+	graph->dirty = true;
+}
+
+void render_graph_pass_writes(render_graph_t* graph, render_graph_pass_t pass, render_graph_texture_t texture)
+{
+	CUTE_ASSERT(pass >= 0 && pass < graph->passes.count());
+	CUTE_ASSERT(texture >= 0 && texture < graph->textures.count());
+	graph->passes[pass]->writes.add(texture);
+	graph->dirty = true;
+}
+
+void render_graph_set_output(render_graph_t* graph, render_graph_texture_t texture)
+{
+	CUTE_ASSERT(texture >= 0 && texture < graph->textures.count());
+	graph->output = texture;
+	graph->dirty = true;
+}
+
+render_graph_texture_t render_graph_get_output(render_graph_t* graph)
+{
+	return graph->output;
+}
+
+static void s_mark_needed(render_graph_t* graph, int pass_index)
+{
+	render_graph_pass_info_t* pass = graph->passes[pass_index];
+	if (!pass->culled) return;
+	pass->culled = false;
+	for (int i = 0; i < pass->reads.count(); ++i) {
+		int writer = graph->textures[pass->reads[i]].writer;
+		if (writer != -1) s_mark_needed(graph, writer);
+	}
+}
+
+static error_t s_sort_passes(render_graph_t* graph)
+{
+	// Kahn's algorithm, always picking the earliest added pass that is ready, so independent
+	// passes keep the order they were added in.
+	int pass_count = graph->passes.count();
+	array<int> waiting_on(graph->mem_ctx);
+	waiting_on.ensure_count(pass_count);
+	int needed_count = 0;
+	for (int i = 0; i < pass_count; ++i) {
+		render_graph_pass_info_t* pass = graph->passes[i];
+		waiting_on[i] = 0;
+		if (pass->culled) continue;
+		++needed_count;
+		for (int j = 0; j < pass->reads.count(); ++j) {
+			int writer = graph->textures[pass->reads[j]].writer;
+			if (writer != -1) waiting_on[i]++;
+		}
+	}
+
+	array<bool> done(graph->mem_ctx);
+	done.ensure_count(pass_count);
+	for (int i = 0; i < pass_count; ++i) done[i] = false;
+
+	while (graph->order.count() < needed_count) {
+		int next = -1;
+		for (int i = 0; i < pass_count; ++i) {
+			if (!graph->passes[i]->culled && !done[i] && !waiting_on[i]) {
+				next = i;
+				break;
+			}
+		}
+		if (next == -1) return error_failure("Render graph passes depend on each other in a cycle.");
+
+		done[next] = true;
+		graph->order.add(next);
+		for (int i = 0; i < pass_count; ++i) {
+			render_graph_pass_info_t* pass = graph->passes[i];
+			if (pass->culled || done[i]) continue;
+			for (int j = 0; j < pass->reads.count(); ++j) {
+				if (graph->textures[pass->reads[j]].writer == next) waiting_on[i]--;
+			}
+		}
+	}
+
+	return error_success();
+}
+
+static error_t s_allocate_images(render_graph_t* graph)
+{
+	for (int i = 0; i < graph->images.count(); ++i) {
+		graph->images[i].busy_until = -1;
+	}
+
+	// Hand out images in order of first use. An image is free for reuse once the last pass touching its
+	// previous texture has run, which is what lets transient textures alias one another.
+	for (int step = 0; step < graph->order.count(); ++step) {
+		render_graph_pass_info_t* pass = graph->passes[graph->order[step]];
+		for (int i = 0; i < pass->writes.count(); ++i) {
+			render_graph_texture_info_t* texture = graph->textures + pass->writes[i];
+			if (texture->imported) continue;
+
+			int found = -1;
+			for (int j = 0; j < graph->images.count(); ++j) {
+				render_graph_image_t* image = graph->images + j;
+				if (image->busy_until >= texture->first_use) continue;
+				if (image->w != texture->w || image->h != texture->h || image->format != texture->format) continue;
+				found = j;
+				break;
+			}
+
+			if (found == -1) {
+				sg_image_desc params = { 0 };
+				params.render_target = true;
+				params.width = texture->w;
+				params.height = texture->h;
+				params.pixel_format = texture->format;
+				params.min_filter = SG_FILTER_NEAREST;
+				params.mag_filter = SG_FILTER_NEAREST;
+				params.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+				params.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+				params.label = strpool_cstr(graph->names, texture->name);
+				render_graph_image_t image;
+				image.image = sg_make_image(params);
+				if (image.image.id == SG_INVALID_ID) return error_failure("Unable to create render graph image.");
+				image.w = texture->w;
+				image.h = texture->h;
+				image.format = texture->format;
+				graph->images.add(image);
+				found = graph->images.count() - 1;
+			}
+
+			graph->images[found].busy_until = texture->last_use;
+			texture->image = graph->images[found].image;
+		}
+	}
+
+	// Drop pooled images this graph no longer needs.
+	for (int i = graph->images.count() - 1; i >= 0; --i) {
+		if (graph->images[i].busy_until != -1) continue;
+		sg_destroy_image(graph->images[i].image);
+		graph->images[i] = graph->images.last();
+		graph->images.pop();
+	}
+
+	return error_success();
+}
+
+static error_t s_make_passes(render_graph_t* graph)
+{
+	for (int step = 0; step < graph->order.count(); ++step) {
+		render_graph_pass_info_t* pass = graph->passes[graph->order[step]];
+		sg_pass_desc params = { 0 };
+		int color_count = 0;
+		for (int i = 0; i < pass->writes.count(); ++i) {
+			render_graph_texture_info_t* texture = graph->textures + pass->writes[i];
+			if (s_is_depth_format(texture->format)) {
+				params.depth_stencil_attachment.image = texture->image;
+			} else {
+				if (color_count == SG_MAX_COLOR_ATTACHMENTS) return error_failure("Render graph pass writes too many color textures.");
+				params.color_attachments[color_count++].image = texture->image;
+			}
+		}
+		params.label = strpool_cstr(graph->names, pass->name);
+		pass->pass = sg_make_pass(params);
+		if (pass->pass.id == SG_INVALID_ID) return error_failure("Unable to create render graph pass.");
+	}
+	return error_success();
+}
+
+error_t render_graph_compile(render_graph_t* graph)
+{
+	s_destroy_passes(graph);
+	graph->dirty = false;
+
+	if (graph->output < 0) return error_failure("Render graph has no output texture.");
+
+	// Find the single writer of each texture.
+	for (int i = 0; i < graph->textures.count(); ++i) {
+		render_graph_texture_info_t* texture = graph->textures + i;
+		texture->writer = -1;
+		texture->first_use = -1;
+		texture->last_use = -1;
+		if (!texture->imported) texture->image.id = SG_INVALID_ID;
+	}
+	for (int i = 0; i < graph->passes.count(); ++i) {
+		render_graph_pass_info_t* pass = graph->passes[i];
+		pass->culled = true;
+		if (!pass->writes.count()) return error_failure("Render graph pass does not write any textures.");
+		render_graph_texture_info_t* first = graph->textures + pass->writes[0];
+		for (int j = 0; j < pass->writes.count(); ++j) {
+			render_graph_texture_info_t* texture = graph->textures + pass->writes[j];
+			if (texture->writer != -1) return error_failure("Render graph texture is written by more than one pass.");
+			if (texture->w != first->w || texture->h != first->h) return error_failure("Render graph pass writes textures of different sizes.");
+			texture->writer = i;
+		}
+		for (int j = 0; j < pass->reads.count(); ++j) {
+			if (graph->textures[pass->reads[j]].writer == i) return error_failure("Render graph pass reads a texture it also writes.");
+		}
+	}
+
+	// Cull everything not contributing to the output or to an imported texture.
+	render_graph_texture_info_t* output = graph->textures + graph->output;
+	if (output->writer == -1 && !output->imported) return error_failure("Render graph output is never written.");
+	if (output->writer != -1) s_mark_needed(graph, output->writer);
+	for (int i = 0; i < graph->textures.count(); ++i) {
+		render_graph_texture_info_t* texture = graph->textures + i;
+		if (texture->imported && texture->writer != -1) s_mark_needed(graph, texture->writer);
+	}
+
+	for (int i = 0; i < graph->passes.count(); ++i) {
+		render_graph_pass_info_t* pass = graph->passes[i];
+		if (pass->culled) continue;
+		for (int j = 0; j < pass->reads.count(); ++j) {
+			render_graph_texture_info_t* texture = graph->textures + pass->reads[j];
+			if (!texture->imported && texture->writer == -1) return error_failure("Render graph texture is read but never written.");
+		}
+	}
+
+	error_t err = s_sort_passes(graph);
+	if (err.is_error()) {
+		graph->order.clear();
+		return err;
+	}
+
+	// Lifetimes span from the writing pass to the last pass reading, in execution order.
+	for (int step = 0; step < graph->order.count(); ++step) {
+		render_graph_pass_info_t* pass = graph->passes[graph->order[step]];
+		for (int i = 0; i < pass->writes.count(); ++i) {
+			render_graph_texture_info_t* texture = graph->textures + pass->writes[i];
+			texture->first_use = step;
+			texture->last_use = step;
+		}
+		for (int i = 0; i < pass->reads.count(); ++i) {
+			graph->textures[pass->reads[i]].last_use = step;
+		}
+	}
+	output->last_use = graph->order.count();
+
+	err = s_allocate_images(graph);
+	if (!err.is_error()) err = s_make_passes(graph);
+	if (err.is_error()) {
+		s_destroy_passes(graph);
+		return err;
+	}
+
+	graph->compiled = true;
+	return error_success();
+}
+
+error_t render_graph_execute(render_graph_t* graph)
+{
+	s_sync_offscreen_textures(graph);
+	if (graph->dirty) {
+		error_t err = render_graph_compile(graph);
+		if (err.is_error()) return err;
+	}
+	if (!graph->compiled) return error_failure("Render graph failed to compile.");
+
+	for (int step = 0; step < graph->order.count(); ++step) {
+		render_graph_pass_info_t* pass = graph->passes[graph->order[step]];
+		sg_begin_pass(pass->pass, &pass->action);
+		if (pass->fn) pass->fn(graph, pass->udata);
+		sg_end_pass();
+	}
+
+	return error_success();
+}
+
+sg_image render_graph_get_image(render_graph_t* graph, render_graph_texture_t texture)
+{
+	CUTE_ASSERT(texture >= 0 && texture < graph->textures.count());
+	s_sync_offscreen_textures(graph);
+	return graph->textures[texture].image;
+}
+
+void render_graph_get_texture_size(render_graph_t* graph, render_graph_texture_t texture, int* w, int* h)
+{
+	CUTE_ASSERT(texture >= 0 && texture < graph->textures.count());
+	s_sync_offscreen_textures(graph);
+	if (w) *w = graph->textures[texture].w;
+	if (h) *h = graph->textures[texture].h;
+}
+
+bool render_graph_pass_is_culled(render_graph_t* graph, render_graph_pass_t pass)
+{
+	CUTE_ASSERT(pass >= 0 && pass < graph->passes.count());
+	return graph->passes[pass]->culled;
+}
+
+}
@@ -36,8 +36,10 @@
 #include <cute_gfx.h>
 #include <cute_input.h>
 #include <cute_string.h>
+#include <cute_concurrency.h>
 
 #include <internal/cute_object_table_internal.h>
+#include <internal/cute_thread_claims_internal.h>
 #include <internal/cute_font_internal.h>
 
 #include <cute/cute_font.h>
@@ -81,10 +83,27 @@ struct window_state_t
 
 struct entity_collection_t
 {
+	~entity_collection_t(); // Frees the chunks, see cute_ecs.cpp.
+
 	handle_table_t entity_handle_table;
 	array<handle_t> entity_handles; // TODO - Replace with a counter? Or delete?
 	array<strpool_id> component_type_tuple;
-	array<typeless_array> component_tables;
+	array<typeless_array> component_tables; // When chunked, only used to store the size of each component.
+	array<int> component_columns; // Maps `component_id_t` to an index of `component_tables`, or -1 if not present.
+
+	// Optional chunked storage, see `ecs_entity_set_optional_chunked_storage`.
+	bool chunked = false;
+	int row_count = 0;
+	int entities_per_chunk = 0;
+	size_t chunk_size = 0;
+	array<size_t> chunk_component_offsets;
+	array<void*> chunks;
+
+	// Default bytes of the components marked with `copy_defaults`, loaded from the schema once and
+	// then copied into each new entity. Rebaked whenever `prototype_gen` falls behind `app->ecs_gen`.
+	int prototype_gen = -1;
+	array<uint8_t> prototype;
+	array<int> prototype_offsets; // -1 for components that must run their serializer per entity.
 };
 
 struct system_internal_t
@@ -96,7 +115,9 @@ struct system_internal_t
 		pre_update_fn = NULL;
 		update_fn = NULL;
 		post_update_fn = NULL;
+		parallel_chunk_size = 0;
 		component_type_tuple.clear();
+		component_access.clear();
 	}
 
 	strpool_id name = { 0 };
@@ -104,7 +125,72 @@ struct system_internal_t
 	void (*pre_update_fn)(float dt, void* udata) = NULL;
 	void* update_fn = NULL;
 	void (*post_update_fn)(float dt, void* udata) = NULL;
+	int parallel_chunk_size = 0;
 	array<strpool_id> component_type_tuple;
+	array<component_access_t> component_access;
+
+	// Range of this system's entries in `app->system_matches`.
+	int first_match = 0;
+	int match_count = 0;
+};
+
+struct system_match_t
+{
+	int collection_index;
+	int matches[8]; // Index of the component table for each required component of the system.
+};
+
+struct system_job_t
+{
+	float dt;
+	system_internal_t* system;
+	uint32_t collection_type;
+	entity_collection_t* collection;
+	const int* matches;
+	int begin;
+	int count;
+	float seconds; // Only measured when profiling systems.
+};
+
+struct query_internal_t
+{
+	array<strpool_id> component_type_tuple;
+	array<system_match_t> matches;
+	int gen = -1; // Matches are refreshed whenever this falls behind `app->ecs_gen`.
+};
+
+struct query_job_t
+{
+	ecs_query_fn* fn;
+	void* udata;
+	ecs_span_t span;
+};
+
+enum ecs_command_type_t
+{
+	ECS_COMMAND_TYPE_MAKE,
+	ECS_COMMAND_TYPE_SET_COMPONENT,
+	ECS_COMMAND_TYPE_DESTROY,
+};
+
+struct ecs_command_t
+{
+	ecs_command_type_t type;
+	entity_t entity; // For makes this starts out as the placeholder, and becomes the real entity once played back.
+	int component_id;
+	int data_offset;
+	int data_size;
+};
+
+// Placeholder entities from `entity_delayed_make` have this bit set in their handle. The rest of the
+// handle is the index of the command buffer, and the index of the make command within that buffer.
+#define CUTE_ECS_PLACEHOLDER_BIT (1ULL << 63)
+
+struct ecs_command_buffer_t
+{
+	int played_count = 0;
+	array<ecs_command_t> commands;
+	array<uint8_t> data;
 };
 
 struct component_config_t
@@ -117,6 +203,9 @@ struct component_config_t
 		cleanup_fn = NULL;
 		serializer_udata = NULL;
 		cleanup_udata = NULL;
+		copy_defaults = false;
+		snapshot_serialize = false;
+		id = -1;
 	}
 
 	const char* name = NULL;
@@ -125,6 +214,9 @@ struct component_config_t
 	component_cleanup_fn* cleanup_fn = NULL;
 	void* serializer_udata = NULL;
 	void* cleanup_udata = NULL;
+	bool copy_defaults = false;
+	bool snapshot_serialize = false;
+	int id = -1; // The index of this component type in `app->component_configs`, see `component_id_t`.
 };
 
 struct entity_config_t
@@ -134,11 +226,13 @@ struct entity_config_t
 		entity_type = NULL;
 		component_types.clear();
 		schema.id.val = 0;
+		chunked_storage = false;
 	}
 
 	const char* entity_type = NULL;
 	array<const char*> component_types;
 	string_t schema;
+	bool chunked_storage = false;
 };
 
 struct app_t
@@ -159,6 +253,12 @@ struct app_t
 	triple_buffer_t font_buffer;
 	font_vs_params_t font_vs_uniforms;
 	font_fs_params_t font_fs_uniforms;
+	bool font_use_layout_cache = false;
+	dictionary<uint64_t, font_layout_t*> font_layouts;
+	uint64_t font_layout_updates = 0;
+	int font_layout_hits = 0;
+	int font_layout_misses = 0;
+	dictionary<uint64_t, font_sdf_t*> font_sdfs;
 	bool gfx_enabled = false;
 	sg_context_desc gfx_ctx_params;
 	int w;
@@ -175,6 +275,8 @@ struct app_t
 	v2 upscale;
 	int offscreen_w;
 	int offscreen_h;
+	render_graph_t* render_graph = NULL;
+	bool render_graph_failed = false;
 	window_state_t window_state;
 	window_state_t window_state_prev;
 	bool using_imgui = false;
@@ -204,16 +306,28 @@ struct app_t
 	entity_config_t entity_config_builder;
 	uint32_t entity_type_gen = 0;
 	dictionary<strpool_id, uint32_t> entity_type_string_to_id;
+	dictionary<const char*, strpool_id> ecs_names; // Registered component and entity type names, looked up without touching the strpool.
 	array<strpool_id> entity_type_id_to_string;
 	dictionary<uint32_t, entity_collection_t> entity_collections;
-	uint32_t current_collection_type_being_iterated = ~0;
-	entity_collection_t* current_collection_being_updated = NULL;
-	array<entity_t> delayed_destroy_entities;
+	array<ecs_command_buffer_t> command_buffers; // One per thread, the last one is shared by any extra threads.
+	thread_claims_t command_buffer_claims;
+	bool systems_run_in_parallel = false;
+	bool system_matches_dirty = true;
+	array<system_match_t> system_matches;
+	array<int> system_levels;
+	array<system_job_t> system_jobs;
+	bool systems_profiled = false;
+	int system_profile_frame_count = 0; // Total frames recorded, the ring buffer holds the most recent ones.
+	array<ecs_system_profile_t> system_profiles; // `CUTE_ECS_PROFILE_FRAME_COUNT` rows of one entry per system.
+	ecs_system_profile_t* system_profile_row = NULL; // Row being recorded by `ecs_run_systems`, if any.
+	array<query_internal_t*> queries;
+	array<query_job_t> query_jobs;
 
 	component_config_t component_config_builder;
 	dictionary<strpool_id, component_config_t> component_configs;
 	dictionary<uint32_t, kv_t*> entity_parsed_schemas;
 	dictionary<uint32_t, uint32_t> entity_schema_inheritence;
+	int ecs_gen = 0; // Bumped whenever a component or entity type is registered.
 
 	dictionary<entity_t, int>* save_id_table = NULL;
 	array<entity_t>* load_id_table = NULL;
@@ -221,6 +335,19 @@ struct app_t
 	void* mem_ctx = NULL;
 };
 
+/**
+ * Backend to fetch shaders for. sokol-shdc doesn't emit anything for sokol's dummy backend (which
+ * ignores shaders entirely), so headless builds just borrow the GLSL ones.
+ */
+CUTE_INLINE sg_backend app_shader_backend()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	return SG_BACKEND_GLCORE33;
+#else
+	return sg_query_backend();
+#endif
+}
+
 }
 
 #endif // CUTE_APP_INTERNAL_H
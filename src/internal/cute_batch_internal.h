@@ -0,0 +1,202 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CUTE_BATCH_INTERNAL_H
+#define CUTE_BATCH_INTERNAL_H
+
+#include <cute_defines.h>
+#include <cute_math.h>
+
+struct quad_udata_t
+{
+	float alpha;
+};
+
+#define SPRITEBATCH_SPRITE_USERDATA quad_udata_t
+#include <cute/cute_spritebatch.h>
+
+namespace cute
+{
+
+struct quad_vertex_t
+{
+	v2 pos;
+	v2 uv;
+	float alpha;
+};
+
+/**
+ * One sprite packed down to 32 bytes, for drawing sprites with instancing. The `instanced_vs` stage in
+ * sprite.glsl builds the quad from these, instead of uploading four `quad_vertex_t` per sprite. Nothing
+ * draws with it until sprite_shader.h is regenerated from that source.
+ */
+struct sprite_instance_t
+{
+	v2 pos;
+	int16_t rotation[2]; // Sine and cosine, normalized to the full range of a short.
+	v2 scale;
+	uint16_t uv_rect[4]; // minx, miny, maxx, maxy normalized to the full range of an unsigned short.
+	uint8_t alpha[4]; // Only the first byte is used, the rest pads the record to 4 byte alignment.
+};
+
+/**
+ * Sprites are drawn as indexed quads with 16-bit indices, so this is the most quads a single draw
+ * call can reference.
+ */
+#define CUTE_BATCH_MAX_QUADS_PER_DRAW (65536 / 4)
+
+/**
+ * Expands each sprite into the four corners of a quad, transformed by `m`. Writes `count * 4` vertices,
+ * meant to be drawn with the indices from `batch_make_quad_indices`.
+ * Works on four (SSE2) or eight (AVX) sprites per iteration and finishes the remainder with
+ * `batch_make_sprite_verts_scalar`.
+ */
+CUTE_API void CUTE_CALL batch_make_sprite_verts(const spritebatch_sprite_t* sprites, int count, m3x2 m, quad_vertex_t* verts);
+
+/**
+ * Removes the sprites whose quads fall entirely outside of clip space once transformed by `m`, which maps
+ * sprites into clip space (the projection times the batch's `m3x2`). Sprites left over keep their order.
+ * Returns the number of sprites left over. The bounds of a whole SIMD register of sprites are tested at
+ * once, the survivors are compacted one at a time.
+ */
+CUTE_API int CUTE_CALL batch_cull_sprites(spritebatch_internal_sprite_t* sprites, int count, m3x2 m);
+
+/**
+ * Transforms `count` points by `m` in place. Consecutive points are `stride` bytes apart, so they can be
+ * picked out of interleaved vertices. The points are gathered into SIMD registers since they are not
+ * contiguous.
+ */
+CUTE_API void CUTE_CALL batch_transform_points(v2* points, int count, int stride, m3x2 m);
+
+/**
+ * Writes six indices (two triangles) for each of `quad_count` quads, where quad `i` is made of vertices
+ * `i * 4` through `i * 4 + 3`.
+ */
+CUTE_API void CUTE_CALL batch_make_quad_indices(uint16_t* indices, int quad_count);
+
+/**
+ * Packs each sprite into a `sprite_instance_t`. Writes `count` instances. The packed fields are quantized
+ * four (SSE2) or eight (AVX) sprites at a time.
+ */
+CUTE_API void CUTE_CALL batch_make_sprite_instances(const spritebatch_sprite_t* sprites, int count, sprite_instance_t* instances);
+
+//--------------------------------------------------------------------------------------------------
+// Scalar paths. The SIMD functions above hand their leftover sprites to these, and they are all that
+// runs on targets without SSE2. They are inline so the tests can check the SIMD output against them
+// without the library exporting them.
+
+CUTE_INLINE void batch_make_sprite_verts_scalar(const spritebatch_sprite_t* sprites, int count, m3x2 m, quad_vertex_t* verts)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		const spritebatch_sprite_t* s = sprites + i;
+
+		v2 quad[] = {
+			{ -0.5f,  0.5f },
+			{  0.5f,  0.5f },
+			{  0.5f, -0.5f },
+			{ -0.5f, -0.5f },
+		};
+
+		for (int j = 0; j < 4; ++j)
+		{
+			float x = quad[j].x;
+			float y = quad[j].y;
+
+			// Rotate sprite about origin.
+			float x0 = s->c * x - s->s * y;
+			float y0 = s->s * x + s->c * y;
+			x = x0;
+			y = y0;
+
+			// Scale sprite about origin.
+			x *= s->sx;
+			y *= s->sy;
+
+			// Translate sprite into the world.
+			x += s->x;
+			y += s->y;
+
+			// Apply final batch transformation.
+			v2 p = v2(x, y);
+			p = mul(m, p);
+
+			quad[j].x = p.x;
+			quad[j].y = p.y;
+		}
+
+		// output transformed quad into CPU buffer
+		quad_vertex_t* out_verts = verts + i * 4;
+		for (int j = 0; j < 4; ++j) {
+			out_verts[j].pos = quad[j];
+			out_verts[j].alpha = s->udata.alpha;
+		}
+		out_verts[0].uv = v2(s->minx, s->maxy);
+		out_verts[1].uv = v2(s->maxx, s->maxy);
+		out_verts[2].uv = v2(s->maxx, s->miny);
+		out_verts[3].uv = v2(s->minx, s->miny);
+	}
+}
+
+CUTE_INLINE int batch_cull_sprites_scalar(spritebatch_internal_sprite_t* sprites, int count, m3x2 m)
+{
+	int visible_count = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const spritebatch_internal_sprite_t* s = sprites + i;
+
+		// The two half-extent axes of the quad, see `batch_make_sprite_verts_scalar`.
+		v2 a = v2(s->c * s->sx, s->s * s->sy) * 0.5f;
+		v2 b = v2(-s->s * s->sx, s->c * s->sy) * 0.5f;
+		a = mul(m.m, a);
+		b = mul(m.m, b);
+		v2 c = mul(m, v2(s->x, s->y));
+
+		// Compare the quad's bounding box against clip space, which spans -1 to 1 along both axes.
+		float dx = abs(c.x) - (abs(a.x) + abs(b.x));
+		float dy = abs(c.y) - (abs(a.y) + abs(b.y));
+		if (dx <= 1.0f && dy <= 1.0f) {
+			sprites[visible_count++] = *s;
+		}
+	}
+	return visible_count;
+}
+
+CUTE_INLINE void batch_transform_points_scalar(v2* points, int count, int stride, m3x2 m)
+{
+	uint8_t* bytes = (uint8_t*)points;
+	for (int i = 0; i < count; ++i) {
+		v2* p = (v2*)(bytes + i * stride);
+		*p = mul(m, *p);
+	}
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Sorts sprites by `sort_bits` and then `texture_id`, the same way `spritebatch_flush` does before reporting
+ * batches. Keeps the relative order of sprites with equal keys.
+ */
+CUTE_API void CUTE_CALL batch_radix_sort_sprites(spritebatch_sprite_t* sprites, int count);
+
+}
+
+#endif // CUTE_BATCH_INTERNAL_H
@@ -37,7 +37,9 @@ error_t kv_val_entity(kv_t* kv, entity_t* entity)
 		*entity = app->load_id_table->operator[](index);
 		return error_success();
 	} else {
-		int* index_ptr = app->save_id_table->find(*entity);
+		entity_t key;
+		entity_to_key(*entity, &key);
+		int* index_ptr = app->save_id_table->find(key);
 		CUTE_ASSERT(index_ptr);
 		return kv_val(kv, index_ptr);
 	}
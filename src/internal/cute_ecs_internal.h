@@ -24,12 +24,24 @@
 
 #include <cute_kv.h>
 #include <cute_ecs.h>
+#include <cute_c_runtime.h>
 
 namespace cute
 {
 
 CUTE_API error_t CUTE_CALL kv_val_entity(kv_t* kv, entity_t* entity);
 
+/**
+ * Dictionaries hash every byte of their keys, including the padding between `entity_t::type` and
+ * `entity_t::handle`. Entities must go through here before being used as a dictionary key.
+ */
+CUTE_INLINE void entity_to_key(entity_t entity, entity_t* key)
+{
+	CUTE_MEMSET(key, 0, sizeof(*key));
+	key->type = entity.type;
+	key->handle = entity.handle;
+}
+
 }
 
 #endif // CUTE_ECS_INTERNAL_H
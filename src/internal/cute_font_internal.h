@@ -23,9 +23,11 @@
 #define CUTE_FONT_INTERNAL_H
 
 #include <cute/cute_font.h>
+#include <cute_font.h>
 #include <cute_gfx.h>
 #include <cute_color.h>
 #include <cute_math.h>
+#include <cute_array.h>
 
 #include <shaders/font_shader.h>
 
@@ -34,7 +36,23 @@ namespace cute
 
 using font_vertex_t = cute_font_vert_t;
 
+// A laid out run of text, stored relative to the origin so it can be replayed at any position.
+struct font_layout_t
+{
+	const font_t* font = NULL;
+	array<char> text;
+	float wrap_w = 0;
+	bool clipped = false;
+	aabb_t clip_box;
+	array<font_vertex_t> verts;
+	uint64_t last_used = 0;
+};
+
+// Glyph atlas and ttf data backing a font made by `font_load_sdf`, see cute_font.cpp.
+struct font_sdf_t;
+
 void font_init();
+void font_update();
 
 }
 
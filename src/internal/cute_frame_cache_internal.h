@@ -0,0 +1,71 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CUTE_FRAME_CACHE_INTERNAL_H
+#define CUTE_FRAME_CACHE_INTERNAL_H
+
+#include <cute_defines.h>
+#include <cute_dictionary.h>
+
+namespace cute
+{
+
+/**
+ * Caches of per-frame work (polylines, text layouts) are keyed by hashing everything the cached result
+ * depends upon. Entries are kept as long as they are used at least once in between two updates.
+ */
+
+#define CUTE_FNV1A_OFFSET_BASIS 14695981039346656037ULL
+
+/**
+ * 64-bit FNV-1a, continuing from `h`. Start with `CUTE_FNV1A_OFFSET_BASIS`.
+ */
+CUTE_INLINE uint64_t fnv1a(uint64_t h, const void* data, int size)
+{
+	const uint8_t* bytes = (const uint8_t*)data;
+	for (int i = 0; i < size; ++i) {
+		h = (h ^ bytes[i]) * 1099511628211ULL;
+	}
+	return h;
+}
+
+/**
+ * Removes every entry whose `last_used` is older than `*updates`, handing it to `free_fn`, then
+ * advances `*updates`. Entries should set `last_used` to `*updates` whenever they are used.
+ */
+template <typename T>
+void frame_cache_evict_unused(dictionary<uint64_t, T*>* cache, uint64_t* updates, void (*free_fn)(T* entry, void* udata), void* udata)
+{
+	// Iterate backwards, as removal swaps in the last item.
+	for (int i = cache->count() - 1; i >= 0; --i) {
+		T* entry = cache->items()[i];
+		if (entry->last_used < *updates) {
+			uint64_t key = cache->keys()[i];
+			cache->remove(key);
+			free_fn(entry, udata);
+		}
+	}
+	(*updates)++;
+}
+
+}
+
+#endif // CUTE_FRAME_CACHE_INTERNAL_H
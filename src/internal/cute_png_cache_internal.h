@@ -26,6 +26,7 @@
 #include <cute_array.h>
 #include <cute_dictionary.h>
 #include <cute_strpool.h>
+#include <cute_concurrency.h>
 
 namespace cute
 {
@@ -36,6 +37,7 @@ struct png_cache_t
 {
 	dictionary<uint64_t, png_t> pngs;
 	dictionary<uint64_t, void*> id_to_pixels;
+	rw_lock_t pixels_lock; // Batches may read `id_to_pixels` from worker threads, see `batch_set_async_atlases`.
 	dictionary<strpool_id, animation_t*> animations;
 	dictionary<strpool_id, animation_table_t*> animation_tables;
 	uint64_t id_gen = 0;
@@ -0,0 +1,89 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef CUTE_THREAD_CLAIMS_INTERNAL_H
+#define CUTE_THREAD_CLAIMS_INTERNAL_H
+
+#include <cute_defines.h>
+#include <cute_array.h>
+#include <cute_concurrency.h>
+
+namespace cute
+{
+
+struct thread_claim_t
+{
+	atomic_int_t state = atomic_zero(); // 0 - free, 1 - being claimed, 2 - owned by `owner`.
+	thread_id_t owner = 0;
+};
+
+/**
+ * Hands out indices of per-thread buffers, for recording from any thread without locking. Threads
+ * claim an index the first time they lock, and keep it from then on. Once the first `count - 1`
+ * indices are claimed, any extra threads share the last index behind a mutex.
+ */
+struct thread_claims_t
+{
+	array<thread_claim_t> claims;
+	mutex_t mutex;
+};
+
+CUTE_INLINE void thread_claims_init(thread_claims_t* claims, int count)
+{
+	claims->claims.ensure_count(count - 1);
+	claims->mutex = mutex_create();
+}
+
+CUTE_INLINE void thread_claims_destroy(thread_claims_t* claims)
+{
+	mutex_destroy(&claims->mutex);
+}
+
+CUTE_INLINE int thread_claims_lock(thread_claims_t* claims)
+{
+	thread_id_t id = thread_id();
+	int count = claims->claims.count();
+	for (int i = 0; i < count; ++i) {
+		thread_claim_t* claim = claims->claims + i;
+		int state = atomic_get(&claim->state);
+		if (state == 2 && claim->owner == id) return i;
+		if (state == 0 && !atomic_cas(&claim->state, 0, 1).is_error()) {
+			claim->owner = id;
+			atomic_set(&claim->state, 2);
+			return i;
+		}
+	}
+
+	// Ran out of indices, fallback to sharing the last one.
+	mutex_lock(&claims->mutex);
+	return count;
+}
+
+CUTE_INLINE void thread_claims_unlock(thread_claims_t* claims, int index)
+{
+	if (index == claims->claims.count()) {
+		mutex_unlock(&claims->mutex);
+	}
+}
+
+}
+
+#endif // CUTE_THREAD_CLAIMS_INTERNAL_H
@@ -53,3 +53,26 @@
 @end
 
 @program shd vs fs
+
+@fs sdf_fs
+	layout (location = 0) in vec2 uv;
+
+	out vec4 result;
+
+	layout (binding = 0) uniform sampler2D u_image;
+
+	layout (binding = 0) uniform sdf_fs_params {
+		vec4 u_text_color;
+		float u_edge;
+	};
+
+	void main()
+	{
+		// Distance to the glyph's edge lives in the first channel, fwidth keeps the edge one pixel wide at any scale.
+		float d = texture(u_image, uv).x;
+		float w = fwidth(d);
+		result = u_text_color * smoothstep(u_edge - w, u_edge + w, d);
+	}
+@end
+
+@program sdf_shd vs sdf_fs
@@ -55,3 +55,37 @@
 @end
 
 @program shd vs fs
+
+@vs instanced_vs
+@glsl_options flip_vert_y
+	layout (location = 0) in vec2 in_corner;
+	layout (location = 1) in vec2 in_pos;
+	layout (location = 2) in vec2 in_rotation;
+	layout (location = 3) in vec2 in_scale;
+	layout (location = 4) in vec4 in_uv_rect;
+	layout (location = 5) in float in_alpha;
+
+	layout (location = 0) out vec2 uv;
+	layout (location = 1) out float alpha;
+
+	layout (binding = 0) uniform instanced_vs_params {
+		mat4 u_mvp;
+		vec2 u_mx;
+		vec2 u_my;
+		vec2 u_mp;
+	};
+
+	void main()
+	{
+		// Same as the CPU path: rotate the corner, scale, translate, then apply the batch's m3x2.
+		vec2 p = vec2(in_rotation.y * in_corner.x - in_rotation.x * in_corner.y, in_rotation.x * in_corner.x + in_rotation.y * in_corner.y);
+		p = p * in_scale + in_pos;
+		p = u_mx * p.x + u_my * p.y + u_mp;
+		vec4 posH = u_mvp * vec4(round(p), 0, 1);
+		uv = mix(in_uv_rect.xy, in_uv_rect.zw, in_corner + 0.5);
+		alpha = in_alpha;
+		gl_Position = posH;
+	}
+@end
+
+@program instanced_shd instanced_vs fs
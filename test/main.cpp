@@ -54,6 +54,9 @@
 #include <test_aseprite.h>
 #include <test_png_cache.h>
 #include <test_sprite.h>
+#include <test_batch.h>
+#include <test_font.h>
+#include <test_render_graph.h>
 #include <test_coroutine.h>
 #include <test_client_server.h>
 
@@ -85,6 +88,7 @@ int main(int argc, const char** argv)
 		CUTE_TEST_CASE_ENTRY(test_handle_large_loop),
 		CUTE_TEST_CASE_ENTRY(test_handle_large_loop_and_free),
 		CUTE_TEST_CASE_ENTRY(test_handle_alloc_too_many),
+		CUTE_TEST_CASE_ENTRY(test_handle_state),
 		CUTE_TEST_CASE_ENTRY(test_circular_buffer_basic),
 		CUTE_TEST_CASE_ENTRY(test_circular_buffer_fill_up_and_empty),
 		CUTE_TEST_CASE_ENTRY(test_circular_buffer_overflow),
@@ -146,11 +150,38 @@ int main(int argc, const char** argv)
 		CUTE_TEST_CASE_ENTRY(test_audio_load_asynchronous),
 		CUTE_TEST_CASE_ENTRY(test_ecs_octorok),
 		CUTE_TEST_CASE_ENTRY(test_ecs_no_kv),
+		CUTE_TEST_CASE_ENTRY(test_ecs_parallel_matches_serial),
+		CUTE_TEST_CASE_ENTRY(test_ecs_parallel_hook_order),
+		CUTE_TEST_CASE_ENTRY(test_ecs_register_after_run),
+		CUTE_TEST_CASE_ENTRY(test_ecs_chunked_storage),
+		CUTE_TEST_CASE_ENTRY(test_ecs_make_many),
+		CUTE_TEST_CASE_ENTRY(test_ecs_schema_prototype),
+		CUTE_TEST_CASE_ENTRY(test_ecs_query),
+		CUTE_TEST_CASE_ENTRY(test_ecs_component_id),
+		CUTE_TEST_CASE_ENTRY(test_ecs_snapshot),
+		CUTE_TEST_CASE_ENTRY(test_ecs_delayed_commands),
+		CUTE_TEST_CASE_ENTRY(test_ecs_system_profiling),
 		CUTE_TEST_CASE_ENTRY(test_lru_cache),
 		CUTE_TEST_CASE_ENTRY(test_array_list_init),
 		CUTE_TEST_CASE_ENTRY(test_aseprite_make_destroy),
 		CUTE_TEST_CASE_ENTRY(test_png_cache),
 		CUTE_TEST_CASE_ENTRY(test_sprite_make),
+		CUTE_TEST_CASE_ENTRY(test_batch_sprite_verts),
+		CUTE_TEST_CASE_ENTRY(test_batch_indexed_quads),
+		CUTE_TEST_CASE_ENTRY(test_batch_sprite_instances),
+		CUTE_TEST_CASE_ENTRY(test_batch_threaded_push),
+		CUTE_TEST_CASE_ENTRY(test_batch_radix_sort),
+		CUTE_TEST_CASE_ENTRY(test_batch_static),
+		CUTE_TEST_CASE_ENTRY(test_batch_async_atlases),
+		CUTE_TEST_CASE_ENTRY(test_batch_atlas_stats),
+		CUTE_TEST_CASE_ENTRY(test_batch_culling),
+		CUTE_TEST_CASE_ENTRY(test_batch_push_many),
+		CUTE_TEST_CASE_ENTRY(test_batch_geometry_cache),
+		CUTE_TEST_CASE_ENTRY(test_batch_geom_transform),
+		CUTE_TEST_CASE_ENTRY(test_font_layout_cache),
+		CUTE_TEST_CASE_ENTRY(test_font_sdf),
+		CUTE_TEST_CASE_ENTRY(test_render_graph_schedule),
+		CUTE_TEST_CASE_ENTRY(test_render_graph_offscreen),
 		CUTE_TEST_CASE_ENTRY(test_coroutine),
 	};
 	int test_count = sizeof(tests) / sizeof(*tests);
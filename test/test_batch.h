@@ -0,0 +1,1084 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute.h>
+#include <internal/cute_batch_internal.h>
+using namespace cute;
+
+static void s_random_sprites(array<spritebatch_sprite_t>* sprites, int count)
+{
+	sprites->ensure_count(count);
+	rnd_t rnd = rnd_seed(0);
+	for (int i = 0; i < count; ++i) {
+		spritebatch_sprite_t* s = sprites->data() + i;
+		CUTE_MEMSET(s, 0, sizeof(*s));
+		sincos_t r = sincos(rnd_next_range(&rnd, 0.0f, 2.0f * CUTE_PI));
+		s->x = rnd_next_range(&rnd, -500.0f, 500.0f);
+		s->y = rnd_next_range(&rnd, -500.0f, 500.0f);
+		s->sx = rnd_next_range(&rnd, 1.0f, 64.0f);
+		s->sy = rnd_next_range(&rnd, 1.0f, 64.0f);
+		s->c = r.c;
+		s->s = r.s;
+		s->minx = rnd_next_range(&rnd, 0.0f, 0.5f);
+		s->miny = rnd_next_range(&rnd, 0.0f, 0.5f);
+		s->maxx = s->minx + 0.25f;
+		s->maxy = s->miny + 0.25f;
+		s->udata.alpha = rnd_next_range(&rnd, 0.0f, 1.0f);
+	}
+}
+
+static m3x2 s_test_m3x2()
+{
+	m3x2 m;
+	m.m.x = v2(2.0f, 0.5f);
+	m.m.y = v2(-0.25f, 1.5f);
+	m.p = v2(10.0f, -20.0f);
+	return m;
+}
+
+CUTE_TEST_CASE(test_batch_sprite_verts, "Vectorized sprite vertex generation matches the scalar version.");
+int test_batch_sprite_verts()
+{
+	// Use a count that is not a multiple of the SIMD width to also cover the scalar tail.
+	const int count = 1003;
+	array<spritebatch_sprite_t> sprites;
+	s_random_sprites(&sprites, count);
+	m3x2 m = s_test_m3x2();
+
+	array<quad_vertex_t> expected;
+	array<quad_vertex_t> verts;
+	expected.ensure_count(count * 4);
+	verts.ensure_count(count * 4);
+	batch_make_sprite_verts_scalar(sprites.data(), count, m, expected.data());
+	batch_make_sprite_verts(sprites.data(), count, m, verts.data());
+
+	for (int i = 0; i < count * 4; ++i) {
+		CUTE_TEST_ASSERT(cute::abs(verts[i].pos.x - expected[i].pos.x) < 1.0e-2f);
+		CUTE_TEST_ASSERT(cute::abs(verts[i].pos.y - expected[i].pos.y) < 1.0e-2f);
+		CUTE_TEST_ASSERT(verts[i].uv.x == expected[i].uv.x);
+		CUTE_TEST_ASSERT(verts[i].uv.y == expected[i].uv.y);
+		CUTE_TEST_ASSERT(verts[i].alpha == expected[i].alpha);
+	}
+
+	return 0;
+}
+
+#ifdef SOKOL_DUMMY_BACKEND
+
+struct batch_trace_t
+{
+	array<int> append_sizes;
+	array<uint8_t> last_append;
+	array<uint8_t> all_appends;
+	array<int> draw_element_counts;
+	int indexed_bindings = 0;
+	int made_buffers = 0;
+};
+
+static void s_batch_trace_append_buffer(sg_buffer buf, const sg_range* data, int result, void* user_data)
+{
+	batch_trace_t* trace = (batch_trace_t*)user_data;
+	trace->append_sizes.add((int)data->size);
+	trace->last_append.ensure_count((int)data->size);
+	CUTE_MEMCPY(trace->last_append.data(), data->ptr, data->size);
+	int offset = trace->all_appends.count();
+	trace->all_appends.ensure_count(offset + (int)data->size);
+	CUTE_MEMCPY(trace->all_appends.data() + offset, data->ptr, data->size);
+}
+
+static void s_batch_trace_make_buffer(const sg_buffer_desc* desc, sg_buffer result, void* user_data)
+{
+	batch_trace_t* trace = (batch_trace_t*)user_data;
+	trace->made_buffers++;
+}
+
+static void s_batch_trace_apply_bindings(const sg_bindings* bindings, void* user_data)
+{
+	batch_trace_t* trace = (batch_trace_t*)user_data;
+	if (bindings->index_buffer.id != SG_INVALID_ID) trace->indexed_bindings++;
+}
+
+static void s_batch_trace_draw(int base_element, int num_elements, int num_instances, void* user_data)
+{
+	batch_trace_t* trace = (batch_trace_t*)user_data;
+	trace->draw_element_counts.add(num_elements);
+}
+
+static void s_batch_test_get_pixels(uint64_t image_id, void* buffer, int bytes_to_fill, void* udata)
+{
+	CUTE_MEMSET(buffer, 0xFF, bytes_to_fill);
+}
+
+#endif // SOKOL_DUMMY_BACKEND
+
+CUTE_TEST_CASE(test_batch_indexed_quads, "Sprites and geometry upload four vertices per quad, drawn with an index buffer.");
+int test_batch_indexed_quads()
+{
+	// Both triangles of each quad must cover the same corners, with the same winding, as the
+	// original six vertex layout.
+	const int count = 5;
+	array<spritebatch_sprite_t> sprites;
+	sprites.ensure_count(count);
+	for (int i = 0; i < count; ++i) {
+		spritebatch_sprite_t* s = sprites + i;
+		CUTE_MEMSET(s, 0, sizeof(*s));
+		s->x = (float)i * 10.0f;
+		s->sx = s->sy = 4.0f;
+		s->c = 1.0f;
+		s->minx = s->miny = 0.25f;
+		s->maxx = s->maxy = 0.75f;
+		s->udata.alpha = 1.0f;
+	}
+
+	array<quad_vertex_t> verts;
+	array<uint16_t> indices;
+	verts.ensure_count(count * 4);
+	indices.ensure_count(count * 6);
+	batch_make_sprite_verts(sprites.data(), count, make_identity(), verts.data());
+	batch_make_quad_indices(indices.data(), count);
+
+	v2 expected_uvs[6] = {
+		v2(0.25f, 0.75f), v2(0.25f, 0.25f), v2(0.75f, 0.75f),
+		v2(0.75f, 0.75f), v2(0.25f, 0.25f), v2(0.75f, 0.25f),
+	};
+	for (int i = 0; i < count; ++i) {
+		for (int j = 0; j < 6; ++j) {
+			int index = indices[i * 6 + j];
+			CUTE_TEST_ASSERT(index >= i * 4 && index < i * 4 + 4);
+			CUTE_TEST_ASSERT(verts[index].uv.x == expected_uvs[j].x);
+			CUTE_TEST_ASSERT(verts[index].uv.y == expected_uvs[j].y);
+		}
+		v2 a = verts[indices[i * 6 + 0]].pos;
+		v2 b = verts[indices[i * 6 + 1]].pos;
+		v2 c = verts[indices[i * 6 + 2]].pos;
+		CUTE_TEST_ASSERT(cross(b - a, c - a) > 0);
+	}
+
+#ifdef SOKOL_DUMMY_BACKEND
+	// Run the real batch through sokol_gfx's dummy backend, and look at what reaches the GPU.
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.append_buffer = s_batch_trace_append_buffer;
+	hooks.apply_bindings = s_batch_trace_apply_bindings;
+	hooks.draw = s_batch_trace_draw;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+	const int sprite_count = 100;
+	app_update(0);
+	for (int i = 0; i < sprite_count; ++i) {
+		batch_sprite_t s;
+		s.id = 0;
+		s.w = 8;
+		s.h = 8;
+		s.scale_x = 8.0f;
+		s.scale_y = 8.0f;
+		s.transform.p = v2((float)i, 0);
+		batch_push(batch, s);
+	}
+	batch_flush(batch);
+	app_present();
+
+	CUTE_TEST_ASSERT(trace.append_sizes.count() == 1);
+	CUTE_TEST_ASSERT(trace.append_sizes[0] == sprite_count * 4 * (int)sizeof(quad_vertex_t));
+	CUTE_TEST_ASSERT(trace.draw_element_counts.count() == 1);
+	CUTE_TEST_ASSERT(trace.draw_element_counts[0] == sprite_count * 6);
+	CUTE_TEST_ASSERT(trace.indexed_bindings == 1);
+
+	// Geometry uploads its own indices, as triangles and quads can be mixed freely.
+	trace.append_sizes.clear();
+	trace.draw_element_counts.clear();
+	trace.indexed_bindings = 0;
+	app_update(0);
+	batch_quad(batch, make_aabb(v2(0, 0), 10, 10), color_white());
+	batch_tri(batch, v2(0, 0), v2(1, 0), v2(0, 1), color_white());
+	batch_flush(batch);
+	app_present();
+
+	int geom_vertex_size = (int)(sizeof(v2) + sizeof(color_t));
+	CUTE_TEST_ASSERT(trace.append_sizes.count() == 2);
+	CUTE_TEST_ASSERT(trace.append_sizes[0] == 7 * geom_vertex_size);
+	CUTE_TEST_ASSERT(trace.append_sizes[1] == 9 * (int)sizeof(uint16_t));
+	CUTE_TEST_ASSERT(trace.draw_element_counts.count() == 1);
+	CUTE_TEST_ASSERT(trace.draw_element_counts[0] == 9);
+	CUTE_TEST_ASSERT(trace.indexed_bindings == 1);
+
+	sg_install_trace_hooks(&old_hooks);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_batch_sprite_instances, "Packed sprite instances rebuild the same quads as the vertex path.");
+int test_batch_sprite_instances()
+{
+	const int count = 1000;
+	array<spritebatch_sprite_t> sprites;
+	s_random_sprites(&sprites, count);
+	m3x2 m = s_test_m3x2();
+
+	array<sprite_instance_t> instances;
+	array<quad_vertex_t> expected;
+	instances.ensure_count(count);
+	expected.ensure_count(count * 4);
+	batch_make_sprite_instances(sprites.data(), count, instances.data());
+	batch_make_sprite_verts_scalar(sprites.data(), count, m, expected.data());
+
+	// Unpack each record and build its quad the same way the instanced vertex shader does.
+	v2 corners[] = { v2(-0.5f, 0.5f), v2(0.5f, 0.5f), v2(0.5f, -0.5f), v2(-0.5f, -0.5f) };
+	for (int i = 0; i < count; ++i) {
+		const sprite_instance_t* instance = instances + i;
+		float sn = instance->rotation[0] / 32767.0f;
+		float c = instance->rotation[1] / 32767.0f;
+		v2 uv_min = v2(instance->uv_rect[0] / 65535.0f, instance->uv_rect[1] / 65535.0f);
+		v2 uv_max = v2(instance->uv_rect[2] / 65535.0f, instance->uv_rect[3] / 65535.0f);
+		float alpha = instance->alpha[0] / 255.0f;
+		CUTE_TEST_ASSERT(cute::abs(alpha - sprites[i].udata.alpha) <= 0.5f / 255.0f + 1.0e-6f);
+
+		for (int j = 0; j < 4; ++j) {
+			v2 corner = corners[j];
+			v2 p = v2(c * corner.x - sn * corner.y, sn * corner.x + c * corner.y);
+			p = p * instance->scale + instance->pos;
+			p = mul(m, p);
+			v2 uv = v2(lerp(uv_min.x, uv_max.x, corner.x + 0.5f), lerp(uv_min.y, uv_max.y, corner.y + 0.5f));
+
+			const quad_vertex_t* v = expected + i * 4 + j;
+			CUTE_TEST_ASSERT(cute::abs(p.x - v->pos.x) < 1.0e-2f);
+			CUTE_TEST_ASSERT(cute::abs(p.y - v->pos.y) < 1.0e-2f);
+			CUTE_TEST_ASSERT(cute::abs(uv.x - v->uv.x) < 1.0e-4f);
+			CUTE_TEST_ASSERT(cute::abs(uv.y - v->uv.y) < 1.0e-4f);
+		}
+	}
+
+#ifdef CUTE_TEST_BENCHMARKS
+	// Throughput of packing records compared to writing out vertices.
+	const int bench_count = 100000;
+	const int bench_iters = 20;
+	s_random_sprites(&sprites, bench_count);
+	instances.ensure_count(bench_count);
+	expected.ensure_count(bench_count * 4);
+	float pack_seconds = 0;
+	float verts_seconds = 0;
+	cute::timer_t timer = timer_init();
+	for (int i = 0; i < bench_iters; ++i) {
+		timer_dt(&timer);
+		batch_make_sprite_instances(sprites.data(), bench_count, instances.data());
+		pack_seconds += timer_dt(&timer);
+		batch_make_sprite_verts(sprites.data(), bench_count, m, expected.data());
+		verts_seconds += timer_dt(&timer);
+	}
+	pack_seconds /= bench_iters;
+	verts_seconds /= bench_iters;
+	fprintf(CUTE_TEST_IO_STREAM, "Benchmark:    %d sprites, instances %.3f ms (%d bytes), vertices %.3f ms (%d bytes)\n\t",
+		bench_count,
+		pack_seconds * 1000.0f, bench_count * (int)sizeof(sprite_instance_t),
+		verts_seconds * 1000.0f, bench_count * 4 * (int)sizeof(quad_vertex_t)
+	);
+#endif // CUTE_TEST_BENCHMARKS
+
+	return 0;
+}
+
+#ifdef SOKOL_DUMMY_BACKEND
+
+struct batch_push_task_t
+{
+	batch_t* batch;
+	int sort_bits;
+	int count;
+};
+
+static void s_batch_push_task(void* param)
+{
+	batch_push_task_t* task = (batch_push_task_t*)param;
+	for (int i = 0; i < task->count; ++i) {
+		batch_sprite_t s;
+		s.id = 0;
+		s.w = 8;
+		s.h = 8;
+		s.scale_x = 8.0f;
+		s.scale_y = 8.0f;
+		s.transform.p = v2((float)(task->sort_bits * 1000 + i), 0);
+		s.sort_bits = task->sort_bits;
+		batch_push(task->batch, s);
+	}
+}
+
+#endif // SOKOL_DUMMY_BACKEND
+
+CUTE_TEST_CASE(test_batch_threaded_push, "Sprites pushed from worker threads are merged in at flush, ordered by sort bits.");
+int test_batch_threaded_push()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.append_buffer = s_batch_trace_append_buffer;
+	hooks.draw = s_batch_trace_draw;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+	threadpool_t* pool = threadpool_create(4);
+	const int task_count = 8;
+	const int sprites_per_task = 50;
+	batch_push_task_t tasks[task_count + 1];
+
+	// Run two frames, so threads reuse the buffers they claimed in the first one.
+	for (int frame = 0; frame < 2; ++frame) {
+		trace.append_sizes.clear();
+		trace.draw_element_counts.clear();
+		app_update(0);
+
+		// The main thread pushes the last layer first, which must still come out on top.
+		tasks[task_count] = { batch, task_count, sprites_per_task };
+		s_batch_push_task(tasks + task_count);
+		for (int i = 0; i < task_count; ++i) {
+			tasks[i] = { batch, i, sprites_per_task };
+			threadpool_add_task(pool, s_batch_push_task, tasks + i);
+		}
+		threadpool_kick_and_wait(pool);
+
+		batch_flush(batch);
+		app_present();
+
+		const int sprite_count = (task_count + 1) * sprites_per_task;
+		CUTE_TEST_ASSERT(trace.append_sizes.count() == 1);
+		CUTE_TEST_ASSERT(trace.append_sizes[0] == sprite_count * 4 * (int)sizeof(quad_vertex_t));
+		CUTE_TEST_ASSERT(trace.draw_element_counts.count() == 1);
+		CUTE_TEST_ASSERT(trace.draw_element_counts[0] == sprite_count * 6);
+
+		// Sprite positions encode their sort bits and push order, so the quads must come out sorted.
+		const quad_vertex_t* verts = (const quad_vertex_t*)trace.last_append.data();
+		for (int i = 0; i < sprite_count; ++i) {
+			const quad_vertex_t* v = verts + i * 4;
+			float x = (v[0].pos.x + v[1].pos.x + v[2].pos.x + v[3].pos.x) * 0.25f;
+			float expected = (float)((i / sprites_per_task) * 1000 + i % sprites_per_task);
+			CUTE_TEST_ASSERT(x > expected - 0.01f && x < expected + 0.01f);
+		}
+	}
+
+	threadpool_destroy(pool);
+	sg_install_trace_hooks(&old_hooks);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+// The merge sort `spritebatch_flush` used before the radix sort, ordering by `sort_bits` then `texture_id`.
+static void s_merge_sort_sprites(spritebatch_sprite_t* a, spritebatch_sprite_t* b, int lo, int hi)
+{
+	if (hi - lo <= 1) return;
+	int split = (lo + hi) / 2;
+	s_merge_sort_sprites(a, b, lo, split);
+	s_merge_sort_sprites(a, b, split, hi);
+	int i = lo, j = split;
+	for (int k = lo; k < hi; ++k) {
+		bool take_left = i < split && (j >= hi || a[i].sort_bits < a[j].sort_bits || (a[i].sort_bits == a[j].sort_bits && a[i].texture_id <= a[j].texture_id));
+		b[k] = take_left ? a[i++] : a[j++];
+	}
+	CUTE_MEMCPY(a + lo, b + lo, sizeof(spritebatch_sprite_t) * (hi - lo));
+}
+
+static void s_merge_sort_sprites(array<spritebatch_sprite_t>* sprites)
+{
+	array<spritebatch_sprite_t> scratch;
+	scratch.ensure_count(sprites->count());
+	s_merge_sort_sprites(sprites->data(), scratch.data(), 0, sprites->count());
+}
+
+static void s_random_sort_keys(array<spritebatch_sprite_t>* sprites, int count, int layer_count, int texture_count)
+{
+	sprites->ensure_count(count);
+	rnd_t rnd = rnd_seed(1);
+	for (int i = 0; i < count; ++i) {
+		spritebatch_sprite_t* s = sprites->data() + i;
+		CUTE_MEMSET(s, 0, sizeof(*s));
+		s->sort_bits = rnd_next_range(&rnd, -layer_count, layer_count);
+		s->texture_id = (uint64_t)rnd_next_range(&rnd, 1, texture_count);
+		s->x = (float)i; // Records the original order, to check the sort is stable.
+	}
+}
+
+CUTE_TEST_CASE(test_batch_radix_sort, "Radix sorting sprites orders them exactly like the merge sort.");
+int test_batch_radix_sort()
+{
+	// Spread out keys, and heavily tied ones (a few layers drawn from a handful of atlases) to check stability.
+	const int layer_counts[] = { 100, 4 };
+	const int texture_counts[] = { 1000, 8 };
+	for (int i = 0; i < (int)CUTE_ARRAY_SIZE(layer_counts); ++i) {
+		array<spritebatch_sprite_t> expected;
+		array<spritebatch_sprite_t> sprites;
+		s_random_sort_keys(&expected, 503, layer_counts[i], texture_counts[i]);
+		expected[10].sort_bits = INT_MIN;
+		expected[20].sort_bits = INT_MAX;
+		expected[30].texture_id = 0xFFFFFFFF;
+		sprites = expected;
+		s_merge_sort_sprites(&expected);
+		batch_radix_sort_sprites(sprites.data(), sprites.count());
+		for (int j = 0; j < sprites.count(); ++j) {
+			CUTE_TEST_ASSERT(sprites[j].sort_bits == expected[j].sort_bits);
+			CUTE_TEST_ASSERT(sprites[j].texture_id == expected[j].texture_id);
+			CUTE_TEST_ASSERT(sprites[j].x == expected[j].x);
+		}
+	}
+
+#ifdef CUTE_TEST_BENCHMARKS
+	// Roughly a dense tilemap, a few layers drawn from a handful of atlases.
+	const int bench_counts[] = { 10000, 100000, 1000000 };
+	const int bench_iters = 3;
+	for (int i = 0; i < (int)CUTE_ARRAY_SIZE(bench_counts); ++i) {
+		int count = bench_counts[i];
+		array<spritebatch_sprite_t> input;
+		array<spritebatch_sprite_t> sprites;
+		s_random_sort_keys(&input, count, 4, 8);
+		float merge_seconds = 0;
+		float radix_seconds = 0;
+		cute::timer_t timer = timer_init();
+		for (int j = 0; j < bench_iters; ++j) {
+			sprites = input;
+			timer_dt(&timer);
+			s_merge_sort_sprites(&sprites);
+			merge_seconds += timer_dt(&timer);
+			sprites = input;
+			timer_dt(&timer);
+			batch_radix_sort_sprites(sprites.data(), count);
+			radix_seconds += timer_dt(&timer);
+		}
+		fprintf(CUTE_TEST_IO_STREAM, "Benchmark:    %d sprites, merge sort %.3f ms, radix sort %.3f ms\n\t",
+			count,
+			merge_seconds / bench_iters * 1000.0f,
+			radix_seconds / bench_iters * 1000.0f
+		);
+	}
+#endif // CUTE_TEST_BENCHMARKS
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_batch_static, "Static batches only rebuild their vertices when dirty or when images move.");
+int test_batch_static()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.make_buffer = s_batch_trace_make_buffer;
+	hooks.append_buffer = s_batch_trace_append_buffer;
+	hooks.draw = s_batch_trace_draw;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+	const int sprite_count = 100;
+	array<batch_sprite_t> sprites;
+	for (int i = 0; i < sprite_count; ++i) {
+		batch_sprite_t s;
+		s.id = i % 2;
+		s.w = 8;
+		s.h = 8;
+		s.scale_x = 8.0f;
+		s.scale_y = 8.0f;
+		s.transform.p = v2((float)i, 0);
+		sprites.add(s);
+	}
+	batch_static_t* layer = batch_static_make(batch, sprites.data(), sprites.count());
+
+	batch_sprite_t dynamic = sprites[0];
+	dynamic.id = 2;
+
+	array<int> made_buffers;
+	for (int frame = 0; frame < 5; ++frame) {
+		if (frame == 3) batch_static_mark_dirty(layer);
+		trace.made_buffers = 0;
+		trace.append_sizes.clear();
+		trace.draw_element_counts.clear();
+		app_update(0);
+		batch_update(batch);
+
+		// Sprites pushed before drawing the static batch must survive its rebuild.
+		batch_push(batch, dynamic);
+		batch_static_draw(layer);
+		batch_flush(batch);
+		app_present();
+
+		made_buffers.add(trace.made_buffers);
+		int static_quads = 0;
+		for (int i = 0; i < trace.draw_element_counts.count() - 1; ++i) {
+			static_quads += trace.draw_element_counts[i] / 6;
+		}
+		CUTE_TEST_ASSERT(static_quads == sprite_count);
+		CUTE_TEST_ASSERT(trace.draw_element_counts.last() == 6);
+		CUTE_TEST_ASSERT(trace.append_sizes.count() == 1);
+		CUTE_TEST_ASSERT(trace.append_sizes[0] == 4 * (int)sizeof(quad_vertex_t));
+	}
+
+	// Built on the first draw, rebuilt once the images move into an atlas, then left alone until
+	// explicitly marked dirty.
+	CUTE_TEST_ASSERT(made_buffers[0] == 1);
+	CUTE_TEST_ASSERT(made_buffers[1] == 1);
+	CUTE_TEST_ASSERT(made_buffers[2] == 0);
+	CUTE_TEST_ASSERT(made_buffers[3] == 1);
+	CUTE_TEST_ASSERT(made_buffers[4] == 0);
+
+	// Setting fewer sprites than before draws only the new ones.
+	const int fewer_count = 40;
+	batch_static_set_sprites(layer, sprites.data(), fewer_count);
+	trace.draw_element_counts.clear();
+	app_update(0);
+	batch_update(batch);
+	batch_static_draw(layer);
+	batch_flush(batch);
+	app_present();
+	int static_quads = 0;
+	for (int i = 0; i < trace.draw_element_counts.count(); ++i) {
+		static_quads += trace.draw_element_counts[i] / 6;
+	}
+	CUTE_TEST_ASSERT(static_quads == fewer_count);
+
+	sg_install_trace_hooks(&old_hooks);
+	batch_static_destroy(layer);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_batch_async_atlases, "Atlases built on a worker thread are swapped in on a later update.");
+int test_batch_async_atlases()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.draw = s_batch_trace_draw;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+	batch_set_async_atlases(batch, true);
+
+	const int image_count = 8;
+	array<int> draw_counts;
+	for (int frame = 0; frame < 100; ++frame) {
+		trace.draw_element_counts.clear();
+		app_update(0);
+		batch_update(batch);
+		for (int i = 0; i < image_count; ++i) {
+			batch_sprite_t s;
+			s.id = i;
+			s.w = 8;
+			s.h = 8;
+			s.scale_x = 8.0f;
+			s.scale_y = 8.0f;
+			s.transform.p = v2((float)i, 0);
+			batch_push(batch, s);
+		}
+		batch_flush(batch);
+		app_present();
+
+		draw_counts.add(trace.draw_element_counts.count());
+		if (draw_counts.last() == 1) break;
+		cute::sleep(1);
+	}
+
+	// New images draw from their own textures at first. The atlas is queued by the update on the second
+	// frame, and can only be swapped in by an update after that.
+	CUTE_TEST_ASSERT(draw_counts.count() > 2);
+	CUTE_TEST_ASSERT(draw_counts[0] == image_count);
+	CUTE_TEST_ASSERT(draw_counts[1] == image_count);
+	CUTE_TEST_ASSERT(draw_counts.last() == 1);
+
+	// Jobs still in flight are waited on.
+	for (int i = 0; i < image_count; ++i) {
+		batch_sprite_t s;
+		s.id = image_count + i;
+		s.w = 8;
+		s.h = 8;
+		batch_push(batch, s);
+	}
+	batch_flush(batch);
+	batch_update(batch);
+
+	sg_install_trace_hooks(&old_hooks);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_batch_atlas_stats, "Batch stats count atlases, uploads and draw calls for every packing heuristic.");
+int test_batch_atlas_stats()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_atlas_packing_t packings[] = { BATCH_ATLAS_PACKING_BEST_FIT, BATCH_ATLAS_PACKING_SKYLINE, BATCH_ATLAS_PACKING_MAXRECTS };
+	for (int i = 0; i < (int)CUTE_ARRAY_SIZE(packings); ++i) {
+		batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+		batch_set_atlas_packing(batch, packings[i]);
+
+		const int image_count = 8;
+		batch_stats_t stats[2];
+		for (int frame = 0; frame < 2; ++frame) {
+			app_update(0);
+			batch_update(batch);
+			for (int j = 0; j < image_count; ++j) {
+				batch_sprite_t s;
+				s.id = j;
+				s.w = 8 + j;
+				s.h = 16 - j;
+				s.scale_x = 8.0f;
+				s.scale_y = 8.0f;
+				batch_push(batch, s);
+			}
+			batch_flush(batch);
+			app_present();
+			stats[frame] = batch_get_stats(batch);
+		}
+
+		// New images are drawn from their own textures first, one draw call each.
+		CUTE_TEST_ASSERT(stats[0].atlas_count == 0);
+		CUTE_TEST_ASSERT(stats[0].lonely_texture_count == image_count);
+		CUTE_TEST_ASSERT(stats[0].draw_calls == image_count);
+		int lonely_bytes = 0;
+		for (int j = 0; j < image_count; ++j) {
+			// Lonely textures get a one pixel border, like images in atlases.
+			lonely_bytes += (8 + j + 2) * (16 - j + 2) * (int)sizeof(pixel_t);
+		}
+		CUTE_TEST_ASSERT(stats[0].texture_bytes_uploaded == lonely_bytes);
+		CUTE_TEST_ASSERT(stats[0].buffer_bytes_uploaded > 0);
+
+		// The next update packs them all into a single atlas.
+		CUTE_TEST_ASSERT(stats[1].atlas_count == 1);
+		CUTE_TEST_ASSERT(stats[1].atlases_built == 1);
+		CUTE_TEST_ASSERT(stats[1].atlases_removed == 0);
+		CUTE_TEST_ASSERT(stats[1].lonely_texture_count == 0);
+		CUTE_TEST_ASSERT(stats[1].atlas_fill_ratio > 0 && stats[1].atlas_fill_ratio < 1.0f);
+		CUTE_TEST_ASSERT(stats[1].texture_bytes_uploaded > 0);
+		CUTE_TEST_ASSERT(stats[1].draw_calls == 1);
+
+		batch_destroy(batch);
+	}
+
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_batch_culling, "Sprites outside of the view are culled before they are sorted and drawn.");
+int test_batch_culling()
+{
+	// The vectorized cull keeps exactly the same sprites as the scalar one.
+	const int count = 1003;
+	array<spritebatch_sprite_t> sprites;
+	s_random_sprites(&sprites, count);
+	array<spritebatch_internal_sprite_t> expected;
+	array<spritebatch_internal_sprite_t> culled;
+	expected.ensure_count(count);
+	culled.ensure_count(count);
+	for (int i = 0; i < count; ++i) {
+		spritebatch_internal_sprite_t* s = expected + i;
+		CUTE_MEMSET(s, 0, sizeof(*s));
+		s->x = sprites[i].x;
+		s->y = sprites[i].y;
+		s->sx = sprites[i].sx;
+		s->sy = sprites[i].sy;
+		s->c = sprites[i].c;
+		s->s = sprites[i].s;
+		s->sort_bits = i;
+		culled[i] = *s;
+	}
+
+	m3x2 m = mul(make_scale(v2(2.0f / 320.0f, 2.0f / 240.0f)), s_test_m3x2());
+	int expected_count = batch_cull_sprites_scalar(expected.data(), count, m);
+	int culled_count = batch_cull_sprites(culled.data(), count, m);
+	CUTE_TEST_ASSERT(expected_count > 0 && expected_count < count);
+	CUTE_TEST_ASSERT(culled_count == expected_count);
+	for (int i = 0; i < culled_count; ++i) {
+		CUTE_TEST_ASSERT(culled[i].sort_bits == expected[i].sort_bits);
+	}
+
+	// No sprite with a corner on screen is culled.
+	array<quad_vertex_t> verts;
+	verts.ensure_count(count * 4);
+	batch_make_sprite_verts_scalar(sprites.data(), count, m, verts.data());
+	int next = 0;
+	for (int i = 0; i < count; ++i) {
+		bool on_screen = false;
+		for (int j = 0; j < 4; ++j) {
+			v2 p = verts[i * 4 + j].pos;
+			on_screen |= cute::abs(p.x) < 1.0f && cute::abs(p.y) < 1.0f;
+		}
+		bool kept = next < culled_count && culled[next].sort_bits == i;
+		if (kept) ++next;
+		CUTE_TEST_ASSERT(kept || !on_screen);
+	}
+
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.draw = s_batch_trace_draw;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+	batch_set_projection(batch, matrix_ortho_2d(100.0f, 100.0f, 0, 0));
+	batch_set_culling(batch, true);
+
+	// Ten sprites in view, and forty more off to the right.
+	for (int frame = 0; frame < 2; ++frame) {
+		trace.draw_element_counts.clear();
+		app_update(0);
+		if (frame == 1) batch_push_m3x2(batch, make_translation(-400.0f, 0));
+		for (int i = 0; i < 50; ++i) {
+			batch_sprite_t s;
+			s.id = 0;
+			s.w = 8;
+			s.h = 8;
+			s.scale_x = 8.0f;
+			s.scale_y = 8.0f;
+			s.transform.p = i < 10 ? v2(-45.0f + i * 10.0f, 0) : v2(100.0f + i * 10.0f, 0);
+			batch_push(batch, s);
+		}
+		batch_flush(batch);
+		if (frame == 1) batch_pop_m3x2(batch);
+		app_present();
+
+		// Moving the view with an `m3x2` brings sprites 25 through 35 into view instead.
+		CUTE_TEST_ASSERT(trace.draw_element_counts.count() == 1);
+		CUTE_TEST_ASSERT(trace.draw_element_counts[0] == (frame == 0 ? 10 : 11) * 6);
+	}
+
+	sg_install_trace_hooks(&old_hooks);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+#ifdef SOKOL_DUMMY_BACKEND
+
+struct batch_push_many_task_t
+{
+	batch_t* batch;
+	const batch_sprite_t* sprites;
+	int count;
+};
+
+static void s_batch_push_many_task(void* param)
+{
+	batch_push_many_task_t* task = (batch_push_many_task_t*)param;
+	batch_push_many(task->batch, task->sprites, task->count);
+}
+
+#endif // SOKOL_DUMMY_BACKEND
+
+CUTE_TEST_CASE(test_batch_push_many, "Pushing sprites in bulk, or as separate arrays, draws the same quads as pushing them one by one.");
+int test_batch_push_many()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.append_buffer = s_batch_trace_append_buffer;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	const int count = 301;
+	array<batch_sprite_t> sprites;
+	array<v2> positions;
+	array<v2> scales;
+	array<sincos_t> rotations;
+	rnd_t rnd = rnd_seed(0);
+	for (int i = 0; i < count; ++i) {
+		batch_sprite_t s;
+		s.id = 0;
+		s.w = 8;
+		s.h = 8;
+		s.scale_x = rnd_next_range(&rnd, 1.0f, 64.0f);
+		s.scale_y = rnd_next_range(&rnd, 1.0f, 64.0f);
+		s.transform.p = v2(rnd_next_range(&rnd, -500.0f, 500.0f), rnd_next_range(&rnd, -500.0f, 500.0f));
+		s.transform.r = sincos(rnd_next_range(&rnd, 0.0f, 2.0f * CUTE_PI));
+		sprites.add(s);
+		positions.add(s.transform.p);
+		scales.add(v2(s.scale_x, s.scale_y));
+		rotations.add(s.transform.r);
+	}
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+	threadpool_t* pool = threadpool_create(1);
+	array<uint8_t> expected;
+
+	// One by one, all at once, as separate arrays, and all at once from a worker thread.
+	for (int mode = 0; mode < 4; ++mode) {
+		trace.append_sizes.clear();
+		app_update(0);
+		if (mode == 0) {
+			for (int i = 0; i < count; ++i) batch_push(batch, sprites[i]);
+		} else if (mode == 1) {
+			batch_push_many(batch, sprites.data(), count);
+		} else if (mode == 2) {
+			batch_push_many(batch, sprites[0], positions.data(), scales.data(), rotations.data(), count);
+		} else {
+			batch_push_many_task_t task = { batch, sprites.data(), count };
+			threadpool_add_task(pool, s_batch_push_many_task, &task);
+			threadpool_kick_and_wait(pool);
+		}
+		batch_flush(batch);
+		app_present();
+
+		CUTE_TEST_ASSERT(trace.append_sizes.count() == 1);
+		CUTE_TEST_ASSERT(trace.append_sizes[0] == count * 4 * (int)sizeof(quad_vertex_t));
+		if (mode == 0) {
+			expected = trace.last_append;
+		} else {
+			CUTE_TEST_ASSERT(!CUTE_MEMCMP(trace.last_append.data(), expected.data(), expected.count()));
+		}
+	}
+
+	// Scales and rotations can be left out, to use the ones from the template sprite instead.
+	trace.append_sizes.clear();
+	app_update(0);
+	batch_sprite_t s = sprites[0];
+	s.transform.r = sincos(0);
+	batch_push_many(batch, s, positions.data(), NULL, NULL, count);
+	batch_flush(batch);
+	app_present();
+	const quad_vertex_t* verts = (const quad_vertex_t*)trace.last_append.data();
+	for (int i = 0; i < count; ++i) {
+		const quad_vertex_t* v = verts + i * 4;
+		v2 center = (v[0].pos + v[1].pos + v[2].pos + v[3].pos) * 0.25f;
+		CUTE_TEST_ASSERT(cute::abs(center.x - positions[i].x) < 1.0e-2f);
+		CUTE_TEST_ASSERT(cute::abs(center.y - positions[i].y) < 1.0e-2f);
+		CUTE_TEST_ASSERT(cute::abs(v[0].pos.y - v[1].pos.y) < 1.0e-2f);
+
+		// Quads are grown a little to fit the border pixels around images in the atlas.
+		float w = s.scale_x + s.scale_x / (float)s.w * 2.0f;
+		CUTE_TEST_ASSERT(cute::abs(v[1].pos.x - v[0].pos.x - w) < 1.0e-2f);
+	}
+
+	threadpool_destroy(pool);
+	sg_install_trace_hooks(&old_hooks);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_batch_geometry_cache, "Circles from the unit tables and cached polylines match freshly built geometry.");
+int test_batch_geometry_cache()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.append_buffer = s_batch_trace_append_buffer;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	struct geom_vertex_t
+	{
+		v2 p;
+		color_t c;
+	};
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+
+	// Every rim vertex of a circle sits exactly at its radius, also for a second circle reusing the table.
+	for (int i = 0; i < 2; ++i) {
+		trace.append_sizes.clear();
+		trace.all_appends.clear();
+		app_update(0);
+		batch_circle(batch, v2(10.0f, 20.0f), 5.0f, 16, color_white());
+		batch_flush(batch);
+		app_present();
+		CUTE_TEST_ASSERT(trace.append_sizes.count() == 2);
+		CUTE_TEST_ASSERT(trace.append_sizes[0] == 16 * 3 * (int)sizeof(geom_vertex_t));
+		const geom_vertex_t* verts = (const geom_vertex_t*)trace.all_appends.data();
+		for (int j = 0; j < 16; ++j) {
+			CUTE_TEST_ASSERT(cute::abs(len(verts[j * 3 + 0].p - v2(10.0f, 20.0f)) - 5.0f) < 1.0e-4f);
+			CUTE_TEST_ASSERT(cute::abs(len(verts[j * 3 + 1].p - v2(10.0f, 20.0f)) - 5.0f) < 1.0e-4f);
+		}
+		CUTE_TEST_ASSERT(cute::abs(verts[15 * 3 + 1].p.x - 15.0f) < 1.0e-4f);
+	}
+
+	// The same polyline drawn twice in a row, after some other geometry, is a cache hit the second time and in
+	// the next frame. With the cache on or off the uploads must be identical.
+	v2 points[] = { v2(0, 0), v2(50.0f, 10.0f), v2(60.0f, 80.0f), v2(-20.0f, 40.0f), v2(-30.0f, -10.0f) };
+	int point_count = (int)CUTE_ARRAY_SIZE(points);
+	array<uint8_t> expected;
+	for (int pass = 0; pass < 3; ++pass) {
+		batch_set_polyline_cache(batch, pass > 0);
+		trace.all_appends.clear();
+		app_update(0);
+		batch_update(batch);
+		batch_quad(batch, make_aabb(v2(0, 0), 10, 10), color_white());
+		batch_polyline(batch, points, point_count, 4.0f, color_red(), false, true, 3);
+		batch_polyline(batch, points, point_count, 4.0f, color_red(), true, false, 0);
+		batch_polyline(batch, points, point_count, 4.0f, color_red(), false, true, 3);
+		batch_polyline(batch, points, point_count, 4.0f, color_red(), true, false, 0);
+		batch_flush(batch);
+		app_present();
+		if (pass == 0) {
+			expected = trace.all_appends;
+		} else {
+			CUTE_TEST_ASSERT(trace.all_appends.count() == expected.count());
+			CUTE_TEST_ASSERT(!CUTE_MEMCMP(trace.all_appends.data(), expected.data(), expected.count()));
+		}
+	}
+
+	// Changing a single point must not hit the cache.
+	points[2].x += 1.0f;
+	trace.append_sizes.clear();
+	trace.all_appends.clear();
+	app_update(0);
+	batch_polyline(batch, points, point_count, 4.0f, color_red(), false, true, 3);
+	batch_flush(batch);
+	app_present();
+	array<uint8_t> cached = trace.all_appends;
+
+	batch_set_polyline_cache(batch, false);
+	trace.all_appends.clear();
+	app_update(0);
+	batch_polyline(batch, points, point_count, 4.0f, color_red(), false, true, 3);
+	batch_flush(batch);
+	app_present();
+	CUTE_TEST_ASSERT(trace.all_appends.count() == cached.count());
+	CUTE_TEST_ASSERT(!CUTE_MEMCMP(trace.all_appends.data(), cached.data(), cached.count()));
+
+	sg_install_trace_hooks(&old_hooks);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_batch_geom_transform, "Geometry is transformed by the m3x2 current when it was pushed.");
+int test_batch_geom_transform()
+{
+	// The vectorized transform matches the scalar one, picking points out of interleaved vertices.
+	struct geom_vertex_t
+	{
+		v2 p;
+		color_t c;
+	};
+	const int count = 1003;
+	array<geom_vertex_t> expected;
+	array<geom_vertex_t> verts;
+	rnd_t rnd = rnd_seed(0);
+	for (int i = 0; i < count; ++i) {
+		geom_vertex_t v;
+		v.p = v2(rnd_next_range(&rnd, -500.0f, 500.0f), rnd_next_range(&rnd, -500.0f, 500.0f));
+		v.c = make_color((float)i, 0.0f, 0.0f);
+		expected.add(v);
+		verts.add(v);
+	}
+	m3x2 m = s_test_m3x2();
+	batch_transform_points_scalar(&expected[0].p, count, (int)sizeof(geom_vertex_t), m);
+	batch_transform_points(&verts[0].p, count, (int)sizeof(geom_vertex_t), m);
+	for (int i = 0; i < count; ++i) {
+		CUTE_TEST_ASSERT(cute::abs(verts[i].p.x - expected[i].p.x) < 1.0e-2f);
+		CUTE_TEST_ASSERT(cute::abs(verts[i].p.y - expected[i].p.y) < 1.0e-2f);
+		CUTE_TEST_ASSERT(verts[i].c.r == (float)i);
+	}
+
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	batch_trace_t trace;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &trace;
+	hooks.append_buffer = s_batch_trace_append_buffer;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	batch_t* batch = batch_make(s_batch_test_get_pixels, NULL);
+	app_update(0);
+	batch_tri(batch, v2(0, 0), v2(1, 0), v2(0, 1), color_white());
+	batch_push_m3x2(batch, make_translation(100.0f, 0));
+	batch_tri(batch, v2(0, 0), v2(1, 0), v2(0, 1), color_white());
+	batch_push_m3x2(batch, make_scale(2.0f));
+	batch_tri(batch, v2(0, 0), v2(1, 0), v2(0, 1), color_white());
+	batch_pop_m3x2(batch);
+	batch_pop_m3x2(batch);
+	batch_tri(batch, v2(0, 0), v2(1, 0), v2(0, 1), color_white());
+	batch_flush(batch);
+	app_present();
+
+	v2 expected_points[] = {
+		v2(0, 0), v2(1, 0), v2(0, 1),
+		v2(100.0f, 0), v2(101.0f, 0), v2(100.0f, 1.0f),
+		v2(0, 0), v2(2.0f, 0), v2(0, 2.0f),
+		v2(0, 0), v2(1, 0), v2(0, 1),
+	};
+	CUTE_TEST_ASSERT(trace.append_sizes.count() == 2);
+	CUTE_TEST_ASSERT(trace.append_sizes[0] == 12 * (int)sizeof(geom_vertex_t));
+	const geom_vertex_t* pushed = (const geom_vertex_t*)trace.all_appends.data();
+	for (int i = 0; i < 12; ++i) {
+		CUTE_TEST_ASSERT(pushed[i].p.x == expected_points[i].x);
+		CUTE_TEST_ASSERT(pushed[i].p.y == expected_points[i].y);
+	}
+
+	sg_install_trace_hooks(&old_hooks);
+	batch_destroy(batch);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
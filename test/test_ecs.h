@@ -341,3 +341,965 @@ int test_ecs_no_kv()
 
 	return 0;
 }
+
+// -------------------------------------------------------------------------------------------------
+
+struct test_component_position_t
+{
+	float x;
+	float y;
+};
+
+struct test_component_velocity_t
+{
+	float x;
+	float y;
+};
+
+struct test_component_health_t
+{
+	int hp;
+};
+
+cute::error_t test_component_zero_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	if (reading) {
+		CUTE_MEMSET(component, 0, (size_t)udata);
+	}
+	return error_success();
+}
+
+void update_test_integrate_system(float dt, void* udata, test_component_velocity_t* velocities, test_component_position_t* positions, int entity_count)
+{
+	for (int i = 0; i < entity_count; ++i) {
+		positions[i].x += velocities[i].x * dt;
+		positions[i].y += velocities[i].y * dt;
+	}
+}
+
+void update_test_damping_system(float dt, void* udata, test_component_velocity_t* velocities, int entity_count)
+{
+	for (int i = 0; i < entity_count; ++i) {
+		velocities[i].x *= 0.99f;
+		velocities[i].y = velocities[i].y * 0.95f - 1.0f;
+	}
+}
+
+void update_test_decay_system(float dt, void* udata, test_component_health_t* healths, int entity_count)
+{
+	for (int i = 0; i < entity_count; ++i) {
+		healths[i].hp -= 1;
+	}
+}
+
+void update_test_heal_system(float dt, void* udata, test_component_position_t* positions, test_component_health_t* healths, int entity_count)
+{
+	for (int i = 0; i < entity_count; ++i) {
+		if (positions[i].x > 50.0f) healths[i].hp += 3;
+	}
+}
+
+static void s_register_parallel_test_ecs(bool parallel)
+{
+	ecs_component_begin();
+	ecs_component_set_name("position");
+	ecs_component_set_size(sizeof(test_component_position_t));
+	ecs_component_set_optional_serializer(test_component_zero_serialize, (void*)sizeof(test_component_position_t));
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("velocity");
+	ecs_component_set_size(sizeof(test_component_velocity_t));
+	ecs_component_set_optional_serializer(test_component_zero_serialize, (void*)sizeof(test_component_velocity_t));
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("health");
+	ecs_component_set_size(sizeof(test_component_health_t));
+	ecs_component_set_optional_serializer(test_component_zero_serialize, (void*)sizeof(test_component_health_t));
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("mover");
+	ecs_entity_add_component("position");
+	ecs_entity_add_component("velocity");
+	ecs_entity_set_optional_chunked_storage(true);
+	ecs_entity_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("unit");
+	ecs_entity_add_component("position");
+	ecs_entity_add_component("velocity");
+	ecs_entity_add_component("health");
+	ecs_entity_end();
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_test_integrate_system);
+	ecs_system_require_component("velocity", COMPONENT_ACCESS_READ);
+	ecs_system_require_component("position");
+	ecs_system_set_optional_parallel_chunk_size(64);
+	ecs_system_end();
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_test_damping_system);
+	ecs_system_require_component("velocity");
+	ecs_system_set_optional_parallel_chunk_size(100);
+	ecs_system_end();
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_test_decay_system);
+	ecs_system_require_component("health");
+	ecs_system_end();
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_test_heal_system);
+	ecs_system_require_component("position", COMPONENT_ACCESS_READ);
+	ecs_system_require_component("health");
+	ecs_system_end();
+
+	ecs_set_parallel_systems(parallel);
+}
+
+static void s_spawn_parallel_test_entities(array<entity_t>* entities)
+{
+	for (int i = 0; i < 1000; ++i) {
+		entity_t e = entity_make(i & 1 ? "mover" : "unit");
+		test_component_velocity_t* velocity = (test_component_velocity_t*)entity_get_component(e, "velocity");
+		velocity->x = (float)(i % 37);
+		velocity->y = (float)(i % 11) - 5.0f;
+		test_component_health_t* health = (test_component_health_t*)entity_get_component(e, "health");
+		if (health) health->hp = 100 + i;
+		entities->add(e);
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_parallel_matches_serial, "Running systems in parallel gives the same results as running them serially.");
+int test_ecs_parallel_matches_serial()
+{
+	array<test_component_position_t> serial_positions;
+	array<int> serial_hps;
+
+	for (int pass = 0; pass < 2; ++pass) {
+		bool parallel = pass == 1;
+		if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+			return -1;
+		}
+
+		s_register_parallel_test_ecs(parallel);
+		array<entity_t> entities;
+		s_spawn_parallel_test_entities(&entities);
+
+		for (int i = 0; i < 10; ++i) {
+			ecs_run_systems(1.0f / 60.0f);
+		}
+
+		for (int i = 0; i < entities.count(); ++i) {
+			test_component_position_t* position = (test_component_position_t*)entity_get_component(entities[i], "position");
+			test_component_health_t* health = (test_component_health_t*)entity_get_component(entities[i], "health");
+			int hp = health ? health->hp : 0;
+			if (!parallel) {
+				serial_positions.add(*position);
+				serial_hps.add(hp);
+			} else {
+				CUTE_TEST_ASSERT(position->x == serial_positions[i].x);
+				CUTE_TEST_ASSERT(position->y == serial_positions[i].y);
+				CUTE_TEST_ASSERT(hp == serial_hps[i]);
+			}
+		}
+
+		app_destroy();
+	}
+
+	return 0;
+}
+
+struct test_hook_order_t
+{
+	atomic_int_t decay_updates;
+	array<int> log; // Decay updates seen by each call to the pre and post update of the damping system.
+};
+
+static test_hook_order_t s_hook_order;
+
+CUTE_TEST_CASE(test_ecs_parallel_hook_order, "Pre and post updates are called in the same order when running systems in parallel.");
+int test_ecs_parallel_hook_order()
+{
+	array<int> serial_log;
+
+	for (int pass = 0; pass < 2; ++pass) {
+		bool parallel = pass == 1;
+		if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+			return -1;
+		}
+
+		s_hook_order.decay_updates = atomic_zero();
+		s_hook_order.log.clear();
+
+		// The damping system and the decay system touch different components, so would otherwise share a level.
+		s_register_parallel_test_ecs(parallel);
+		ecs_system_begin();
+		ecs_system_set_update((void*)update_test_damping_system);
+		ecs_system_require_component("velocity");
+		ecs_system_set_optional_pre_update([](float dt, void* udata) { s_hook_order.log.add(atomic_get(&s_hook_order.decay_updates)); });
+		ecs_system_set_optional_post_update([](float dt, void* udata) { s_hook_order.log.add(atomic_get(&s_hook_order.decay_updates)); });
+		ecs_system_end();
+		ecs_system_begin();
+		ecs_system_set_update((void*)(void (*)(float, void*, test_component_health_t*, int))[](float dt, void* udata, test_component_health_t* healths, int entity_count) {
+			atomic_add(&s_hook_order.decay_updates, 1);
+		});
+		ecs_system_require_component("health");
+		ecs_system_end();
+
+		array<entity_t> entities;
+		s_spawn_parallel_test_entities(&entities);
+		for (int i = 0; i < 3; ++i) {
+			ecs_run_systems(1.0f / 60.0f);
+		}
+
+		CUTE_TEST_ASSERT(s_hook_order.log.count() == 6);
+		if (!parallel) {
+			serial_log = s_hook_order.log;
+		} else {
+			CUTE_TEST_ASSERT(!CUTE_MEMCMP(s_hook_order.log.data(), serial_log.data(), sizeof(int) * 6));
+		}
+
+		app_destroy();
+	}
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+CUTE_TEST_CASE(test_ecs_register_after_run, "Entity types and systems registered after running systems are picked up.");
+int test_ecs_register_after_run()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("Dummy");
+	ecs_component_set_size(sizeof(dummy_component_t));
+	ecs_component_set_optional_serializer(dummy_serialize);
+	ecs_component_end();
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_dummy_system);
+	ecs_system_require_component("Dummy");
+	ecs_system_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dummy_A");
+	ecs_entity_add_component("Dummy");
+	ecs_entity_end();
+
+	entity_t a = entity_make("Dummy_A");
+	ecs_run_systems(0);
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Dummy_B");
+	ecs_entity_add_component("Dummy");
+	ecs_entity_end();
+
+	entity_t b = entity_make("Dummy_B");
+	ecs_run_systems(0);
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_dummy_system);
+	ecs_system_require_component("Dummy");
+	ecs_system_end();
+
+	// Systems without components are called once per entity type.
+	static int s_no_component_calls;
+	s_no_component_calls = 0;
+	ecs_system_begin();
+	ecs_system_set_update((void*)(void (*)(float, void*))[](float dt, void* udata) { s_no_component_calls++; });
+	ecs_system_end();
+
+	ecs_run_systems(0);
+
+	CUTE_TEST_ASSERT(((dummy_component_t*)entity_get_component(a, "Dummy"))->iters == 4);
+	CUTE_TEST_ASSERT(((dummy_component_t*)entity_get_component(b, "Dummy"))->iters == 3);
+	CUTE_TEST_ASSERT(s_no_component_calls == 2);
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+struct test_component_counter_t
+{
+	int id = 0;
+	int iters = 0;
+};
+
+cute::error_t test_component_counter_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	if (reading) {
+		CUTE_PLACEMENT_NEW(component) test_component_counter_t;
+	}
+	return error_success();
+}
+
+int s_counter_system_calls;
+int s_counter_system_entities;
+void update_test_counter_system(float dt, void* udata, test_component_counter_t* counters, test_component_position_t* positions, int entity_count)
+{
+	s_counter_system_calls++;
+	s_counter_system_entities += entity_count;
+	for (int i = 0; i < entity_count; ++i) {
+		counters[i].iters++;
+		positions[i].x = (float)counters[i].id;
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_chunked_storage, "Spawn, update and destroy entities stored in chunks.");
+int test_ecs_chunked_storage()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("counter");
+	ecs_component_set_size(sizeof(test_component_counter_t));
+	ecs_component_set_optional_serializer(test_component_counter_serialize);
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("position");
+	ecs_component_set_size(sizeof(test_component_position_t));
+	ecs_component_set_optional_serializer(test_component_zero_serialize, (void*)sizeof(test_component_position_t));
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("bullet");
+	ecs_entity_add_component("counter");
+	ecs_entity_add_component("position");
+	ecs_entity_set_optional_chunked_storage(true);
+	ecs_entity_end();
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_test_counter_system);
+	ecs_system_require_component("counter");
+	ecs_system_require_component("position");
+	ecs_system_end();
+
+	array<entity_t> bullets;
+	entity_t first = entity_make("bullet");
+	test_component_counter_t* first_counter = (test_component_counter_t*)entity_get_component(first, "counter");
+	CUTE_TEST_ASSERT(((uintptr_t)first_counter & 63) == 0);
+	bullets.add(first);
+	for (int i = 1; i < 5000; ++i) {
+		entity_t e = entity_make("bullet");
+		((test_component_counter_t*)entity_get_component(e, "counter"))->id = i;
+		bullets.add(e);
+	}
+
+	// Spawning more entities never moves existing components.
+	CUTE_TEST_ASSERT(entity_get_component(first, "counter") == first_counter);
+
+	s_counter_system_calls = 0;
+	s_counter_system_entities = 0;
+	ecs_run_systems(0);
+	CUTE_TEST_ASSERT(s_counter_system_calls > 1);
+	CUTE_TEST_ASSERT(s_counter_system_entities == 5000);
+
+	// Destroy every other entity, the remaining ones must keep their own components.
+	for (int i = 0; i < bullets.count(); i += 2) {
+		entity_destroy(bullets[i]);
+	}
+	ecs_run_systems(0);
+	for (int i = 1; i < bullets.count(); i += 2) {
+		test_component_counter_t* counter = (test_component_counter_t*)entity_get_component(bullets[i], "counter");
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(bullets[i], "position");
+		CUTE_TEST_ASSERT(counter->id == i);
+		CUTE_TEST_ASSERT(counter->iters == 2);
+		CUTE_TEST_ASSERT(position->x == (float)i);
+	}
+	CUTE_TEST_ASSERT(s_counter_system_entities == 7500);
+
+	app_destroy();
+
+	return 0;
+}
+
+int s_sprite_serialize_count;
+cute::error_t test_component_counted_sprite_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	++s_sprite_serialize_count;
+	return test_component_sprite_serialize(kv, reading, entity, component, udata);
+}
+
+int s_tracked_cleanup_count;
+void test_component_tracked_cleanup(entity_t entity, void* component, void* udata)
+{
+	++s_tracked_cleanup_count;
+}
+
+int s_faulty_loads_left;
+cute::error_t test_component_faulty_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	if (!s_faulty_loads_left) return error_failure("Faulty component.");
+	--s_faulty_loads_left;
+	return error_success();
+}
+
+CUTE_TEST_CASE(test_ecs_make_many, "Make and destroy many entities at once, copying defaults from one serialized component.");
+int test_ecs_make_many()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_sprite_t");
+	ecs_component_set_size(sizeof(test_component_sprite_t));
+	ecs_component_set_optional_serializer(test_component_counted_sprite_serialize);
+	ecs_component_set_optional_copy_defaults(true);
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_collider_t");
+	ecs_component_set_size(sizeof(test_component_collider_t));
+	ecs_component_set_optional_serializer(test_component_collider_serialize);
+	ecs_component_end();
+
+	const char* schema = CUTE_STRINGIZE(
+		entity_type = "Pellet",
+		test_component_sprite_t = {
+			img_id = 2,
+		},
+		test_component_collider_t = {
+			type = 4,
+			radius = 3
+		},
+	);
+
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(schema);
+	ecs_entity_end();
+
+	// Defaults are loaded from the schema once, on the first spawn.
+	s_sprite_serialize_count = 0;
+	entity_t single = entity_make("Pellet");
+	CUTE_TEST_ASSERT(s_sprite_serialize_count == 1);
+
+	entity_t pellets[1000];
+	CUTE_TEST_ASSERT(!entity_make_many("Pellet", 1000, pellets).is_error());
+	CUTE_TEST_ASSERT(s_sprite_serialize_count == 1);
+	entity_t pebbles[10];
+	CUTE_TEST_ASSERT(entity_make_many("Pebble", 10, pebbles).is_error());
+	CUTE_TEST_ASSERT(pebbles[9] == INVALID_ENTITY);
+
+	for (int i = 0; i < 1000; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(pellets[i]));
+		test_component_sprite_t* sprite = (test_component_sprite_t*)entity_get_component(pellets[i], "test_component_sprite_t");
+		test_component_collider_t* collider = (test_component_collider_t*)entity_get_component(pellets[i], "test_component_collider_t");
+		CUTE_TEST_ASSERT(sprite->img_id == 2);
+		CUTE_TEST_ASSERT(collider->type == 4);
+		CUTE_TEST_ASSERT(collider->radius == 3.0f);
+		collider->type = i;
+	}
+
+	// Destroy the first half, the rest must keep their own components.
+	entity_destroy_many(pellets, 500);
+	for (int i = 0; i < 1000; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(pellets[i]) == (i >= 500));
+	}
+	for (int i = 500; i < 1000; ++i) {
+		test_component_collider_t* collider = (test_component_collider_t*)entity_get_component(pellets[i], "test_component_collider_t");
+		CUTE_TEST_ASSERT(collider->type == (uint64_t)i);
+	}
+	CUTE_TEST_ASSERT(entity_is_valid(single));
+
+	// Components loaded before one fails to load are cleaned up again.
+	ecs_component_begin();
+	ecs_component_set_name("tracked");
+	ecs_component_set_size(sizeof(int));
+	ecs_component_set_optional_serializer(test_component_zero_serialize, (void*)sizeof(int));
+	ecs_component_set_optional_cleanup(test_component_tracked_cleanup);
+	ecs_component_end();
+
+	ecs_component_begin();
+	ecs_component_set_name("faulty");
+	ecs_component_set_size(sizeof(int));
+	ecs_component_set_optional_serializer(test_component_faulty_serialize);
+	ecs_component_set_optional_cleanup(test_component_tracked_cleanup);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("Faulty");
+	ecs_entity_add_component("tracked");
+	ecs_entity_add_component("faulty");
+	ecs_entity_end();
+
+	s_tracked_cleanup_count = 0;
+	s_faulty_loads_left = 3;
+	CUTE_TEST_ASSERT(entity_make_many("Faulty", 10, pellets).is_error());
+	CUTE_TEST_ASSERT(s_tracked_cleanup_count == 10 + 3);
+	for (int i = 0; i < 10; ++i) {
+		CUTE_TEST_ASSERT(pellets[i] == INVALID_ENTITY);
+	}
+
+	s_tracked_cleanup_count = 0;
+	cute::error_t err;
+	entity_t faulty = entity_make("Faulty", &err);
+	CUTE_TEST_ASSERT(err.is_error());
+	CUTE_TEST_ASSERT(faulty == INVALID_ENTITY);
+	CUTE_TEST_ASSERT(s_tracked_cleanup_count == 1);
+
+	app_destroy();
+
+	return 0;
+}
+
+cute::error_t test_component_value_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	// Keeps whatever a parent schema loaded if the key is missing.
+	if (!kv_key(kv, "value").is_error()) kv_val(kv, (int*)component);
+	return kv_error_state(kv);
+}
+
+CUTE_TEST_CASE(test_ecs_schema_prototype, "Cached schema defaults are refreshed when a schema is registered again.");
+int test_ecs_schema_prototype()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	ecs_component_begin();
+	ecs_component_set_name("test_component_sprite_t");
+	ecs_component_set_size(sizeof(test_component_sprite_t));
+	ecs_component_set_optional_serializer(test_component_counted_sprite_serialize);
+	ecs_component_set_optional_copy_defaults(true);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(CUTE_STRINGIZE(entity_type = "Coin", test_component_sprite_t = { img_id = 5, },));
+	ecs_entity_end();
+
+	s_sprite_serialize_count = 0;
+	for (int i = 0; i < 10; ++i) {
+		entity_t e = entity_make("Coin");
+		CUTE_TEST_ASSERT(((test_component_sprite_t*)entity_get_component(e, "test_component_sprite_t"))->img_id == 5);
+	}
+	CUTE_TEST_ASSERT(s_sprite_serialize_count == 1);
+
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(CUTE_STRINGIZE(entity_type = "Coin", test_component_sprite_t = { img_id = 6, },));
+	ecs_entity_end();
+
+	entity_t e = entity_make("Coin");
+	CUTE_TEST_ASSERT(((test_component_sprite_t*)entity_get_component(e, "test_component_sprite_t"))->img_id == 6);
+	CUTE_TEST_ASSERT(s_sprite_serialize_count == 2);
+
+	// Types inheriting from a schema registered again pick up its new defaults.
+	ecs_component_begin();
+	ecs_component_set_name("value");
+	ecs_component_set_size(sizeof(int));
+	ecs_component_set_optional_serializer(test_component_value_serialize);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(CUTE_STRINGIZE(entity_type = "Purse", value = { value = 1, },));
+	ecs_entity_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(CUTE_STRINGIZE(entity_type = "BigPurse", inherits_from = "Purse", value = { unused = 0, },));
+	ecs_entity_end();
+
+	e = entity_make("BigPurse");
+	CUTE_TEST_ASSERT(*(int*)entity_get_component(e, "value") == 1);
+
+	ecs_entity_begin();
+	ecs_entity_set_optional_schema(CUTE_STRINGIZE(entity_type = "Purse", value = { value = 2, },));
+	ecs_entity_end();
+
+	e = entity_make("BigPurse");
+	CUTE_TEST_ASSERT(*(int*)entity_get_component(e, "value") == 2);
+
+	app_destroy();
+
+	return 0;
+}
+
+static void s_query_check_span(ecs_span_t span, void* udata)
+{
+	int* entity_count = (int*)udata;
+	test_component_position_t* positions = (test_component_position_t*)span.components[0];
+	test_component_velocity_t* velocities = (test_component_velocity_t*)span.components[1];
+	for (int i = 0; i < span.entity_count; ++i) {
+		entity_t e = span.get_entity(i);
+		if (entity_get_component(e, "position") != positions + i) return;
+		if (entity_get_component(e, "velocity") != velocities + i) return;
+		++*entity_count;
+	}
+}
+
+static void s_query_integrate_span(ecs_span_t span, void* udata)
+{
+	test_component_position_t* positions = (test_component_position_t*)span.components[0];
+	test_component_velocity_t* velocities = (test_component_velocity_t*)span.components[1];
+	for (int i = 0; i < span.entity_count; ++i) {
+		positions[i].x += velocities[i].x;
+		positions[i].y += velocities[i].y;
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_query, "Iterate over components with queries, serially and in parallel.");
+int test_ecs_query()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	s_register_parallel_test_ecs(false);
+	array<entity_t> entities;
+	s_spawn_parallel_test_entities(&entities);
+
+	ecs_query_t query = ecs_query({ "position", "velocity" });
+	CUTE_TEST_ASSERT(ecs_query({ "position", "velocity" }).id == query.id);
+	CUTE_TEST_ASSERT(ecs_query({ "velocity", "position" }).id != query.id);
+
+	// Every entity is visited once, with components in the order of the query.
+	int entity_count = 0;
+	ecs_query_for_each(query, s_query_check_span, &entity_count);
+	CUTE_TEST_ASSERT(entity_count == 1000);
+
+	int health_count = 0;
+	ecs_query_for_each(ecs_query({ "health" }), [](ecs_span_t span, void* udata) { *(int*)udata += span.entity_count; }, &health_count);
+	CUTE_TEST_ASSERT(health_count == 500);
+
+	ecs_query_parallel_for_each(query, s_query_integrate_span, NULL, 50);
+	ecs_query_parallel_for_each(query, s_query_integrate_span);
+	for (int i = 0; i < entities.count(); ++i) {
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(entities[i], "position");
+		CUTE_TEST_ASSERT(position->x == (float)(i % 37) * 2.0f);
+		CUTE_TEST_ASSERT(position->y == ((float)(i % 11) - 5.0f) * 2.0f);
+	}
+
+	// New entity types are picked up by existing queries.
+	ecs_entity_begin();
+	ecs_entity_set_name("rock");
+	ecs_entity_add_component("velocity");
+	ecs_entity_add_component("position");
+	ecs_entity_end();
+	entity_make("rock");
+	entity_count = 0;
+	ecs_query_for_each(query, s_query_check_span, &entity_count);
+	CUTE_TEST_ASSERT(entity_count == 1001);
+
+	app_destroy();
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_ecs_component_id, "Look up components by id instead of by name.");
+int test_ecs_component_id()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	s_register_parallel_test_ecs(false);
+	array<entity_t> entities;
+	s_spawn_parallel_test_entities(&entities);
+
+	component_id_t position_id = ecs_component_id("position");
+	component_id_t health_id = ecs_component_id("health");
+	CUTE_TEST_ASSERT(position_id.id != INVALID_COMPONENT_ID.id);
+	CUTE_TEST_ASSERT(health_id.id != position_id.id);
+	CUTE_TEST_ASSERT(ecs_component_id("mana").id == INVALID_COMPONENT_ID.id);
+
+	for (int i = 0; i < entities.count(); ++i) {
+		entity_t e = entities[i];
+		CUTE_TEST_ASSERT(entity_get_component(e, position_id) == entity_get_component(e, "position"));
+		CUTE_TEST_ASSERT(entity_get_component(e, health_id) == entity_get_component(e, "health"));
+		CUTE_TEST_ASSERT(entity_has_component(e, health_id) == entity_has_component(e, "health"));
+		CUTE_TEST_ASSERT(!entity_has_component(e, INVALID_COMPONENT_ID));
+	}
+
+	// Components registered after an entity type are never part of it.
+	ecs_component_begin();
+	ecs_component_set_name("mana");
+	ecs_component_set_size(sizeof(int));
+	ecs_component_end();
+	component_id_t mana_id = ecs_component_id("mana");
+	CUTE_TEST_ASSERT(mana_id.id != INVALID_COMPONENT_ID.id);
+	CUTE_TEST_ASSERT(!entity_has_component(entities[0], mana_id));
+	CUTE_TEST_ASSERT(!entity_get_component(entities[0], mana_id));
+
+	app_destroy();
+
+	return 0;
+}
+
+struct test_component_link_t
+{
+	entity_t target;
+};
+
+cute::error_t test_component_link_serialize(kv_t* kv, bool reading, entity_t entity, void* component, void* udata)
+{
+	test_component_link_t* link = (test_component_link_t*)component;
+	if (reading) link->target = INVALID_ENTITY;
+	if (!kv) return error_success();
+	kv_key(kv, "target"); kv_val_entity(kv, &link->target);
+	return kv_error_state(kv);
+}
+
+CUTE_TEST_CASE(test_ecs_snapshot, "Save and load binary snapshots of all entities.");
+int test_ecs_snapshot()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	s_register_parallel_test_ecs(false);
+
+	ecs_component_begin();
+	ecs_component_set_name("link");
+	ecs_component_set_size(sizeof(test_component_link_t));
+	ecs_component_set_optional_serializer(test_component_link_serialize);
+	ecs_component_set_optional_snapshot_serialize(true);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("linker");
+	ecs_entity_add_component("link");
+	ecs_entity_end();
+
+	array<entity_t> entities;
+	s_spawn_parallel_test_entities(&entities);
+	for (int i = 0; i < 10; ++i) {
+		entity_t e = entity_make("linker");
+		((test_component_link_t*)entity_get_component(e, "link"))->target = entities[i * 7];
+		entities.add(e);
+	}
+	ecs_run_systems(1.0f / 60.0f);
+
+	array<test_component_position_t> positions;
+	for (int i = 0; i < 1000; ++i) {
+		positions.add(*(test_component_position_t*)entity_get_component(entities[i], "position"));
+	}
+
+	array<uint8_t> snapshot;
+	CUTE_TEST_ASSERT(!ecs_save_snapshot(&snapshot).is_error());
+
+	// Change the world around after saving.
+	ecs_run_systems(1.0f / 60.0f);
+	for (int i = 0; i < 1000; i += 3) entity_destroy(entities[i]);
+	entity_t made_after_save = entity_make("mover");
+
+	// Broken snapshots are rejected without touching any entities.
+	CUTE_TEST_ASSERT(ecs_load_snapshot(snapshot.data(), snapshot.count() - 1).is_error());
+	CUTE_TEST_ASSERT(entity_is_valid(made_after_save));
+	CUTE_TEST_ASSERT(!entity_is_valid(entities[0]));
+
+	// Same for a snapshot that only breaks within the serialized "link" components, after all sizes and
+	// counts have already checked out.
+	array<uint8_t> corrupted = snapshot;
+	const char* key = "components";
+	int key_len = (int)CUTE_STRLEN(key);
+	for (int i = 0; i + key_len <= corrupted.count(); ++i) {
+		if (!CUTE_MEMCMP(corrupted.data() + i, key, key_len)) corrupted[i] = 'x';
+	}
+	CUTE_TEST_ASSERT(ecs_load_snapshot(corrupted.data(), corrupted.count()).is_error());
+	CUTE_TEST_ASSERT(entity_is_valid(made_after_save));
+	CUTE_TEST_ASSERT(!entity_is_valid(entities[0]));
+
+	CUTE_TEST_ASSERT(!ecs_load_snapshot(snapshot.data(), snapshot.count()).is_error());
+	CUTE_TEST_ASSERT(!entity_is_valid(made_after_save));
+	for (int i = 0; i < 1000; ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(entities[i]));
+		test_component_position_t* position = (test_component_position_t*)entity_get_component(entities[i], "position");
+		CUTE_TEST_ASSERT(position->x == positions[i].x);
+		CUTE_TEST_ASSERT(position->y == positions[i].y);
+	}
+	for (int i = 0; i < 10; ++i) {
+		test_component_link_t* link = (test_component_link_t*)entity_get_component(entities[1000 + i], "link");
+		CUTE_TEST_ASSERT(link->target == entities[i * 7]);
+	}
+
+	// Entities made in between loading the same snapshot twice are invalidated as well.
+	entity_t made_after_load = entity_make("mover");
+	CUTE_TEST_ASSERT(!ecs_load_snapshot(snapshot.data(), snapshot.count()).is_error());
+	CUTE_TEST_ASSERT(!entity_is_valid(made_after_load));
+	CUTE_TEST_ASSERT(entity_is_valid(entities[0]));
+
+	// Components with a cleanup function can't be saved as raw bytes.
+	ecs_component_begin();
+	ecs_component_set_name("tracked");
+	ecs_component_set_size(sizeof(int));
+	ecs_component_set_optional_serializer(test_component_zero_serialize, (void*)sizeof(int));
+	ecs_component_set_optional_cleanup(test_component_tracked_cleanup);
+	ecs_component_end();
+
+	ecs_entity_begin();
+	ecs_entity_set_name("tracker");
+	ecs_entity_add_component("tracked");
+	ecs_entity_end();
+
+	CUTE_TEST_ASSERT(ecs_save_snapshot(&snapshot).is_error());
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+void update_test_spawn_system(float dt, void* udata, test_component_health_t* healths, int entity_count)
+{
+	for (int i = 0; i < entity_count; ++i) {
+		entity_t spark = entity_delayed_make("spark");
+		test_component_velocity_t velocity = { (float)healths[i].hp, 1.0f };
+		entity_delayed_set_component(spark, "velocity", &velocity, sizeof(velocity));
+		if (healths[i].hp % 4 == 3) entity_delayed_destroy(spark);
+	}
+}
+
+struct test_spark_count_t
+{
+	int count;
+	float velocity_sum;
+};
+
+static void s_count_sparks(ecs_span_t span, void* udata)
+{
+	test_spark_count_t* sparks = (test_spark_count_t*)udata;
+	if (!entity_is_type(span.get_entity(0), "spark")) return;
+	test_component_velocity_t* velocities = (test_component_velocity_t*)span.components[0];
+	for (int i = 0; i < span.entity_count; ++i) {
+		if (velocities[i].y != 1.0f) continue;
+		sparks->velocity_sum += velocities[i].x;
+		sparks->count++;
+	}
+}
+
+CUTE_TEST_CASE(test_ecs_delayed_commands, "Make, change and destroy entities from parallel systems with delayed commands.");
+int test_ecs_delayed_commands()
+{
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	s_register_parallel_test_ecs(true);
+
+	ecs_entity_begin();
+	ecs_entity_set_name("spark");
+	ecs_entity_add_component("velocity");
+	ecs_entity_end();
+
+	ecs_system_begin();
+	ecs_system_set_update((void*)update_test_spawn_system);
+	ecs_system_require_component("health", COMPONENT_ACCESS_READ);
+	ecs_system_set_optional_parallel_chunk_size(16);
+	ecs_system_end();
+
+	array<entity_t> entities;
+	s_spawn_parallel_test_entities(&entities);
+
+	// Each unit spawns a spark, and sparks spawned by units with `hp % 4 == 3` are destroyed right away.
+	// After decaying once units have `hp = 99 + i` for even `i`.
+	ecs_run_systems(1.0f / 60.0f);
+	float expected_sum = 0;
+	for (int i = 0; i < 1000; i += 4) expected_sum += (float)(101 + i);
+	test_spark_count_t sparks = { 0, 0 };
+	ecs_query_for_each(ecs_query({ "velocity" }), s_count_sparks, &sparks);
+	CUTE_TEST_ASSERT(sparks.count == 250);
+	CUTE_TEST_ASSERT(sparks.velocity_sum == expected_sum);
+
+	// Commands recorded outside of systems are played back by flushing.
+	ecs_set_parallel_systems(false);
+	ecs_query_parallel_for_each(ecs_query({ "health" }), [](ecs_span_t span, void* udata) {
+		for (int i = 0; i < span.entity_count; ++i) {
+			entity_delayed_destroy(span.get_entity(i));
+		}
+	}, NULL, 16);
+	CUTE_TEST_ASSERT(entity_is_valid(entities[0]));
+	ecs_flush_delayed_commands();
+	for (int i = 0; i < entities.count(); ++i) {
+		CUTE_TEST_ASSERT(entity_is_valid(entities[i]) == (i & 1 ? true : false));
+	}
+
+	// Placeholders are never valid, and sparks made without setting a velocity are left zeroed.
+	entity_t placeholder = entity_delayed_make("spark");
+	CUTE_TEST_ASSERT(!entity_is_valid(placeholder));
+	CUTE_TEST_ASSERT(entity_delayed_make("not_a_type") == INVALID_ENTITY);
+	ecs_flush_delayed_commands();
+	CUTE_TEST_ASSERT(!entity_is_valid(placeholder));
+	sparks = { 0, 0 };
+	ecs_query_for_each(ecs_query({ "velocity" }), s_count_sparks, &sparks);
+	CUTE_TEST_ASSERT(sparks.count == 250);
+
+	app_destroy();
+
+	return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+
+CUTE_TEST_CASE(test_ecs_system_profiling, "Record per-system profiles into a ring buffer of frames.");
+int test_ecs_system_profiling()
+{
+	for (int pass = 0; pass < 2; ++pass) {
+		if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+			return -1;
+		}
+
+		s_register_parallel_test_ecs(pass == 1);
+		array<entity_t> entities;
+		s_spawn_parallel_test_entities(&entities);
+
+		// Nothing is recorded until profiling is turned on.
+		ecs_run_systems(1.0f / 60.0f);
+		CUTE_TEST_ASSERT(ecs_get_system_profile_frame_count() == 0);
+		CUTE_TEST_ASSERT(ecs_get_system_profile().count() == 0);
+
+		ecs_set_system_profiling(true);
+		for (int i = 0; i < CUTE_ECS_PROFILE_FRAME_COUNT + 5; ++i) {
+			ecs_run_systems(1.0f / 60.0f);
+		}
+		CUTE_TEST_ASSERT(ecs_get_system_profile_frame_count() == CUTE_ECS_PROFILE_FRAME_COUNT);
+		CUTE_TEST_ASSERT(ecs_get_system_profile(CUTE_ECS_PROFILE_FRAME_COUNT).count() == 0);
+
+		// Integrate and damping run on all 1000 entities, decay and heal only on the 500 units.
+		array<ecs_system_profile_t> profile = ecs_get_system_profile(CUTE_ECS_PROFILE_FRAME_COUNT - 1);
+		CUTE_TEST_ASSERT(profile.count() == 4);
+		CUTE_TEST_ASSERT(profile[0].entity_count == 1000);
+		CUTE_TEST_ASSERT(profile[1].entity_count == 1000);
+		CUTE_TEST_ASSERT(profile[2].entity_count == 500);
+		CUTE_TEST_ASSERT(profile[3].entity_count == 500);
+		for (int i = 0; i < profile.count(); ++i) {
+			CUTE_TEST_ASSERT(profile[i].update_seconds >= 0);
+			CUTE_TEST_ASSERT(profile[i].name != NULL);
+		}
+
+		// Registering another system starts the history over.
+		ecs_system_begin();
+		ecs_system_set_name("heal");
+		ecs_system_set_update((void*)update_test_heal_system);
+		ecs_system_require_component("position", COMPONENT_ACCESS_READ);
+		ecs_system_require_component("health");
+		ecs_system_end();
+		ecs_run_systems(1.0f / 60.0f);
+		CUTE_TEST_ASSERT(ecs_get_system_profile_frame_count() == 1);
+		profile = ecs_get_system_profile();
+		CUTE_TEST_ASSERT(profile.count() == 5);
+		CUTE_TEST_ASSERT(!CUTE_STRCMP(profile[4].name, "heal"));
+		CUTE_TEST_ASSERT(profile[4].entity_count == 500);
+
+		ecs_set_system_profiling(false);
+		ecs_run_systems(1.0f / 60.0f);
+		CUTE_TEST_ASSERT(ecs_get_system_profile_frame_count() == 1);
+
+		app_destroy();
+	}
+
+	return 0;
+}
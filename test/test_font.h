@@ -0,0 +1,231 @@
+/*
+	Cute Framework
+	Copyright (C) 2019 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute.h>
+#include <cute/cute_font.h>
+#include <imgui/imgui.h>
+using namespace cute;
+
+#ifdef SOKOL_DUMMY_BACKEND
+
+static void s_font_trace_append_buffer(sg_buffer buf, const sg_range* data, int result, void* user_data)
+{
+	array<cute_font_vert_t>* verts = (array<cute_font_vert_t>*)user_data;
+	int count = (int)(data->size / sizeof(cute_font_vert_t));
+	verts->ensure_count(count);
+	const cute_font_vert_t* src = (const cute_font_vert_t*)data->ptr;
+	for (int i = 0; i < count; ++i) {
+		(*verts)[i] = src[i];
+	}
+}
+
+static int s_font_made_images;
+static int s_font_updated_images;
+
+static void s_font_trace_make_image(const sg_image_desc* desc, sg_image result, void* user_data)
+{
+	s_font_made_images++;
+}
+
+static void s_font_trace_update_image(sg_image img, const sg_image_data* data, void* user_data)
+{
+	s_font_updated_images++;
+}
+
+static bool s_font_verts_match(const array<cute_font_vert_t>& verts, const array<cute_font_vert_t>& expected, float x, float y)
+{
+	if (verts.count() != expected.count()) return false;
+	for (int i = 0; i < verts.count(); ++i) {
+		if (verts[i].x != expected[i].x + x) return false;
+		if (verts[i].y != expected[i].y + y) return false;
+		if (verts[i].u != expected[i].u) return false;
+		if (verts[i].v != expected[i].v) return false;
+	}
+	return true;
+}
+
+#endif // SOKOL_DUMMY_BACKEND
+
+CUTE_TEST_CASE(test_font_layout_cache, "Cached text layouts replay the same verts at any position.");
+int test_font_layout_cache()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	array<cute_font_vert_t> verts;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &verts;
+	hooks.append_buffer = s_font_trace_append_buffer;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	const font_t* font = font_get_default();
+	const char* text = "Cute Framework\nlayout cache";
+	aabb_t clip = make_aabb(v2(4, -20), v2(60, 10));
+
+	// Lay the text out at the origin without the cache, as the reference.
+	CUTE_TEST_ASSERT(!font_is_layout_cache_on());
+	app_update(0);
+	font_push_verts(font, text, 0, 0, 1000.0f, &clip);
+	font_draw(font, matrix_identity());
+	app_present();
+	array<cute_font_vert_t> expected = verts;
+	CUTE_TEST_ASSERT(expected.count() > 0);
+
+	font_layout_cache(true);
+	CUTE_TEST_ASSERT(font_is_layout_cache_on());
+
+	// The clip box moves along with the text, so these all share one layout.
+	v2 offsets[] = { v2(10, 20), v2(-7, 3), v2(10, 20) };
+	for (int i = 0; i < (int)CUTE_ARRAY_SIZE(offsets); ++i) {
+		aabb_t moved_clip = make_aabb(clip.min + offsets[i], clip.max + offsets[i]);
+		app_update(0);
+		font_push_verts(font, text, offsets[i].x, offsets[i].y, 1000.0f, &moved_clip);
+		font_draw(font, matrix_identity());
+		app_present();
+		CUTE_TEST_ASSERT(s_font_verts_match(verts, expected, offsets[i].x, offsets[i].y));
+	}
+
+	font_layout_cache_stats_t stats = font_get_layout_cache_stats();
+	CUTE_TEST_ASSERT(stats.misses == 1);
+	CUTE_TEST_ASSERT(stats.hits == 2);
+	CUTE_TEST_ASSERT(stats.layout_count == 1);
+
+	// A different wrap width or clip box is a different layout.
+	app_update(0);
+	font_push_verts(font, text, 0, 0, 1000.0f, &clip);
+	font_push_verts(font, text, 0, 0, 1000.0f, NULL);
+	font_push_verts(font, text, 0, 0, 40.0f, &clip);
+	font_draw(font, matrix_identity());
+	app_present();
+	stats = font_get_layout_cache_stats();
+	CUTE_TEST_ASSERT(stats.misses == 3);
+	CUTE_TEST_ASSERT(stats.hits == 3);
+	CUTE_TEST_ASSERT(stats.layout_count == 3);
+
+	// Layouts nobody draws are dropped after a frame.
+	app_update(0);
+	app_present();
+	app_update(0);
+	app_present();
+	CUTE_TEST_ASSERT(font_get_layout_cache_stats().layout_count == 0);
+
+	font_layout_cache(false);
+	sg_install_trace_hooks(&old_hooks);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_font_sdf, "SDF fonts bake glyphs lazily into a growing atlas.");
+int test_font_sdf()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	array<cute_font_vert_t> verts;
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = &verts;
+	hooks.append_buffer = s_font_trace_append_buffer;
+	hooks.make_image = s_font_trace_make_image;
+	hooks.update_image = s_font_trace_update_image;
+	sg_trace_hooks old_hooks = sg_install_trace_hooks(&hooks);
+
+	// Borrow the ttf Dear ImGui embeds, so the test needs no font files.
+	ImFontAtlas imgui_atlas;
+	imgui_atlas.AddFontDefault();
+	const ImFontConfig& config = imgui_atlas.ConfigData[0];
+	font_t* font = font_load_sdf_mem(config.FontData, config.FontDataSize);
+	CUTE_TEST_ASSERT(font);
+	CUTE_TEST_ASSERT(font_is_sdf(font));
+	CUTE_TEST_ASSERT(!font_is_sdf(font_get_default()));
+	CUTE_TEST_ASSERT(font_height(font) > 0);
+	CUTE_TEST_ASSERT(font_line_height(font) >= font_height(font));
+
+	// Metrics are known right away, the glyph itself shows up once the background job is done.
+	cute_font_t* cute_font = (cute_font_t*)font;
+	cute_font_glyph_t* a = cute_font_get_glyph(cute_font, cute_font_get_glyph_index(cute_font, 'A'));
+	CUTE_TEST_ASSERT(a->xadvance > 0);
+	CUTE_TEST_ASSERT(font_text_width(font, "AA") == a->xadvance * 2);
+	for (int i = 0; i < 1000 && a->w == 0; ++i) {
+		app_update(0);
+		app_present();
+	}
+	CUTE_TEST_ASSERT(a->w > 0 && a->h > 0);
+	CUTE_TEST_ASSERT(cute_font->atlas_w == 1024);
+
+	// Glyphs outside of ascii are added on first use.
+	const char* e_acute = "\xC3\xA9";
+	int before = cute_font->glyph_count;
+	font_sdf_preload(font, e_acute);
+	CUTE_TEST_ASSERT(cute_font->glyph_count == before + 1);
+	cute_font_glyph_t* e = cute_font_get_glyph(cute_font, cute_font_get_glyph_index(cute_font, 0xE9));
+	CUTE_TEST_ASSERT(e->w > 0 && e->h > 0);
+
+	// Filling up the atlas grows it, and moves the UVs of glyphs already in there along with it. The atlas
+	// image is only remade when it grows, and otherwise updated at most once per frame.
+	int atlas_h = cute_font->atlas_h;
+	s_font_made_images = 0;
+	s_font_updated_images = 0;
+	for (int c = 0xA1; c < 0x800 && cute_font->atlas_h == atlas_h; ++c) {
+		char utf8[3] = { (char)(0xC0 | (c >> 6)), (char)(0x80 | (c & 0x3F)), 0 };
+		font_sdf_preload(font, utf8);
+	}
+	CUTE_TEST_ASSERT(cute_font->atlas_h > atlas_h);
+	CUTE_TEST_ASSERT(s_font_made_images == 1);
+	CUTE_TEST_ASSERT(s_font_updated_images == 1);
+	a = cute_font_get_glyph(cute_font, cute_font_get_glyph_index(cute_font, 'A'));
+	CUTE_TEST_ASSERT(cute::abs((a->maxy - a->miny) * cute_font->atlas_h - a->h) < 1.0e-3f);
+	CUTE_TEST_ASSERT(cute::abs((a->maxx - a->minx) * cute_font->atlas_w - a->w) < 1.0e-3f);
+
+	// Cached layouts are rebuilt once new glyphs are baked, instead of replaying invisible quads.
+	font_layout_cache(true);
+	const char* zhong = "\xE4\xB8\xAD";
+	app_update(0);
+	font_push_verts(font, zhong, 0, 0, 0);
+	font_draw(font, matrix_identity());
+	CUTE_TEST_ASSERT(verts.count() == 6);
+	CUTE_TEST_ASSERT(verts[0].x == verts[2].x);
+	app_present();
+	for (int i = 0; i < 1000 && verts[0].x == verts[2].x; ++i) {
+		app_update(0);
+		font_push_verts(font, zhong, 0, 0, 0);
+		font_draw(font, matrix_identity());
+		app_present();
+	}
+	CUTE_TEST_ASSERT(verts[0].x != verts[2].x);
+	for (int i = 0; i < verts.count(); ++i) {
+		CUTE_TEST_ASSERT(verts[i].u >= 0 && verts[i].u <= 1);
+		CUTE_TEST_ASSERT(verts[i].v >= 0 && verts[i].v <= 1);
+	}
+	font_layout_cache(false);
+
+	font_free(font);
+	sg_install_trace_hooks(&old_hooks);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
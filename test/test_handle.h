@@ -126,3 +126,48 @@ int test_handle_alloc_too_many()
 
 	return 0;
 }
+
+CUTE_TEST_CASE(test_handle_state, "Restore handle allocator states, rejecting broken ones without changing anything.");
+int test_handle_state()
+{
+	handle_allocator_t* table = handle_allocator_make(0, NULL);
+	CUTE_TEST_CHECK_POINTER(table);
+
+	cute::handle_t h0 = handle_allocator_alloc(table, 0);
+	cute::handle_t h1 = handle_allocator_alloc(table, 1);
+	array<uint8_t> state;
+	state.ensure_count((int)handle_allocator_state_size(table));
+	handle_allocator_get_state(table, state.data());
+	CUTE_TEST_ASSERT(handle_allocator_is_state_valid(state.data(), state.count(), &h0, 1));
+	CUTE_TEST_ASSERT(!handle_allocator_is_state_valid(state.data(), state.count(), &h1, 1));
+
+	handle_allocator_free(table, h1);
+	cute::handle_t h2 = handle_allocator_alloc(table, 1);
+	CUTE_TEST_ASSERT(handle_allocator_set_state(table, state.data(), state.count()));
+	CUTE_TEST_ASSERT(handle_allocator_is_handle_valid(table, h0));
+	CUTE_TEST_ASSERT(handle_allocator_is_handle_valid(table, h1));
+	CUTE_TEST_ASSERT(!handle_allocator_is_handle_valid(table, h2));
+
+	// A small state, with every handle free. Restoring it must not assert on the capacity.
+	uint32_t small_state[2 + 2 * 4] = { 0, 4, 1, 0, 2, 0, 3, 0, UINT32_MAX, 0 };
+	CUTE_TEST_ASSERT(handle_allocator_set_state(table, small_state, sizeof(small_state)));
+	CUTE_TEST_ASSERT(!handle_allocator_is_handle_valid(table, h0));
+
+	// A size mismatch, a free list running out of bounds, or a cyclic free list are all rejected.
+	CUTE_TEST_ASSERT(!handle_allocator_set_state(table, small_state, sizeof(small_state) - 1));
+	small_state[0] = 4;
+	CUTE_TEST_ASSERT(!handle_allocator_set_state(table, small_state, sizeof(small_state)));
+	small_state[0] = 0;
+	small_state[8] = 0;
+	CUTE_TEST_ASSERT(!handle_allocator_set_state(table, small_state, sizeof(small_state)));
+
+	// Handles keep coming after restoring a small state.
+	for (int i = 0; i < 1000; ++i) {
+		cute::handle_t h = handle_allocator_alloc(table, i);
+		CUTE_TEST_ASSERT(handle_allocator_get_index(table, h) == (uint32_t)i);
+	}
+
+	handle_allocator_destroy(table);
+
+	return 0;
+}
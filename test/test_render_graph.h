@@ -0,0 +1,254 @@
+/*
+	Cute Framework
+	Copyright (C) 2021 Randy Gaul https://randygaul.net
+
+	This software is provided 'as-is', without any express or implied
+	warranty.  In no event will the authors be held liable for any damages
+	arising from the use of this software.
+
+	Permission is granted to anyone to use this software for any purpose,
+	including commercial applications, and to alter it and redistribute it
+	freely, subject to the following restrictions:
+
+	1. The origin of this software must not be misrepresented; you must not
+	   claim that you wrote the original software. If you use this software
+	   in a product, an acknowledgment in the product documentation would be
+	   appreciated but is not required.
+	2. Altered source versions must be plainly marked as such, and must not be
+	   misrepresented as being the original software.
+	3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <cute.h>
+using namespace cute;
+
+#ifdef SOKOL_DUMMY_BACKEND
+
+struct render_graph_trace_t
+{
+	int make_image_count = 0;
+	int destroy_image_count = 0;
+	int make_pass_count = 0;
+	int destroy_pass_count = 0;
+	int begin_pass_count = 0;
+	sg_image last_bound_image = { SG_INVALID_ID };
+	array<char> log;
+};
+
+static void s_render_graph_trace_make_image(const sg_image_desc* desc, sg_image result, void* user_data) { ((render_graph_trace_t*)user_data)->make_image_count++; }
+static void s_render_graph_trace_destroy_image(sg_image img, void* user_data) { ((render_graph_trace_t*)user_data)->destroy_image_count++; }
+static void s_render_graph_trace_make_pass(const sg_pass_desc* desc, sg_pass result, void* user_data) { ((render_graph_trace_t*)user_data)->make_pass_count++; }
+static void s_render_graph_trace_destroy_pass(sg_pass pass, void* user_data) { ((render_graph_trace_t*)user_data)->destroy_pass_count++; }
+static void s_render_graph_trace_begin_pass(sg_pass pass, const sg_pass_action* pass_action, void* user_data) { ((render_graph_trace_t*)user_data)->begin_pass_count++; }
+static void s_render_graph_trace_apply_bindings(const sg_bindings* bindings, void* user_data) { ((render_graph_trace_t*)user_data)->last_bound_image = bindings->fs_images[0]; }
+
+static sg_trace_hooks s_render_graph_install_hooks(render_graph_trace_t* trace)
+{
+	sg_trace_hooks hooks = { 0 };
+	hooks.user_data = trace;
+	hooks.make_image = s_render_graph_trace_make_image;
+	hooks.destroy_image = s_render_graph_trace_destroy_image;
+	hooks.make_pass = s_render_graph_trace_make_pass;
+	hooks.destroy_pass = s_render_graph_trace_destroy_pass;
+	hooks.begin_pass = s_render_graph_trace_begin_pass;
+	hooks.apply_bindings = s_render_graph_trace_apply_bindings;
+	return sg_install_trace_hooks(&hooks);
+}
+
+struct render_graph_test_pass_t
+{
+	render_graph_trace_t* trace;
+	char id;
+};
+
+static void s_render_graph_log_pass(render_graph_t* graph, void* udata)
+{
+	render_graph_test_pass_t* pass = (render_graph_test_pass_t*)udata;
+	pass->trace->log.add(pass->id);
+}
+
+#endif // SOKOL_DUMMY_BACKEND
+
+CUTE_TEST_CASE(test_render_graph_schedule, "Render graph orders and culls passes, and aliases transient targets.");
+int test_render_graph_schedule()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+
+	render_graph_trace_t trace;
+	sg_trace_hooks old_hooks = s_render_graph_install_hooks(&trace);
+
+	render_graph_test_pass_t scene = { &trace, 's' };
+	render_graph_test_pass_t bright = { &trace, 'b' };
+	render_graph_test_pass_t blur = { &trace, 'u' };
+	render_graph_test_pass_t composite = { &trace, 'c' };
+	render_graph_test_pass_t debug = { &trace, 'd' };
+
+	// Passes are added out of order on purpose, and the debug pass feeds nothing.
+	render_graph_t* graph = render_graph_make();
+	render_graph_texture_t scene_tex = render_graph_create_texture(graph, "scene", 64, 64);
+	render_graph_texture_t bright_tex = render_graph_create_texture(graph, "bright", 64, 64);
+	render_graph_texture_t blur_tex = render_graph_create_texture(graph, "blur", 64, 64);
+	render_graph_texture_t final_tex = render_graph_create_texture(graph, "final", 64, 64);
+	render_graph_texture_t debug_tex = render_graph_create_texture(graph, "debug", 64, 64);
+
+	render_graph_pass_t composite_pass = render_graph_add_pass(graph, "composite", s_render_graph_log_pass, &composite);
+	render_graph_pass_reads(graph, composite_pass, scene_tex);
+	render_graph_pass_reads(graph, composite_pass, blur_tex);
+	render_graph_pass_writes(graph, composite_pass, final_tex);
+	render_graph_pass_t scene_pass = render_graph_add_pass(graph, "scene", s_render_graph_log_pass, &scene);
+	render_graph_pass_writes(graph, scene_pass, scene_tex);
+	render_graph_pass_t bright_pass = render_graph_add_pass(graph, "bright", s_render_graph_log_pass, &bright);
+	render_graph_pass_reads(graph, bright_pass, scene_tex);
+	render_graph_pass_writes(graph, bright_pass, bright_tex);
+	render_graph_pass_t blur_pass = render_graph_add_pass(graph, "blur", s_render_graph_log_pass, &blur);
+	render_graph_pass_reads(graph, blur_pass, bright_tex);
+	render_graph_pass_writes(graph, blur_pass, blur_tex);
+	render_graph_pass_t debug_pass = render_graph_add_pass(graph, "debug", s_render_graph_log_pass, &debug);
+	render_graph_pass_reads(graph, debug_pass, scene_tex);
+	render_graph_pass_writes(graph, debug_pass, debug_tex);
+	render_graph_set_output(graph, final_tex);
+
+	CUTE_TEST_ASSERT(!render_graph_execute(graph).is_error());
+	CUTE_TEST_ASSERT(trace.log.count() == 4);
+	CUTE_TEST_ASSERT(!CUTE_MEMCMP(trace.log.data(), "subc", 4));
+	CUTE_TEST_ASSERT(render_graph_pass_is_culled(graph, debug_pass));
+	CUTE_TEST_ASSERT(!render_graph_pass_is_culled(graph, composite_pass));
+	CUTE_TEST_ASSERT(trace.begin_pass_count == 4);
+	CUTE_TEST_ASSERT(trace.make_pass_count == 4);
+
+	// "bright" is dead once "blur" has run, so "final" takes over its image. "blur" reads "bright"
+	// while writing its own target, so those two must not share.
+	CUTE_TEST_ASSERT(trace.make_image_count == 3);
+	CUTE_TEST_ASSERT(render_graph_get_image(graph, final_tex).id == render_graph_get_image(graph, bright_tex).id);
+	CUTE_TEST_ASSERT(render_graph_get_image(graph, blur_tex).id != render_graph_get_image(graph, bright_tex).id);
+	CUTE_TEST_ASSERT(render_graph_get_image(graph, scene_tex).id != render_graph_get_image(graph, final_tex).id);
+	CUTE_TEST_ASSERT(render_graph_get_image(graph, debug_tex).id == SG_INVALID_ID);
+
+	// Executing an unchanged graph does not recompile.
+	CUTE_TEST_ASSERT(!render_graph_execute(graph).is_error());
+	CUTE_TEST_ASSERT(trace.log.count() == 8);
+	CUTE_TEST_ASSERT(trace.make_pass_count == 4);
+	CUTE_TEST_ASSERT(trace.make_image_count == 3);
+
+	// Rebuilding from scratch reuses the pooled images, and drops the ones no longer needed.
+	render_graph_clear(graph);
+	CUTE_TEST_ASSERT(trace.destroy_pass_count == 4);
+	scene_tex = render_graph_create_texture(graph, "scene", 64, 64);
+	scene_pass = render_graph_add_pass(graph, "scene", s_render_graph_log_pass, &scene);
+	render_graph_pass_writes(graph, scene_pass, scene_tex);
+	render_graph_set_output(graph, scene_tex);
+	CUTE_TEST_ASSERT(!render_graph_execute(graph).is_error());
+	CUTE_TEST_ASSERT(trace.log.last() == 's');
+	CUTE_TEST_ASSERT(trace.make_image_count == 3);
+	CUTE_TEST_ASSERT(trace.destroy_image_count == 2);
+
+	// Two writers for one texture, and a cycle, are both errors.
+	render_graph_pass_t second_writer = render_graph_add_pass(graph, "second writer", s_render_graph_log_pass, &debug);
+	render_graph_pass_writes(graph, second_writer, scene_tex);
+	CUTE_TEST_ASSERT(render_graph_compile(graph).is_error());
+	CUTE_TEST_ASSERT(render_graph_execute(graph).is_error());
+
+	render_graph_clear(graph);
+	render_graph_texture_t a = render_graph_create_texture(graph, "a", 64, 64);
+	render_graph_texture_t b = render_graph_create_texture(graph, "b", 64, 64);
+	render_graph_pass_t a_pass = render_graph_add_pass(graph, "a", s_render_graph_log_pass, &debug);
+	render_graph_pass_reads(graph, a_pass, b);
+	render_graph_pass_writes(graph, a_pass, a);
+	render_graph_pass_t b_pass = render_graph_add_pass(graph, "b", s_render_graph_log_pass, &debug);
+	render_graph_pass_reads(graph, b_pass, a);
+	render_graph_pass_writes(graph, b_pass, b);
+	render_graph_set_output(graph, b);
+	int log_count = trace.log.count();
+	CUTE_TEST_ASSERT(render_graph_execute(graph).is_error());
+	CUTE_TEST_ASSERT(trace.log.count() == log_count);
+
+	// Writing textures of different sizes, or reading a texture the pass writes, are errors too.
+	render_graph_clear(graph);
+	render_graph_texture_t big = render_graph_create_texture(graph, "big", 64, 64);
+	render_graph_texture_t small = render_graph_create_texture(graph, "small", 32, 32);
+	render_graph_pass_t mixed = render_graph_add_pass(graph, "mixed", s_render_graph_log_pass, &debug);
+	render_graph_pass_writes(graph, mixed, big);
+	render_graph_pass_writes(graph, mixed, small);
+	render_graph_set_output(graph, big);
+	CUTE_TEST_ASSERT(render_graph_compile(graph).is_error());
+
+	render_graph_clear(graph);
+	render_graph_texture_t feedback_tex = render_graph_create_texture(graph, "feedback", 64, 64);
+	render_graph_pass_t feedback = render_graph_add_pass(graph, "feedback", s_render_graph_log_pass, &debug);
+	render_graph_pass_reads(graph, feedback, feedback_tex);
+	render_graph_pass_writes(graph, feedback, feedback_tex);
+	render_graph_set_output(graph, feedback_tex);
+	CUTE_TEST_ASSERT(render_graph_compile(graph).is_error());
+
+	render_graph_destroy(graph);
+	CUTE_TEST_ASSERT(trace.destroy_image_count == trace.make_image_count);
+	CUTE_TEST_ASSERT(trace.destroy_pass_count == trace.make_pass_count);
+
+	sg_install_trace_hooks(&old_hooks);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}
+
+CUTE_TEST_CASE(test_render_graph_offscreen, "App runs its render graph on the offscreen buffer and upscales the output.");
+int test_render_graph_offscreen()
+{
+#ifdef SOKOL_DUMMY_BACKEND
+	if (app_make(NULL, 0, 0, 0, 0, CUTE_APP_OPTIONS_DEFAULT_GFX_CONTEXT | CUTE_APP_OPTIONS_HIDDEN).is_error()) {
+		return -1;
+	}
+	CUTE_TEST_ASSERT(!app_set_offscreen_buffer(64, 64).is_error());
+
+	render_graph_trace_t trace;
+	sg_trace_hooks old_hooks = s_render_graph_install_hooks(&trace);
+
+	render_graph_test_pass_t post = { &trace, 'p' };
+	render_graph_t* graph = render_graph_make();
+	render_graph_texture_t offscreen = render_graph_import_offscreen_buffer(graph);
+	render_graph_texture_t output = render_graph_create_texture(graph, "post", 64, 64);
+	render_graph_pass_t post_pass = render_graph_add_pass(graph, "post", s_render_graph_log_pass, &post);
+	render_graph_pass_reads(graph, post_pass, offscreen);
+	render_graph_pass_writes(graph, post_pass, output);
+	render_graph_set_output(graph, output);
+	app_set_render_graph(graph);
+
+	for (int i = 0; i < 2; ++i) {
+		app_update(0);
+		app_present();
+	}
+	CUTE_TEST_ASSERT(trace.log.count() == 2);
+	CUTE_TEST_ASSERT(trace.make_image_count == 1);
+	CUTE_TEST_ASSERT(trace.last_bound_image.id == render_graph_get_image(graph, output).id);
+
+	// Without a graph the offscreen buffer itself is upscaled.
+	app_set_render_graph(NULL);
+	app_update(0);
+	app_present();
+	CUTE_TEST_ASSERT(trace.log.count() == 2);
+	CUTE_TEST_ASSERT(trace.last_bound_image.id == render_graph_get_image(graph, offscreen).id);
+
+	// Resizing remakes the offscreen buffer, and the imported texture follows it.
+	CUTE_TEST_ASSERT(!app_set_offscreen_buffer(32, 32).is_error());
+	app_set_render_graph(graph);
+	app_update(0);
+	app_present();
+	CUTE_TEST_ASSERT(trace.log.count() == 3);
+	int w, h;
+	render_graph_get_texture_size(graph, offscreen, &w, &h);
+	CUTE_TEST_ASSERT(w == 32 && h == 32);
+	app_set_render_graph(NULL);
+	app_update(0);
+	app_present();
+	CUTE_TEST_ASSERT(trace.last_bound_image.id == render_graph_get_image(graph, offscreen).id);
+
+	render_graph_destroy(graph);
+	sg_install_trace_hooks(&old_hooks);
+	app_destroy();
+#endif // SOKOL_DUMMY_BACKEND
+
+	return 0;
+}